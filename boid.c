@@ -0,0 +1,2506 @@
+#define _POSIX_C_SOURCE 199309L // clock_gettime
+
+#include "boid.h"
+#include "boid_broadphase.h"
+#include "boid_flowfield.h"
+#include "boid_layout.h"
+#include "boid_memory.h"
+#include "boid_obstacles.h"
+#include "boid_pool.h"
+#include "boid_zones.h"
+
+#include <float.h>
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// ============================================================================
+// VECTOR MATH - The raymath subset the systems use, so the core needs no raylib
+// ============================================================================
+
+static inline Vector2 Vector2Add(Vector2 a, Vector2 b)
+{
+    return (Vector2){ a.x + b.x, a.y + b.y };
+}
+
+static inline Vector2 Vector2Subtract(Vector2 a, Vector2 b)
+{
+    return (Vector2){ a.x - b.x, a.y - b.y };
+}
+
+static inline Vector2 Vector2Scale(Vector2 v, float s)
+{
+    return (Vector2){ v.x * s, v.y * s };
+}
+
+static inline float Vector2Length(Vector2 v)
+{
+    return sqrtf(v.x * v.x + v.y * v.y);
+}
+
+static inline float Vector2Distance(Vector2 a, Vector2 b)
+{
+    return Vector2Length(Vector2Subtract(a, b));
+}
+
+static Vector2 Vector2Limit(Vector2 v, float max)
+{
+    float magSq = v.x * v.x + v.y * v.y;
+    if (magSq > max * max)
+    {
+        float mag = sqrtf(magSq);
+        return (Vector2){ (v.x / mag) * max, (v.y / mag) * max };
+    }
+    return v;
+}
+
+static Vector2 Vector2SetMag(Vector2 v, float mag)
+{
+    float currentMag = sqrtf(v.x * v.x + v.y * v.y);
+    if (currentMag > 0)
+    {
+        return (Vector2){ (v.x / currentMag) * mag, (v.y / currentMag) * mag };
+    }
+    return v;
+}
+
+static double NowSeconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// ============================================================================
+// RANDOM - splitmix64, one stream per world so runs are reproducible
+// ============================================================================
+
+static uint64_t RandomNext(uint64_t *state)
+{
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// Inclusive range, like raylib's GetRandomValue
+static int RandomRange(uint64_t *state, int min, int max)
+{
+    return min + (int)(RandomNext(state) % (uint64_t)(max - min + 1));
+}
+
+static BoidColor RandomPaletteColor(uint64_t *state)
+{
+    static const BoidColor palette[5] = {
+        { 100, 143, 255, 255 }, // Blue
+        { 120, 94, 240, 255 },  // Purple
+        { 220, 38, 127, 255 },  // Pink
+        { 254, 97, 0, 255 },    // Orange
+        { 255, 176, 0, 255 },   // Yellow
+    };
+    return palette[RandomRange(state, 0, 4)];
+}
+
+// ============================================================================
+// SPATIAL GRID
+// ============================================================================
+
+static bool InitGridPyramid(GridPyramid *pyramid, int width, int height)
+{
+    pyramid->levelCount = 0;
+    
+    while (pyramid->levelCount < GRID_PYRAMID_MAX_LEVELS)
+    {
+        GridLevel *level = &pyramid->levels[pyramid->levelCount++];
+        level->width = width;
+        level->height = height;
+        level->cells = calloc((size_t)width * height, sizeof(GridAggregate));
+        if (!level->cells) return false;
+        
+        if (width == 1 && height == 1) return true;
+        width = (width + 1) / 2;
+        height = (height + 1) / 2;
+    }
+    return false;
+}
+
+// Cells come from the world arena
+static bool InitSpatialGrid(SpatialGrid *grid, int worldWidth, int worldHeight)
+{
+    grid->width = worldWidth / BOID_CELL_SIZE;
+    grid->height = worldHeight / BOID_CELL_SIZE;
+    grid->paddedWidth = grid->width + 2;
+    grid->paddedHeight = grid->height + 2;
+    memset(&grid->stats, 0, sizeof(grid->stats));
+    return InitGridPyramid(&grid->pyramid, grid->width, grid->height);
+}
+
+static void FreeSpatialGrid(SpatialGrid *grid)
+{
+    for (int k = 0; k < grid->pyramid.levelCount; k++) free(grid->pyramid.levels[k].cells);
+}
+
+static inline GridCell *SpatialGridCell(SpatialGrid *grid, int x, int y)
+{
+    return &grid->cells[(y + 1) * grid->paddedWidth + x + 1];
+}
+
+// pos must lie inside the world; WrapCoordinate keeps it there. Returns the
+// row-major world cell index.
+static inline int SpatialGridCellIndex(const SpatialGrid *grid, Vector2 pos)
+{
+    int gridX = (int)(pos.x / BOID_CELL_SIZE);
+    int gridY = (int)(pos.y / BOID_CELL_SIZE);
+    return gridY * grid->width + gridX;
+}
+
+// Into [0, size). A step moves a boid less than a world size, so one add or
+// subtract is the common case; host input can be anywhere, and NaN goes to 0.
+static inline float WrapCoordinate(float v, float size)
+{
+    if (v < 0) v += size;
+    if (v >= size) v -= size;
+    if (v >= 0 && v < size) return v;
+    
+    v = fmodf(v, size);
+    if (v < 0) v += size;
+    return (v >= 0 && v < size) ? v : 0.0f;
+}
+
+// Periodic mode: copy each edge row/column (and corner) into the ghost ring on
+// the opposite side. Queries shift ghost ids by one world size (see
+// GhostCellOffset), so wrapped neighbors come out at the right distance.
+static void MirrorSpatialGridEdges(SpatialGrid *grid)
+{
+    int pw = grid->paddedWidth;
+    GridCell *cells = grid->cells;
+    
+    for (int x = 0; x < pw; x++)
+    {
+        cells[x] = cells[grid->height * pw + x];
+        cells[(grid->height + 1) * pw + x] = cells[pw + x];
+    }
+    for (int y = 0; y < grid->paddedHeight; y++)
+    {
+        cells[y * pw] = cells[y * pw + grid->width];
+        cells[y * pw + grid->width + 1] = cells[y * pw + 1];
+    }
+}
+
+static inline void AddAggregate(GridAggregate *sum, const GridAggregate *a)
+{
+    sum->count += a->count;
+    sum->positionSum.x += a->positionSum.x;
+    sum->positionSum.y += a->positionSum.y;
+    sum->velocitySum.x += a->velocitySum.x;
+    sum->velocitySum.y += a->velocitySum.y;
+}
+
+// Bottom-up: world cells into level 0, then each level from 2x2 blocks of the
+// one below. O(cells) in total.
+static void BuildGridPyramid(SpatialGrid *grid)
+{
+    GridPyramid *pyramid = &grid->pyramid;
+    GridLevel *base = &pyramid->levels[0];
+    
+    for (int y = 0; y < grid->height; y++)
+    {
+        for (int x = 0; x < grid->width; x++)
+        {
+            const GridCell *cell = SpatialGridCell(grid, x, y);
+            base->cells[y * base->width + x] = (GridAggregate){ cell->count, cell->positionSum, cell->velocitySum };
+        }
+    }
+    
+    for (int k = 1; k < pyramid->levelCount; k++)
+    {
+        GridLevel *child = &pyramid->levels[k - 1];
+        GridLevel *level = &pyramid->levels[k];
+        memset(level->cells, 0, (size_t)level->width * level->height * sizeof(GridAggregate));
+        
+        for (int y = 0; y < child->height; y++)
+        {
+            for (int x = 0; x < child->width; x++)
+            {
+                AddAggregate(&level->cells[(y / 2) * level->width + x / 2], &child->cells[y * child->width + x]);
+            }
+        }
+    }
+}
+
+// ============================================================================
+// GRID BUILD - Counting sort over the pool
+// ============================================================================
+//
+// Boids go into cells in a given insertion order, and each worker takes a
+// contiguous run of it. Every worker counts its run per cell; a prefix over
+// the workers, cell by cell, turns the counts into the slot each worker's
+// first boid of that cell takes; the scatter then writes exactly where a
+// one-by-one insertion in the same order would have, overflow included.
+
+#define WORKER_SLICE_ALIGN 64 // Boids; a whole number of AoSoA blocks and cache lines
+
+// Per-worker scratch, allocated with the world
+typedef struct {
+    int *counts; // workers x world cells: boids per cell, then next slot
+    SpatialGridStats *stats;
+    
+    // Boids the scatter found no slot for (capacity entries): worker w's
+    // start at droppedStart[w], droppedCount[w] of them, in insertion order
+    int *dropped;
+    int *droppedStart;
+    int *droppedCount;
+} GridBuildScratch;
+
+typedef struct {
+    SpatialGrid *grid;
+    const BoidKinematics *kin;
+    const BoidEntity *ent;
+    const unsigned char *classes;
+    const int *order; // NULL: ids 0 .. items - 1
+    int items;
+    int *cellIds;
+    bool keyed; // cellIds already holds every active boid's cell
+    Vector2 *binnedPositions; // Out: each inserted boid's state as summed
+    Vector2 *binnedVelocities;
+    int workers;
+    GridBuildScratch scratch;
+} GridBuildTask;
+
+static inline int GridBuildId(const GridBuildTask *task, int o)
+{
+    return task->order ? task->order[o] : o;
+}
+
+// Phase 1: cell of every boid in this worker's run, counted per cell
+static void GridCountTask(void *context, int worker)
+{
+    GridBuildTask *task = context;
+    int cells = task->grid->width * task->grid->height;
+    int *counts = task->scratch.counts + (size_t)worker * cells;
+    memset(counts, 0, cells * sizeof(int));
+    
+    int begin, end;
+    BoidPoolSlice(task->items, task->workers, worker, WORKER_SLICE_ALIGN, &begin, &end);
+    for (int o = begin; o < end; o++)
+    {
+        int i = GridBuildId(task, o);
+        if (!task->ent[i].active) continue;
+        if (task->keyed)
+        {
+            counts[task->cellIds[i]]++;
+            continue;
+        }
+        int cell = SpatialGridCellIndex(task->grid, BoidPosition(task->kin, i));
+        counts[cell]++;
+        if (task->cellIds) task->cellIds[i] = cell;
+    }
+}
+
+// Phase 2, by rows: counts become each worker's first slot, cells get their
+// final count and the ghost ring is emptied (MirrorSpatialGridEdges refills
+// it when periodic)
+static void GridPrefixTask(void *context, int worker)
+{
+    GridBuildTask *task = context;
+    SpatialGrid *grid = task->grid;
+    int cells = grid->width * grid->height;
+    SpatialGridStats *stats = &task->scratch.stats[worker];
+    memset(stats, 0, sizeof(SpatialGridStats));
+    
+    int rowBegin, rowEnd;
+    BoidPoolSlice(grid->paddedHeight, task->workers, worker, 1, &rowBegin, &rowEnd);
+    for (int py = rowBegin; py < rowEnd; py++)
+    {
+        for (int px = 0; px < grid->paddedWidth; px++)
+        {
+            GridCell *cell = &grid->cells[py * grid->paddedWidth + px];
+            memset(cell->classCounts, 0, sizeof(cell->classCounts));
+            cell->positionSum = (Vector2){ 0, 0 };
+            cell->velocitySum = (Vector2){ 0, 0 };
+            cell->count = 0;
+            if (px == 0 || py == 0 || px > grid->width || py > grid->height) continue;
+            
+            int c = (py - 1) * grid->width + px - 1;
+            int total = 0;
+            for (int w = 0; w < task->workers; w++)
+            {
+                int *count = &task->scratch.counts[(size_t)w * cells + c];
+                int n = *count;
+                *count = total;
+                total += n;
+            }
+            
+            cell->count = (total < MAX_ENTITIES_PER_CELL) ? total : MAX_ENTITIES_PER_CELL;
+            stats->droppedInserts += total - cell->count;
+            if (cell->count == 0) continue;
+            if (cell->count > stats->maxOccupancy) stats->maxOccupancy = cell->count;
+            stats->occupancyHistogram[cell->count / OCCUPANCY_BIN_SIZE]++;
+        }
+    }
+}
+
+// Phase 3: the same run again, each boid into its slot (cellIds, when given,
+// were filled by phase 1 if not before) or onto the worker's dropped list
+static void GridScatterTask(void *context, int worker)
+{
+    GridBuildTask *task = context;
+    SpatialGrid *grid = task->grid;
+    int *slots = task->scratch.counts + (size_t)worker * grid->width * grid->height;
+    
+    int begin, end;
+    BoidPoolSlice(task->items, task->workers, worker, WORKER_SLICE_ALIGN, &begin, &end);
+    int *dropped = task->scratch.dropped + begin;
+    int droppedCount = 0;
+    for (int o = begin; o < end; o++)
+    {
+        int i = GridBuildId(task, o);
+        if (!task->ent[i].active) continue;
+        int c = task->cellIds ? task->cellIds[i] : SpatialGridCellIndex(grid, BoidPosition(task->kin, i));
+        int slot = slots[c]++;
+        if (slot < MAX_ENTITIES_PER_CELL) SpatialGridCell(grid, c % grid->width, c / grid->width)->entities[slot] = i;
+        else dropped[droppedCount++] = i;
+    }
+    task->scratch.droppedStart[worker] = begin;
+    task->scratch.droppedCount[worker] = droppedCount;
+}
+
+// Phase 4, by rows: class counts and sums, in slot order so the float sums
+// match a one-by-one insertion
+static void GridSumTask(void *context, int worker)
+{
+    GridBuildTask *task = context;
+    SpatialGrid *grid = task->grid;
+    
+    int rowBegin, rowEnd;
+    BoidPoolSlice(grid->height, task->workers, worker, 1, &rowBegin, &rowEnd);
+    for (int y = rowBegin; y < rowEnd; y++)
+    {
+        for (int x = 0; x < grid->width; x++)
+        {
+            GridCell *cell = SpatialGridCell(grid, x, y);
+            for (int k = 0; k < cell->count; k++)
+            {
+                int id = cell->entities[k];
+                Vector2 pos = BoidPosition(task->kin, id);
+                Vector2 vel = BoidVelocity(task->kin, id);
+                cell->classCounts[task->classes[id]]++;
+                cell->positionSum.x += pos.x;
+                cell->positionSum.y += pos.y;
+                cell->velocitySum.x += vel.x;
+                cell->velocitySum.y += vel.y;
+                task->binnedPositions[id] = pos;
+                task->binnedVelocities[id] = vel;
+            }
+        }
+    }
+}
+
+// cellIds (optional) receives each active boid's row-major world cell, or
+// with keyed already holds it and stands in for the positions. Inserted
+// boids' positions and velocities are copied to binnedPositions and
+// binnedVelocities. With an order (active boids, largest radius class first;
+// see RadiusClassSystem) boids are inserted in that order so each cell's list
+// stays sorted by class.
+static void SpatialGridUpdateSystem(SpatialGrid *grid, BoidPool *pool, GridBuildScratch scratch, const BoidKinematics *kin, BoidEntity *ent, int count, bool periodic, int *cellIds, bool keyed, Vector2 *binnedPositions, Vector2 *binnedVelocities, const unsigned char *classes, const int *order, int orderCount)
+{
+    GridBuildTask task = {
+        .grid = grid,
+        .kin = kin,
+        .ent = ent,
+        .classes = classes,
+        .order = order,
+        .items = order ? orderCount : count,
+        .cellIds = cellIds,
+        .keyed = keyed && cellIds,
+        .binnedPositions = binnedPositions,
+        .binnedVelocities = binnedVelocities,
+        .workers = BoidPoolWorkers(pool),
+        .scratch = scratch,
+    };
+    BoidPoolRun(pool, GridCountTask, &task);
+    BoidPoolRun(pool, GridPrefixTask, &task);
+    BoidPoolRun(pool, GridScatterTask, &task);
+    BoidPoolRun(pool, GridSumTask, &task);
+    
+    // Stats from the per-worker parts; truncatedQueries restarts with the build
+    memset(&grid->stats, 0, sizeof(grid->stats));
+    for (int w = 0; w < task.workers; w++)
+    {
+        const SpatialGridStats *part = &scratch.stats[w];
+        grid->stats.droppedInserts += part->droppedInserts;
+        if (part->maxOccupancy > grid->stats.maxOccupancy) grid->stats.maxOccupancy = part->maxOccupancy;
+        for (int b = 0; b < OCCUPANCY_BINS; b++) grid->stats.occupancyHistogram[b] += part->occupancyHistogram[b];
+    }
+    
+    if (periodic) MirrorSpatialGridEdges(grid);
+    BuildGridPyramid(grid);
+}
+
+// ============================================================================
+// NEIGHBOR BUDGET - Caps how many candidates a boid examines per query
+// ============================================================================
+
+// Candidate ids to visit: ids[0], ids[stride], ... ids[(count - 1) * stride].
+// Add offset to their positions: non-zero for periodic ghost cells.
+typedef struct {
+    const int *ids;
+    int count;
+    int stride;
+    Vector2 offset;
+    float sortKey; // Scratch: distance to cell (nearest) or occupancy (stratified)
+} NeighborSpan;
+
+// A query of radius <= BOID_CELL_SIZE overlaps at most this block of cells around
+// the boid's own cell, all inside the ghost ring
+#define NEIGHBOR_STENCIL_CELLS 9
+
+static inline float CellDistanceSqr(Vector2 pos, int x, int y)
+{
+    float dx = fmaxf(fmaxf(x * BOID_CELL_SIZE - pos.x, pos.x - (x + 1) * BOID_CELL_SIZE), 0.0f);
+    float dy = fmaxf(fmaxf(y * BOID_CELL_SIZE - pos.y, pos.y - (y + 1) * BOID_CELL_SIZE), 0.0f);
+    return dx * dx + dy * dy;
+}
+
+// Shift applied to ids found in padded cell (px, py): one world size towards
+// the ghost side, zero for world cells
+static inline Vector2 GhostCellOffset(const SpatialGrid *grid, int px, int py)
+{
+    return (Vector2){
+        (float)(((px == grid->paddedWidth - 1) - (px == 0)) * grid->width * BOID_CELL_SIZE),
+        (float)(((py == grid->paddedHeight - 1) - (py == 0)) * grid->height * BOID_CELL_SIZE),
+    };
+}
+
+static void SortNeighborSpans(NeighborSpan *spans, int count)
+{
+    // Insertion sort: at most nine cells per query
+    for (int a = 1; a < count; a++)
+    {
+        NeighborSpan key = spans[a];
+        int b = a - 1;
+        while (b >= 0 && spans[b].sortKey > key.sortKey)
+        {
+            spans[b + 1] = spans[b];
+            b--;
+        }
+        spans[b + 1] = key;
+    }
+}
+
+// Fills outSpans (capacity NEIGHBOR_STENCIL_CELLS) with the cells to scan for
+// a query of radius <= BOID_CELL_SIZE (larger ones are clamped). Cells
+// within full keep every boid; farther cells only the radius classes that
+// can reach across the gap (a prefix of the cell). budget <= 0 visits every
+// candidate; otherwise at most budget candidates are visited in total, and a
+// query the budget trims bumps *trimmed (if given). pos must be inside the
+// world, as for SpatialGridCellIndex.
+static int GatherNeighborSpans(SpatialGrid *grid, Vector2 pos, float radius, float full, int budget, NeighborBudgetMode mode, NeighborSpan *outSpans, int *trimmed)
+{
+    // Callers pass BoidRadius results; the stencil (and outSpans) only has
+    // room for this much, whatever the params say
+    radius = (radius > 0.0f) ? radius : 0.0f;
+    radius = (radius < BOID_CELL_SIZE) ? radius : BOID_CELL_SIZE;
+    
+    // Padded cell range. pos - radius >= -BOID_CELL_SIZE, so the +1 keeps the
+    // operand non-negative and truncation is a floor; the ghost ring absorbs
+    // the rest, so there is nothing to clamp.
+    int minX = (int)((pos.x - radius) / BOID_CELL_SIZE + 1.0f);
+    int maxX = (int)((pos.x + radius) / BOID_CELL_SIZE + 1.0f);
+    int minY = (int)((pos.y - radius) / BOID_CELL_SIZE + 1.0f);
+    int maxY = (int)((pos.y + radius) / BOID_CELL_SIZE + 1.0f);
+    
+    int spanCount = 0;
+    int candidates = 0;
+    bool trim = full < radius;
+    float fullSqr = full * full;
+    
+    // Row-major storage: each stencil row is a run of adjacent cells
+    for (int py = minY; py <= maxY; py++)
+    {
+        const GridCell *row = &grid->cells[py * grid->paddedWidth];
+        
+        for (int px = minX; px <= maxX; px++)
+        {
+            const GridCell *cell = &row[px];
+            if (cell->count == 0) continue;
+            
+            int n = cell->count;
+            float distSqr = (trim || budget > 0) ? CellDistanceSqr(pos, px - 1, py - 1) : 0.0f;
+            if (trim && distSqr >= fullSqr)
+            {
+                // Class k reaches (k + 1) / BOID_RADIUS_CLASSES cells; the
+                // classes that reach this far are a prefix of the entities
+                n = 0;
+                for (int k = BOID_RADIUS_CLASSES - 1; k >= 0; k--)
+                {
+                    float classReach = (k + 1) * (float)BOID_CELL_SIZE / BOID_RADIUS_CLASSES;
+                    if (distSqr >= classReach * classReach) break;
+                    n += cell->classCounts[k];
+                }
+                if (n == 0) continue;
+            }
+            
+            float key = 0.0f;
+            if (budget > 0) key = (mode == NEIGHBOR_BUDGET_NEAREST) ? distSqr : (float)n;
+            outSpans[spanCount++] = (NeighborSpan){ cell->entities, n, 1, GhostCellOffset(grid, px, py), key };
+            candidates += n;
+        }
+    }
+    
+    if (budget <= 0 || candidates <= budget) return spanCount;
+    if (trimmed) (*trimmed)++;
+    
+    SortNeighborSpans(outSpans, spanCount);
+    
+    if (mode == NEIGHBOR_BUDGET_NEAREST)
+    {
+        int remaining = budget;
+        int kept = 0;
+        while (kept < spanCount && remaining > 0)
+        {
+            NeighborSpan *span = &outSpans[kept++];
+            if (span->count > remaining) span->count = remaining;
+            remaining -= span->count;
+        }
+        return kept;
+    }
+    
+    // Stratified: water-fill from the least occupied cell so quota a small
+    // cell cannot use flows on to the larger ones
+    int remaining = budget;
+    for (int s = 0; s < spanCount; s++)
+    {
+        NeighborSpan *span = &outSpans[s];
+        int quota = remaining / (spanCount - s);
+        if (quota < 1) quota = 1;
+        
+        if (span->count > quota)
+        {
+            span->stride = span->count / quota;
+            span->count = quota;
+        }
+        remaining -= span->count;
+        if (remaining <= 0) return s + 1;
+    }
+    return spanCount;
+}
+
+// ============================================================================
+// NEIGHBOR SOURCES - Grid cells in place, or another broadphase's results
+// ============================================================================
+
+#define NEIGHBOR_SCRATCH 4096 // Initial ids per worker for one boid's broadphase queries
+
+// One worker's broadphase results, grown when a query fills it, and what its
+// queries lost since the last build: truncated and clamped are summed into
+// BoidBroadphaseStats, trimmed into SpatialGridStats.truncatedQueries
+typedef struct {
+    int *ids;
+    int capacity;
+    int truncatedQueries;
+    int clampedQueries;
+    int trimmedQueries;
+} NeighborScratch;
+
+static bool GrowNeighborScratch(NeighborScratch *scratch)
+{
+    if (scratch->capacity > INT_MAX / 2) return false;
+    int *grown = realloc(scratch->ids, (size_t)scratch->capacity * 2 * sizeof(int));
+    if (!grown) return false;
+    scratch->ids = grown;
+    scratch->capacity *= 2;
+    return true;
+}
+
+// What the flocking systems gather candidates from. Without a broadphase the
+// grid's cells are scanned in place; otherwise query results land in this
+// worker's scratch.
+typedef struct {
+    SpatialGrid *grid;
+    const BoidBroadphase *broadphase; // NULL: the grid
+    NeighborScratch *scratch;
+    bool periodic;
+    float width, height;
+} NeighborSource;
+
+// Periodic worlds: a query disc crossing an edge is asked again shifted by
+// one world size per crossed axis; ids found there get offset = shift
+static int QueryImages(const NeighborSource *src, Vector2 pos, float radius, Vector2 *shifts)
+{
+    shifts[0] = (Vector2){ 0, 0 };
+    if (!src->periodic) return 1;
+    
+    float sx = (pos.x < radius) ? -src->width : (pos.x + radius > src->width) ? src->width : 0.0f;
+    float sy = (pos.y < radius) ? -src->height : (pos.y + radius > src->height) ? src->height : 0.0f;
+    int n = 1;
+    if (sx != 0.0f) shifts[n++] = (Vector2){ sx, 0 };
+    if (sy != 0.0f) shifts[n++] = (Vector2){ 0, sy };
+    if (sx != 0.0f && sy != 0.0f) shifts[n++] = (Vector2){ sx, sy };
+    return n;
+}
+
+// One span per image. The budget takes the nearest across all images, which
+// is what both budget modes approximate on the grid; past
+// BOID_BROADPHASE_MAX_K it is capped, and counted. Adds the index's own
+// distance tests to *tests.
+static int GatherBroadphaseSpans(const NeighborSource *src, Vector2 pos, float radius, int budget, NeighborSpan *outSpans, int *tests)
+{
+    NeighborScratch *scratch = src->scratch;
+    Vector2 shifts[4];
+    int images = QueryImages(src, pos, radius, shifts);
+    
+    if (budget <= 0)
+    {
+        // A query that fills the ids may have been cut short: grow them and
+        // ask again. Spans point into the ids once they have stopped moving.
+        int starts[4];
+        int used = 0;
+        for (int m = 0; m < images; m++)
+        {
+            Vector2 at = Vector2Subtract(pos, shifts[m]);
+            int n;
+            for (;;)
+            {
+                int room = scratch->capacity - used;
+                n = BoidBroadphaseQueryRadius(src->broadphase, at, radius, scratch->ids + used, room, tests);
+                if (n < room) break;
+                if (!GrowNeighborScratch(scratch))
+                {
+                    scratch->truncatedQueries++;
+                    break;
+                }
+            }
+            starts[m] = used;
+            outSpans[m] = (NeighborSpan){ NULL, n, 1, shifts[m], 0.0f };
+            used += n;
+        }
+        for (int m = 0; m < images; m++) outSpans[m].ids = scratch->ids + starts[m];
+        return images;
+    }
+    
+    if (budget > BOID_BROADPHASE_MAX_K) scratch->clampedQueries++;
+    BoidNearestSet set;
+    BoidNearestSetInit(&set, budget, radius);
+    for (int m = 0; m < images; m++)
+    {
+        set.image = m;
+        BoidBroadphaseQueryNearest(src->broadphase, Vector2Subtract(pos, shifts[m]), &set);
+    }
+    *tests += set.tests;
+    
+    // Group by image into the scratch, which always has room for k ids
+    int used = 0;
+    for (int m = 0; m < images; m++)
+    {
+        int start = used;
+        for (int e = 0; e < set.count; e++)
+        {
+            if (set.images[e] == m) scratch->ids[used++] = set.ids[e];
+        }
+        outSpans[m] = (NeighborSpan){ scratch->ids + start, used - start, 1, shifts[m], 0.0f };
+    }
+    return images;
+}
+
+// GatherNeighborSpans through whichever index src has. *tests gets the
+// index's own distance tests; the grid makes none, its cells are the spans.
+static inline int GatherNeighbors(const NeighborSource *src, Vector2 pos, float radius, float full, int budget, NeighborBudgetMode mode, NeighborSpan *outSpans, int *tests)
+{
+    if (!src->broadphase) return GatherNeighborSpans(src->grid, pos, radius, full, budget, mode, outSpans, &src->scratch->trimmedQueries);
+    return GatherBroadphaseSpans(src, pos, radius, budget, outSpans, tests);
+}
+
+// ============================================================================
+// WORLD - Struct of Arrays
+// ============================================================================
+
+struct BoidWorld {
+    int capacity;
+    int count;
+    int width, height;
+    
+    // Backs the arrays below and the grid cells. Worker w of the pool owns
+    // the same slice of them (WorkerSlice) on every run.
+    BoidArena arena;
+    BoidPageMode pages; // As requested; arena.pages is what was obtained
+    BoidPool *pool;
+    
+    // Systems read positions and velocities through kin. Under AoSoA the
+    // Vector2 arrays are host copies, refreshed at the end of each step.
+    BoidKinematics kin;
+    BoidEntity *entities;
+    Vector2 *positions;
+    Vector2 *velocities;
+    Vector2 *accelerations;
+    BoidColor *colors;
+    
+    SpatialGrid grid;
+    BoidParams params;
+    uint64_t rngState;
+    uint64_t tick;
+    
+    // Obstacles as added; the BVH is rebuilt from them when dirty
+    ObstacleSegment *obstacleList;
+    int obstacleCount;
+    int obstacleCapacity;
+    ObstacleBvh obstacles;
+    bool obstaclesDirty;
+    
+    // Goals: per-boid ids into flowFields; blocked mirrors the obstacles per cell
+    int *goalIds;
+    FlowField *flowFields;
+    int goalCount;
+    int goalCapacity;
+    unsigned char *blocked;
+    bool blockedDirty;
+    
+    // Cell of each boid from the last grid build; zones are created with the
+    // first one added. cellKeysValid: a fused pass has since rewritten them
+    // for the positions it produced, and the next build reads them instead.
+    int *cellIds;
+    bool cellKeysValid;
+    ZoneSet *zones;
+    
+    // What each boid was binned with in the last grid build, so that
+    // aggregate queries test boundary boids against the same state the cell
+    // sums were taken from
+    Vector2 *binnedPositions;
+    Vector2 *binnedVelocities;
+    
+    // Fused pipeline: each pass writes the next state here and swaps it with
+    // kin. SoA builds swap back to the host arrays at the end of the step.
+    BoidKinematics kinBack;
+    Vector2 *backPositions;
+    Vector2 *backVelocities;
+    
+    // Per-boid radius multipliers, their classes and the class-sorted order
+    // (binCount == 0: one class, natural order) from the last grid build
+    float *radiusScales;
+    unsigned char *radiusClasses;
+    int *binOrder;
+    int binCount;
+    float maxRadiusScale;
+    bool radiiUniform;
+    
+    // Distance tests each boid cost in the last flocking pass (the ids the
+    // systems went through plus the index's own tests), and the flocking
+    // tasks cut from them: [taskBounds[t], taskBounds[t + 1])
+    // queued on taskOwners[t]
+    int *candidates;
+    int *taskBounds;
+    int *taskOwners;
+    int taskCount;
+    
+    // Rebuilt after the grid each substep; the flocking systems only go
+    // through it when it is not the grid itself
+    BoidBroadphase *broadphase;
+    bool broadphaseReady; // Last build succeeded; the grid stands in otherwise
+    NeighborScratch *neighborScratch; // One per worker
+    GridBuildScratch gridScratch;
+};
+
+#define STEAL_TASKS_PER_WORKER 8 // Flocking tasks per worker at average density
+#define STEAL_TASK_ALIGN 16 // Boids; task edges never split a cache line of acc or candidates
+
+// Worker w's share of the live boids: its slice of the capacity, clipped to
+// the count, so it always runs on the pages it first touched
+static void WorkerSlice(const BoidWorld *world, int worker, int *begin, int *end)
+{
+    BoidPoolSlice(world->capacity, BoidPoolWorkers(world->pool), worker, WORKER_SLICE_ALIGN, begin, end);
+    if (*end > world->count) *end = world->count;
+    if (*begin > *end) *begin = *end;
+}
+
+BoidParams BoidDefaultParams(void)
+{
+    return (BoidParams){
+        .perceptionRadius = 20.0f,
+        .separationRadius = 10.0f,
+        .maxSpeed = 5.0f,
+        .maxForce = 0.7f,
+        .separationWeight = 3.0f,
+        .alignmentWeight = 1.0f,
+        .cohesionWeight = 0.5f,
+        .maxNeighbors = 0,
+        .neighborBudgetMode = NEIGHBOR_BUDGET_NEAREST,
+        .substeps = 1,
+        .periodic = true,
+        .obstacleLookahead = 30.0f,
+        .avoidanceWeight = 4.0f,
+        .goalWeight = 1.0f,
+        .flowFieldBudget = 512,
+        .radiusPolicy = BOID_RADIUS_OWN,
+        .fusedPipeline = false,
+    };
+}
+
+BoidWorldConfig BoidDefaultConfig(void)
+{
+    return (BoidWorldConfig){
+        .capacity = 8000,
+        .width = 2560,
+        .height = 1440,
+        .seed = 1234,
+        .params = BoidDefaultParams(),
+        .workers = 1,
+        .pages = BOID_PAGES_DEFAULT,
+        .broadphase = BOID_BROADPHASE_GRID,
+    };
+}
+
+// Every per-boid array and the grid cells, in one arena; with a measuring
+// arena this only adds up the sizes
+static void CarveWorldArrays(BoidWorld *world, BoidArena *arena)
+{
+    size_t n = world->capacity;
+    world->entities = BoidArenaTake(arena, n * sizeof(BoidEntity));
+    world->positions = BoidArenaTake(arena, n * sizeof(Vector2));
+    world->velocities = BoidArenaTake(arena, n * sizeof(Vector2));
+    world->accelerations = BoidArenaTake(arena, n * sizeof(Vector2));
+    world->colors = BoidArenaTake(arena, n * sizeof(BoidColor));
+    world->goalIds = BoidArenaTake(arena, n * sizeof(int));
+    world->cellIds = BoidArenaTake(arena, n * sizeof(int));
+    world->binnedPositions = BoidArenaTake(arena, n * sizeof(Vector2));
+    world->binnedVelocities = BoidArenaTake(arena, n * sizeof(Vector2));
+    world->radiusScales = BoidArenaTake(arena, n * sizeof(float));
+    world->radiusClasses = BoidArenaTake(arena, n);
+    world->binOrder = BoidArenaTake(arena, n * sizeof(int));
+    world->candidates = BoidArenaTake(arena, n * sizeof(int));
+#if BOID_AOSOA_LANES
+    world->kin.blocks = BoidArenaTake(arena, (n + BOID_AOSOA_LANES - 1) / BOID_AOSOA_LANES * sizeof(BoidBlock));
+    world->kinBack.blocks = BoidArenaTake(arena, (n + BOID_AOSOA_LANES - 1) / BOID_AOSOA_LANES * sizeof(BoidBlock));
+#else
+    world->backPositions = BoidArenaTake(arena, n * sizeof(Vector2));
+    world->backVelocities = BoidArenaTake(arena, n * sizeof(Vector2));
+    world->kin = (BoidKinematics){ world->positions, world->velocities };
+    world->kinBack = (BoidKinematics){ world->backPositions, world->backVelocities };
+#endif
+    world->grid.cells = BoidArenaTake(arena, (size_t)world->grid.paddedWidth * world->grid.paddedHeight * sizeof(GridCell));
+}
+
+static inline void TouchSlice(void *array, size_t elementSize, int begin, int end)
+{
+    memset((unsigned char *)array + begin * elementSize, 0, (end - begin) * elementSize);
+}
+
+// Each worker zeroes the slices it runs, which places them on its NUMA node
+// for good once the pool is pinned (BoidWorldConfig.pinWorkers)
+static void FirstTouchTask(void *context, int worker)
+{
+    BoidWorld *world = context;
+    int workers = BoidPoolWorkers(world->pool);
+    int begin, end;
+    BoidPoolSlice(world->capacity, workers, worker, WORKER_SLICE_ALIGN, &begin, &end);
+    
+    TouchSlice(world->entities, sizeof(BoidEntity), begin, end);
+    TouchSlice(world->positions, sizeof(Vector2), begin, end);
+    TouchSlice(world->velocities, sizeof(Vector2), begin, end);
+    TouchSlice(world->accelerations, sizeof(Vector2), begin, end);
+    TouchSlice(world->colors, sizeof(BoidColor), begin, end);
+    TouchSlice(world->goalIds, sizeof(int), begin, end);
+    TouchSlice(world->cellIds, sizeof(int), begin, end);
+    TouchSlice(world->binnedPositions, sizeof(Vector2), begin, end);
+    TouchSlice(world->binnedVelocities, sizeof(Vector2), begin, end);
+    TouchSlice(world->radiusScales, sizeof(float), begin, end);
+    TouchSlice(world->radiusClasses, 1, begin, end);
+    TouchSlice(world->binOrder, sizeof(int), begin, end);
+    TouchSlice(world->candidates, sizeof(int), begin, end);
+#if BOID_AOSOA_LANES
+    // Slices start on a block; the last one may end inside one
+    TouchSlice(world->kin.blocks, sizeof(BoidBlock), begin / BOID_AOSOA_LANES, (end + BOID_AOSOA_LANES - 1) / BOID_AOSOA_LANES);
+    TouchSlice(world->kinBack.blocks, sizeof(BoidBlock), begin / BOID_AOSOA_LANES, (end + BOID_AOSOA_LANES - 1) / BOID_AOSOA_LANES);
+#else
+    TouchSlice(world->backPositions, sizeof(Vector2), begin, end);
+    TouchSlice(world->backVelocities, sizeof(Vector2), begin, end);
+#endif
+
+    int rowBegin, rowEnd;
+    BoidPoolSlice(world->grid.paddedHeight, workers, worker, 1, &rowBegin, &rowEnd);
+    TouchSlice(world->grid.cells, world->grid.paddedWidth * sizeof(GridCell), rowBegin, rowEnd);
+}
+
+BoidWorld *BoidWorldCreate(const BoidWorldConfig *config)
+{
+    if (config->capacity <= 0 || config->width <= 0 || config->height <= 0) return NULL;
+    if (config->width % BOID_CELL_SIZE != 0 || config->height % BOID_CELL_SIZE != 0) return NULL;
+    
+    BoidWorld *world = calloc(1, sizeof(BoidWorld));
+    if (!world) return NULL;
+    
+    int n = config->capacity;
+    world->capacity = n;
+    world->width = config->width;
+    world->height = config->height;
+    world->params = config->params;
+    world->rngState = config->seed;
+    world->pages = config->pages;
+    
+    bool gridOk = InitSpatialGrid(&world->grid, world->width, world->height);
+    BoidArena measure = BoidArenaMeasure();
+    CarveWorldArrays(world, &measure);
+    bool arenaOk = gridOk && BoidArenaInit(&world->arena, measure.used, config->pages);
+    if (arenaOk) CarveWorldArrays(world, &world->arena);
+    world->pool = BoidPoolCreate(config->workers, config->pinWorkers);
+    world->blocked = calloc((size_t)world->grid.width * world->grid.height, 1);
+    
+    // At most STEAL_TASKS_PER_WORKER per worker by weight, plus one partial
+    // task at the end of each worker's slice
+    int maxTasks = world->pool ? BoidPoolWorkers(world->pool) * (STEAL_TASKS_PER_WORKER + 1) : 0;
+    world->taskBounds = malloc((maxTasks + 1) * sizeof(int));
+    world->taskOwners = malloc((maxTasks + 1) * sizeof(int));
+    world->broadphase = BoidBroadphaseCreate(config->broadphase, &world->grid, n);
+    int workers = world->pool ? BoidPoolWorkers(world->pool) : 0;
+    world->neighborScratch = calloc(workers, sizeof(NeighborScratch));
+    bool scratchOk = world->neighborScratch != NULL;
+    for (int w = 0; scratchOk && w < workers; w++)
+    {
+        world->neighborScratch[w].ids = malloc(NEIGHBOR_SCRATCH * sizeof(int));
+        world->neighborScratch[w].capacity = NEIGHBOR_SCRATCH;
+        scratchOk = world->neighborScratch[w].ids != NULL;
+    }
+    world->gridScratch.counts = malloc((size_t)workers * world->grid.width * world->grid.height * sizeof(int));
+    world->gridScratch.stats = malloc((size_t)workers * sizeof(SpatialGridStats));
+    world->gridScratch.dropped = malloc((size_t)n * sizeof(int));
+    world->gridScratch.droppedStart = calloc(workers, sizeof(int));
+    world->gridScratch.droppedCount = calloc(workers, sizeof(int)); // Nothing dropped before the first build
+    
+    if (!arenaOk || !world->pool || !world->blocked || !world->taskBounds || !world->taskOwners || !world->broadphase || !scratchOk || !world->gridScratch.counts || !world->gridScratch.stats ||
+        !world->gridScratch.dropped || !world->gridScratch.droppedStart || !world->gridScratch.droppedCount)
+    {
+        BoidWorldDestroy(world);
+        return NULL;
+    }
+    
+    BoidPoolRun(world->pool, FirstTouchTask, world);
+    return world;
+}
+
+void BoidWorldDestroy(BoidWorld *world)
+{
+    if (!world) return;
+    
+    int workers = world->pool ? BoidPoolWorkers(world->pool) : 0;
+    for (int w = 0; world->neighborScratch && w < workers; w++) free(world->neighborScratch[w].ids);
+    BoidPoolDestroy(world->pool);
+    BoidArenaFree(&world->arena);
+    FreeSpatialGrid(&world->grid);
+    free(world->obstacleList);
+    ObstacleBvhFree(&world->obstacles);
+    for (int g = 0; g < world->goalCount; g++) FlowFieldFree(&world->flowFields[g]);
+    free(world->flowFields);
+    free(world->blocked);
+    free(world->taskBounds);
+    free(world->taskOwners);
+    BoidBroadphaseDestroy(world->broadphase);
+    free(world->neighborScratch);
+    free(world->gridScratch.counts);
+    free(world->gridScratch.stats);
+    free(world->gridScratch.dropped);
+    free(world->gridScratch.droppedStart);
+    free(world->gridScratch.droppedCount);
+    ZoneSetDestroy(world->zones);
+    free(world);
+}
+
+int BoidWorldAddBoid(BoidWorld *world, Vector2 position, Vector2 velocity, BoidColor color)
+{
+    if (world->count >= world->capacity) return -1;
+    
+    int id = world->count;
+    position.x = WrapCoordinate(position.x, (float)world->width);
+    position.y = WrapCoordinate(position.y, (float)world->height);
+    world->entities[id].active = true;
+    world->positions[id] = position;
+    world->velocities[id] = velocity;
+    SetBoidPosition(&world->kin, id, position);
+    SetBoidVelocity(&world->kin, id, velocity);
+    world->accelerations[id] = (Vector2){ 0, 0 };
+    world->colors[id] = color;
+    world->goalIds[id] = -1;
+    world->radiusScales[id] = 1.0f;
+    world->cellKeysValid = false;
+    
+    world->count++;
+    return id;
+}
+
+void BoidWorldSpawnRandom(BoidWorld *world, int count, int border)
+{
+    uint64_t *rng = &world->rngState;
+    
+    for (int i = 0; i < count; i++)
+    {
+        Vector2 pos = {
+            RandomRange(rng, border, world->width - border - 1) * 1.0f,
+            RandomRange(rng, border, world->height - border - 1) * 1.0f,
+        };
+        
+        Vector2 vel = {
+            RandomRange(rng, -4, 4) * 0.25f,
+            RandomRange(rng, -4, 4) * 0.25f,
+        };
+        
+        if (BoidWorldAddBoid(world, pos, vel, RandomPaletteColor(rng)) < 0) return;
+    }
+}
+
+bool BoidWorldAddObstacle(BoidWorld *world, Vector2 a, Vector2 b)
+{
+    if (world->obstacleCount == world->obstacleCapacity)
+    {
+        int capacity = world->obstacleCapacity ? world->obstacleCapacity * 2 : 16;
+        ObstacleSegment *list = realloc(world->obstacleList, capacity * sizeof(ObstacleSegment));
+        if (!list) return false;
+        world->obstacleList = list;
+        world->obstacleCapacity = capacity;
+    }
+    
+    world->obstacleList[world->obstacleCount++] = (ObstacleSegment){ a, b };
+    world->obstaclesDirty = true;
+    world->blockedDirty = true;
+    return true;
+}
+
+int BoidWorldAddGoal(BoidWorld *world, Vector2 target)
+{
+    if (world->goalCount == world->goalCapacity)
+    {
+        int capacity = world->goalCapacity ? world->goalCapacity * 2 : 4;
+        FlowField *fields = realloc(world->flowFields, capacity * sizeof(FlowField));
+        if (!fields) return -1;
+        world->flowFields = fields;
+        world->goalCapacity = capacity;
+    }
+    
+    FlowField *field = &world->flowFields[world->goalCount];
+    if (!FlowFieldInit(field, world->grid.width, world->grid.height, BOID_CELL_SIZE)) return -1;
+    FlowFieldRequest(field, target);
+    return world->goalCount++;
+}
+
+void BoidWorldMoveGoal(BoidWorld *world, int goal, Vector2 target)
+{
+    if (goal < 0 || goal >= world->goalCount) return;
+    FlowFieldRequest(&world->flowFields[goal], target);
+}
+
+static int AddZone(BoidWorld *world, BoidZone zone)
+{
+    if (!world->zones)
+    {
+        world->zones = ZoneSetCreate(world->grid.width, world->grid.height, BOID_CELL_SIZE, world->capacity);
+        if (!world->zones) return -1;
+    }
+    return ZoneSetAdd(world->zones, zone);
+}
+
+int BoidWorldAddZoneRect(BoidWorld *world, Vector2 min, Vector2 max)
+{
+    return AddZone(world, (BoidZone){ .shape = BOID_ZONE_RECT, .min = min, .max = max });
+}
+
+int BoidWorldAddZoneCircle(BoidWorld *world, Vector2 center, float radius)
+{
+    return AddZone(world, (BoidZone){ .shape = BOID_ZONE_CIRCLE, .center = center, .radius = radius });
+}
+
+bool BoidWorldAddObstaclePolygon(BoidWorld *world, const Vector2 *vertices, int vertexCount)
+{
+    for (int v = 0; v < vertexCount; v++)
+    {
+        if (!BoidWorldAddObstacle(world, vertices[v], vertices[(v + 1) % vertexCount])) return false;
+    }
+    return true;
+}
+
+// ============================================================================
+// PER-BOID RADII - Scaled radii, radius classes and the interaction policy
+// ============================================================================
+
+static inline float BoidRadius(float base, float scale)
+{
+    // Ternaries, not fminf/fmaxf: those are libm calls without fast-math
+    float r = base * scale;
+    r = (r > 0.0f) ? r : 0.0f;
+    return (r < BOID_CELL_SIZE) ? r : BOID_CELL_SIZE;
+}
+
+static inline float PairRadius(BoidRadiusPolicy policy, float own, float other)
+{
+    if (policy == BOID_RADIUS_MIN) return (other < own) ? other : own;
+    if (policy == BOID_RADIUS_MAX) return (other > own) ? other : own;
+    return own;
+}
+
+// Cells to scan for a boid of this radius (reach), and how far every boid in
+// them can matter (full); beyond that only larger radius classes can
+static inline void QueryExtent(BoidRadiusPolicy policy, float radius, float maxRadius, float *reach, float *full)
+{
+    *reach = (policy == BOID_RADIUS_MAX) ? maxRadius : radius;
+    *full = (policy == BOID_RADIUS_MIN) ? 0.0f : radius;
+}
+
+static inline int RadiusClass(float radius)
+{
+    int c = (int)(radius * BOID_RADIUS_CLASSES / BOID_CELL_SIZE);
+    return (c < BOID_RADIUS_CLASSES) ? c : BOID_RADIUS_CLASSES - 1;
+}
+
+// Classes from the larger base radius, so one class bound serves both
+// queries. Boids are ordered largest class first for the grid build; with a
+// single class the natural order already is, and with a single scale every
+// policy reduces to BOID_RADIUS_OWN.
+static void RadiusClassSystem(BoidWorld *world)
+{
+    BoidParams params = world->params;
+    float base = fmaxf(params.perceptionRadius, params.separationRadius);
+    const float *scales = world->radiusScales;
+    int count = world->count;
+    
+    float minScale = FLT_MAX, maxScale = 0.0f;
+    for (int i = 0; i < count; i++)
+    {
+        float s = scales[i];
+        minScale = (s < minScale) ? s : minScale;
+        maxScale = (s > maxScale) ? s : maxScale;
+    }
+    world->maxRadiusScale = maxScale;
+    world->radiiUniform = (minScale >= maxScale);
+    world->binCount = 0;
+    
+    int lowest = RadiusClass(BoidRadius(base, minScale));
+    int highest = RadiusClass(BoidRadius(base, maxScale));
+    if (lowest == highest)
+    {
+        memset(world->radiusClasses, highest, count);
+        return;
+    }
+    
+    // Counting sort, descending by class, stable within a class
+    int counts[BOID_RADIUS_CLASSES] = { 0 };
+    for (int i = 0; i < count; i++)
+    {
+        int c = RadiusClass(BoidRadius(base, scales[i]));
+        world->radiusClasses[i] = (unsigned char)c;
+        counts[c] += world->entities[i].active;
+    }
+    
+    int start[BOID_RADIUS_CLASSES];
+    int offset = 0;
+    for (int c = BOID_RADIUS_CLASSES - 1; c >= 0; c--)
+    {
+        start[c] = offset;
+        offset += counts[c];
+    }
+    for (int i = 0; i < count; i++)
+    {
+        if (world->entities[i].active) world->binOrder[start[world->radiusClasses[i]]++] = i;
+    }
+    world->binCount = offset;
+}
+
+// Grid from the current positions, binned by radius class
+static void RebuildGrid(BoidWorld *world, int *cellIds)
+{
+    RadiusClassSystem(world);
+    SpatialGridUpdateSystem(&world->grid, world->pool, world->gridScratch, &world->kin, world->entities, world->count, world->params.periodic, cellIds, world->cellKeysValid, world->binnedPositions, world->binnedVelocities, world->radiusClasses, world->binCount ? world->binOrder : NULL, world->binCount);
+}
+
+// ============================================================================
+// BOID SYSTEMS - Flocking behavior (with spatial partitioning)
+// ============================================================================
+
+// Each rule has a per-boid form, false when boid i has no neighbors for it,
+// shared by its system below and the fused pass (FUSED PIPELINE)
+static inline bool SeparationSteering(const NeighborSource *src, const BoidKinematics *kin, const BoidEntity *ent, int i, const float *scales, float maxScale, int *candidates, BoidParams params, Vector2 *out)
+{
+    NeighborSpan spans[NEIGHBOR_STENCIL_CELLS];
+    BoidRadiusPolicy policy = params.radiusPolicy;
+    
+    Vector2 self = BoidPosition(kin, i);
+    Vector2 steering = { 0, 0 };
+    int total = 0;
+    
+    // Walk the cells overlapping the separation radius in place
+    float radius = BoidRadius(params.separationRadius, scales[i]);
+    float reach, full;
+    QueryExtent(policy, radius, BoidRadius(params.separationRadius, maxScale), &reach, &full);
+    int tests = 0;
+    int spanCount = GatherNeighbors(src, self, reach, full, params.maxNeighbors, params.neighborBudgetMode, spans, &tests);
+    if (candidates) candidates[i] += tests;
+    
+    for (int s = 0; s < spanCount; s++)
+    {
+        NeighborSpan span = spans[s];
+        if (candidates) candidates[i] += span.count;
+        
+        for (int k = 0; k < span.count; k++)
+        {
+            int j = span.ids[k * span.stride];
+            if (i == j || !ent[j].active) continue;
+            
+            Vector2 other = Vector2Add(BoidPosition(kin, j), span.offset);
+            float dist = Vector2Distance(self, other);
+            float pairRadius = (policy == BOID_RADIUS_OWN) ? radius : PairRadius(policy, radius, BoidRadius(params.separationRadius, scales[j]));
+            
+            if (dist < pairRadius && dist > 0)
+            {
+                Vector2 diff = Vector2Subtract(self, other);
+                diff.x /= dist;
+                diff.y /= dist;
+                
+                steering = Vector2Add(steering, diff);
+                total++;
+            }
+        }
+    }
+    
+    if (total == 0) return false;
+    
+    steering.x /= total;
+    steering.y /= total;
+    
+    steering = Vector2SetMag(steering, params.maxSpeed);
+    steering = Vector2Subtract(steering, BoidVelocity(kin, i));
+    steering = Vector2Limit(steering, params.maxForce);
+    
+    steering.x *= params.separationWeight;
+    steering.y *= params.separationWeight;
+    *out = steering;
+    return true;
+}
+
+static void BoidSeparationSystem(const NeighborSource *src, const BoidKinematics *kin, Vector2 *acc, BoidEntity *ent, int begin, int end, const float *scales, float maxScale, int *candidates, BoidParams params)
+{
+    for (int i = begin; i < end; i++)
+    {
+        if (!ent[i].active) continue;
+        
+        Vector2 steering;
+        if (SeparationSteering(src, kin, ent, i, scales, maxScale, candidates, params, &steering)) acc[i] = Vector2Add(acc[i], steering);
+    }
+}
+
+static inline bool AlignmentSteering(const NeighborSource *src, const BoidKinematics *kin, const BoidEntity *ent, int i, const float *scales, float maxScale, int *candidates, BoidParams params, Vector2 *out)
+{
+    NeighborSpan spans[NEIGHBOR_STENCIL_CELLS];
+    BoidRadiusPolicy policy = params.radiusPolicy;
+    
+    Vector2 self = BoidPosition(kin, i);
+    Vector2 steering = { 0, 0 };
+    int total = 0;
+    
+    float radius = BoidRadius(params.perceptionRadius, scales[i]);
+    float reach, full;
+    QueryExtent(policy, radius, BoidRadius(params.perceptionRadius, maxScale), &reach, &full);
+    int tests = 0;
+    int spanCount = GatherNeighbors(src, self, reach, full, params.maxNeighbors, params.neighborBudgetMode, spans, &tests);
+    if (candidates) candidates[i] += tests;
+    
+    for (int s = 0; s < spanCount; s++)
+    {
+        NeighborSpan span = spans[s];
+        if (candidates) candidates[i] += span.count;
+        
+        for (int k = 0; k < span.count; k++)
+        {
+            int j = span.ids[k * span.stride];
+            if (i == j || !ent[j].active) continue;
+            
+            float dist = Vector2Distance(self, Vector2Add(BoidPosition(kin, j), span.offset));
+            float pairRadius = (policy == BOID_RADIUS_OWN) ? radius : PairRadius(policy, radius, BoidRadius(params.perceptionRadius, scales[j]));
+            
+            if (dist < pairRadius)
+            {
+                steering = Vector2Add(steering, BoidVelocity(kin, j));
+                total++;
+            }
+        }
+    }
+    
+    if (total == 0) return false;
+    
+    steering.x /= total;
+    steering.y /= total;
+    
+    steering = Vector2SetMag(steering, params.maxSpeed);
+    steering = Vector2Subtract(steering, BoidVelocity(kin, i));
+    steering = Vector2Limit(steering, params.maxForce);
+    
+    steering.x *= params.alignmentWeight;
+    steering.y *= params.alignmentWeight;
+    *out = steering;
+    return true;
+}
+
+static void BoidAlignmentSystem(const NeighborSource *src, const BoidKinematics *kin, Vector2 *acc, BoidEntity *ent, int begin, int end, const float *scales, float maxScale, int *candidates, BoidParams params)
+{
+    for (int i = begin; i < end; i++)
+    {
+        if (!ent[i].active) continue;
+        
+        Vector2 steering;
+        if (AlignmentSteering(src, kin, ent, i, scales, maxScale, candidates, params, &steering)) acc[i] = Vector2Add(acc[i], steering);
+    }
+}
+
+static inline bool CohesionSteering(const NeighborSource *src, const BoidKinematics *kin, const BoidEntity *ent, int i, const float *scales, float maxScale, int *candidates, BoidParams params, Vector2 *out)
+{
+    NeighborSpan spans[NEIGHBOR_STENCIL_CELLS];
+    BoidRadiusPolicy policy = params.radiusPolicy;
+    
+    Vector2 self = BoidPosition(kin, i);
+    Vector2 steering = { 0, 0 };
+    int total = 0;
+    
+    float radius = BoidRadius(params.perceptionRadius, scales[i]);
+    float reach, full;
+    QueryExtent(policy, radius, BoidRadius(params.perceptionRadius, maxScale), &reach, &full);
+    int tests = 0;
+    int spanCount = GatherNeighbors(src, self, reach, full, params.maxNeighbors, params.neighborBudgetMode, spans, &tests);
+    if (candidates) candidates[i] += tests;
+    
+    for (int s = 0; s < spanCount; s++)
+    {
+        NeighborSpan span = spans[s];
+        if (candidates) candidates[i] += span.count;
+        
+        for (int k = 0; k < span.count; k++)
+        {
+            int j = span.ids[k * span.stride];
+            if (i == j || !ent[j].active) continue;
+            
+            Vector2 other = Vector2Add(BoidPosition(kin, j), span.offset);
+            float dist = Vector2Distance(self, other);
+            float pairRadius = (policy == BOID_RADIUS_OWN) ? radius : PairRadius(policy, radius, BoidRadius(params.perceptionRadius, scales[j]));
+            
+            if (dist < pairRadius)
+            {
+                steering = Vector2Add(steering, other);
+                total++;
+            }
+        }
+    }
+    
+    if (total == 0) return false;
+    
+    steering.x /= total;
+    steering.y /= total;
+    
+    steering = Vector2Subtract(steering, self);
+    steering = Vector2SetMag(steering, params.maxSpeed);
+    steering = Vector2Subtract(steering, BoidVelocity(kin, i));
+    steering = Vector2Limit(steering, params.maxForce);
+    
+    steering.x *= params.cohesionWeight;
+    steering.y *= params.cohesionWeight;
+    *out = steering;
+    return true;
+}
+
+static void BoidCohesionSystem(const NeighborSource *src, const BoidKinematics *kin, Vector2 *acc, BoidEntity *ent, int begin, int end, const float *scales, float maxScale, int *candidates, BoidParams params)
+{
+    for (int i = begin; i < end; i++)
+    {
+        if (!ent[i].active) continue;
+        
+        Vector2 steering;
+        if (CohesionSteering(src, kin, ent, i, scales, maxScale, candidates, params, &steering)) acc[i] = Vector2Add(acc[i], steering);
+    }
+}
+
+// Steer straight away from the wall, harder the closer it is
+static inline Vector2 ObstacleSteering(ObstacleHit hit, Vector2 vel, BoidParams params)
+{
+    Vector2 steering = Vector2Scale(hit.normal, params.maxSpeed);
+    steering = Vector2Subtract(steering, vel);
+    steering = Vector2Limit(steering, params.maxForce);
+    
+    float strength = 1.0f - hit.distance / params.obstacleLookahead;
+    return Vector2Scale(steering, params.avoidanceWeight * strength);
+}
+
+static inline bool ObstaclesActive(const ObstacleBvh *bvh, BoidParams params)
+{
+    return bvh->segmentCount > 0 && params.avoidanceWeight != 0 && params.obstacleLookahead > 0;
+}
+
+// Boids are batched per grid cell, so each BVH traversal serves neighbors that
+// see the same geometry; boids the grid build dropped from full cells, which
+// is where dense flocks meet walls, are then queried one at a time
+static void ObstacleAvoidanceSystem(const ObstacleBvh *bvh, SpatialGrid *grid, const BoidKinematics *kin, Vector2 *acc, int rowBegin, int rowEnd, const int *dropped, int droppedCount, BoidParams params)
+{
+    ObstacleHit hits[MAX_ENTITIES_PER_CELL];
+#if BOID_AOSOA_LANES
+    // The batch reads Vector2 positions by id: gather each cell's into lanes
+    Vector2 cellPos[MAX_ENTITIES_PER_CELL];
+    int lanes[MAX_ENTITIES_PER_CELL];
+    for (int k = 0; k < MAX_ENTITIES_PER_CELL; k++) lanes[k] = k;
+#endif
+
+    for (int y = rowBegin; y < rowEnd; y++)
+    {
+        for (int x = 0; x < grid->width; x++)
+        {
+            GridCell *cell = SpatialGridCell(grid, x, y);
+            if (cell->count == 0) continue;
+
+#if BOID_AOSOA_LANES
+            for (int k = 0; k < cell->count; k++) cellPos[k] = BoidPosition(kin, cell->entities[k]);
+            ObstacleBvhNearestBatch(bvh, cellPos, lanes, cell->count, params.obstacleLookahead, hits);
+#else
+            ObstacleBvhNearestBatch(bvh, kin->positions, cell->entities, cell->count, params.obstacleLookahead, hits);
+#endif
+
+            for (int k = 0; k < cell->count; k++)
+            {
+                if (hits[k].segment < 0) continue;
+                int i = cell->entities[k];
+                acc[i] = Vector2Add(acc[i], ObstacleSteering(hits[k], BoidVelocity(kin, i), params));
+            }
+        }
+    }
+    
+    for (int d = 0; d < droppedCount; d++)
+    {
+        int i = dropped[d];
+        Vector2 pos = BoidPosition(kin, i);
+        int self = 0;
+        ObstacleBvhNearestBatch(bvh, &pos, &self, 1, params.obstacleLookahead, hits);
+        if (hits[0].segment >= 0) acc[i] = Vector2Add(acc[i], ObstacleSteering(hits[0], BoidVelocity(kin, i), params));
+    }
+}
+
+// O(1) per boid: one cell lookup in its goal's field
+static inline bool GoalSteering(const FlowField *fields, const int *goalIds, const BoidKinematics *kin, int i, BoidParams params, Vector2 *out)
+{
+    if (goalIds[i] < 0) return false;
+    
+    Vector2 direction = FlowFieldSample(&fields[goalIds[i]], BoidPosition(kin, i));
+    if (direction.x == 0 && direction.y == 0) return false;
+    
+    Vector2 steering = Vector2Scale(direction, params.maxSpeed);
+    steering = Vector2Subtract(steering, BoidVelocity(kin, i));
+    steering = Vector2Limit(steering, params.maxForce);
+    *out = Vector2Scale(steering, params.goalWeight);
+    return true;
+}
+
+static void GoalSeekingSystem(const FlowField *fields, const int *goalIds, const BoidKinematics *kin, Vector2 *acc, BoidEntity *ent, int begin, int end, BoidParams params)
+{
+    if (params.goalWeight == 0) return;
+    
+    for (int i = begin; i < end; i++)
+    {
+        if (!ent[i].active) continue;
+        
+        Vector2 steering;
+        if (GoalSteering(fields, goalIds, kin, i, params, &steering)) acc[i] = Vector2Add(acc[i], steering);
+    }
+}
+
+// Advances every field rebuild by its budget, restarting them all first if
+// the obstacles changed
+static void FlowFieldSystem(BoidWorld *world, int budget)
+{
+    if (world->blockedDirty)
+    {
+        FlowFieldBlockSegments(world->blocked, world->grid.width, world->grid.height, BOID_CELL_SIZE, world->obstacleList, world->obstacleCount);
+        for (int g = 0; g < world->goalCount; g++) FlowFieldRequest(&world->flowFields[g], world->flowFields[g].goal);
+        world->blockedDirty = false;
+    }
+    
+    for (int g = 0; g < world->goalCount; g++) FlowFieldUpdate(&world->flowFields[g], world->blocked, budget);
+}
+
+// ============================================================================
+// CORE SYSTEMS
+// ============================================================================
+
+static void AccelerationResetSystem(Vector2 *acc, BoidEntity *ent, int begin, int end)
+{
+    for (int i = begin; i < end; i++)
+    {
+        if (!ent[i].active) continue;
+        acc[i] = (Vector2){ 0, 0 };
+    }
+}
+
+// dt is the fraction of a frame being integrated (1 / substeps)
+static void PhysicsSystem(BoidKinematics *kin, Vector2 *acc, BoidEntity *ent, int begin, int end, float maxSpeed, float dt)
+{
+    for (int i = begin; i < end; i++)
+    {
+        if (!ent[i].active) continue;
+        
+        Vector2 vel = Vector2Add(BoidVelocity(kin, i), Vector2Scale(acc[i], dt));
+        vel = Vector2Limit(vel, maxSpeed);
+        SetBoidVelocity(kin, i, vel);
+        SetBoidPosition(kin, i, Vector2Add(BoidPosition(kin, i), Vector2Scale(vel, dt)));
+    }
+}
+
+// Keeps positions in [0, width) x [0, height), which the grid relies on
+static void WrapAroundSystem(BoidKinematics *kin, BoidEntity *ent, int begin, int end, int width, int height)
+{
+    for (int i = begin; i < end; i++)
+    {
+        if (!ent[i].active) continue;
+        
+        BOID_X(kin, i) = WrapCoordinate(BOID_X(kin, i), (float)width);
+        BOID_Y(kin, i) = WrapCoordinate(BOID_Y(kin, i), (float)height);
+    }
+}
+
+// ============================================================================
+// SIMULATION STEP
+// ============================================================================
+
+// What a pool run over the boids needs; each worker takes its WorkerSlice
+typedef struct {
+    BoidWorld *world;
+    Vector2 *acc;
+    BoidParams params;
+    float dt;
+} StepTask;
+
+static NeighborSource StepNeighborSource(BoidWorld *world, int worker, BoidParams params)
+{
+    return (NeighborSource){
+        .grid = &world->grid,
+        .broadphase = (world->broadphaseReady && world->broadphase->stats.kind != BOID_BROADPHASE_GRID) ? world->broadphase : NULL,
+        .scratch = &world->neighborScratch[worker],
+        .periodic = params.periodic,
+        .width = (float)world->width,
+        .height = (float)world->height,
+    };
+}
+
+static void FlockingRange(StepTask *task, int worker, int begin, int end)
+{
+    BoidWorld *world = task->world;
+    memset(world->candidates + begin, 0, (end - begin) * sizeof(int));
+    NeighborSource src = StepNeighborSource(world, worker, task->params);
+    
+    AccelerationResetSystem(task->acc, world->entities, begin, end);
+    BoidSeparationSystem(&src, &world->kin, task->acc, world->entities, begin, end, world->radiusScales, world->maxRadiusScale, world->candidates, task->params);
+    BoidAlignmentSystem(&src, &world->kin, task->acc, world->entities, begin, end, world->radiusScales, world->maxRadiusScale, world->candidates, task->params);
+    BoidCohesionSystem(&src, &world->kin, task->acc, world->entities, begin, end, world->radiusScales, world->maxRadiusScale, world->candidates, task->params);
+}
+
+static void FlockingTask(void *context, int worker)
+{
+    StepTask *task = context;
+    int begin, end;
+    WorkerSlice(task->world, worker, &begin, &end);
+    FlockingRange(task, worker, begin, end);
+}
+
+static void FlockingStealTask(void *context, int worker, int t)
+{
+    StepTask *task = context;
+    FlockingRange(task, worker, task->world->taskBounds[t], task->world->taskBounds[t + 1]);
+}
+
+// Cuts each worker's slice into tasks of about equal cost, weighing a boid by
+// the candidates it went through last pass (plus one, so fresh boids count).
+// Dense slices come out as more, smaller tasks, which is what idle workers
+// steal; light slices stay whole with their owner.
+static void CutFlockingTasks(BoidWorld *world)
+{
+    int workers = BoidPoolWorkers(world->pool);
+    long long total = 0;
+    for (int i = 0; i < world->count; i++) total += world->candidates[i] + 1;
+    long long tasks = (long long)workers * STEAL_TASKS_PER_WORKER;
+    long long target = (total + tasks - 1) / tasks;
+    if (target < 1) target = 1;
+    
+    int t = 0;
+    for (int w = 0; w < workers; w++)
+    {
+        int begin, end;
+        WorkerSlice(world, w, &begin, &end);
+        if (begin == end) continue;
+        
+        world->taskBounds[t] = begin;
+        long long weight = 0;
+        for (int i = begin; i < end; i++)
+        {
+            weight += world->candidates[i] + 1;
+            int next = i + 1;
+            if (weight >= target && next < end && next % STEAL_TASK_ALIGN == 0)
+            {
+                world->taskOwners[t++] = w;
+                world->taskBounds[t] = next;
+                weight = 0;
+            }
+        }
+        world->taskOwners[t++] = w;
+        world->taskBounds[t] = end;
+    }
+    world->taskCount = t;
+}
+
+static void GoalSeekingTask(void *context, int worker)
+{
+    StepTask *task = context;
+    int begin, end;
+    WorkerSlice(task->world, worker, &begin, &end);
+    GoalSeekingSystem(task->world->flowFields, task->world->goalIds, &task->world->kin, task->acc, task->world->entities, begin, end, task->params);
+}
+
+// Worker w takes a band of rows and the boids it dropped in the last build
+static void ObstacleAvoidanceTask(void *context, int worker)
+{
+    StepTask *task = context;
+    BoidWorld *world = task->world;
+    const GridBuildScratch *scratch = &world->gridScratch;
+    int rowBegin, rowEnd;
+    BoidPoolSlice(world->grid.height, BoidPoolWorkers(world->pool), worker, 1, &rowBegin, &rowEnd);
+    ObstacleAvoidanceSystem(&world->obstacles, &world->grid, &world->kin, task->acc, rowBegin, rowEnd,
+        scratch->dropped + scratch->droppedStart[worker], scratch->droppedCount[worker], task->params);
+}
+
+static void IntegrateTask(void *context, int worker)
+{
+    StepTask *task = context;
+    BoidWorld *world = task->world;
+    int begin, end;
+    WorkerSlice(world, worker, &begin, &end);
+    
+    PhysicsSystem(&world->kin, world->accelerations, world->entities, begin, end, task->params.maxSpeed, task->dt);
+    WrapAroundSystem(&world->kin, world->entities, begin, end, world->width, world->height);
+}
+
+// SoA hosts write positions in place between steps, anywhere; everything
+// that bins or queries them from the current positions wraps them first.
+// Keys a fused pass left for the next build are redone from the same
+// positions, so a boid the host moved is binned where it now is.
+static void HostWrapTask(void *context, int worker)
+{
+    BoidWorld *world = context;
+    int begin, end;
+    WorkerSlice(world, worker, &begin, &end);
+    WrapAroundSystem(&world->kin, world->entities, begin, end, world->width, world->height);
+    if (!world->cellKeysValid) return;
+    
+    for (int i = begin; i < end; i++)
+    {
+        if (world->entities[i].active) world->cellIds[i] = SpatialGridCellIndex(&world->grid, BoidPosition(&world->kin, i));
+    }
+}
+
+// Steering from the current grid into acc, one pool run per kind of force so
+// each boid's forces add up in the same order (flocking, obstacles, goal).
+static void RefreshObstacleBvh(BoidWorld *world)
+{
+    if (!world->obstaclesDirty) return;
+    
+    ObstacleBvhFree(&world->obstacles);
+    world->obstaclesDirty = !ObstacleBvhBuild(&world->obstacles, world->obstacleList, world->obstacleCount);
+}
+
+static void SteeringSystems(BoidWorld *world, Vector2 *acc, BoidParams params)
+{
+    RefreshObstacleBvh(world);
+    
+    // One scale for everyone: every policy is the same query
+    if (world->radiiUniform) params.radiusPolicy = BOID_RADIUS_OWN;
+    
+    // Flocking cost follows density, so it goes through the stealing
+    // scheduler; it only runs whole slices if the deques cannot grow
+    StepTask task = { world, acc, params, 0.0f };
+    CutFlockingTasks(world);
+    if (!BoidPoolRunTasks(world->pool, FlockingStealTask, &task, world->taskOwners, world->taskCount))
+    {
+        BoidPoolRun(world->pool, FlockingTask, &task);
+    }
+    if (ObstaclesActive(&world->obstacles, params)) BoidPoolRun(world->pool, ObstacleAvoidanceTask, &task);
+    BoidPoolRun(world->pool, GoalSeekingTask, &task);
+}
+
+// ============================================================================
+// FUSED PIPELINE - Steering, integration and next-grid binning in one pass
+// ============================================================================
+//
+// The systems above sweep the boids once per rule and again to reset, move
+// and wrap them. Here each boid is visited once: its forces are summed in the
+// order SteeringSystems adds them (flocking, obstacles, goal) and stored, then
+// integrated and wrapped, and the new state goes to kinBack along with the
+// cell the next grid build files it under. Neighbors keep reading kin, which
+// nothing writes during the pass.
+
+static void FusedRange(StepTask *task, int worker, int begin, int end)
+{
+    BoidWorld *world = task->world;
+    BoidParams params = task->params;
+    const BoidKinematics *kin = &world->kin;
+    BoidKinematics *next = &world->kinBack;
+    const BoidEntity *ent = world->entities;
+    memset(world->candidates + begin, 0, (end - begin) * sizeof(int));
+    NeighborSource src = StepNeighborSource(world, worker, params);
+    
+    bool obstacles = ObstaclesActive(&world->obstacles, params);
+    bool goals = (params.goalWeight != 0);
+    float width = (float)world->width;
+    float height = (float)world->height;
+    
+    for (int i = begin; i < end; i++)
+    {
+        Vector2 pos = BoidPosition(kin, i);
+        Vector2 vel = BoidVelocity(kin, i);
+        if (!ent[i].active)
+        {
+            SetBoidPosition(next, i, pos);
+            SetBoidVelocity(next, i, vel);
+            continue;
+        }
+        
+        Vector2 force = { 0, 0 };
+        Vector2 steering;
+        if (SeparationSteering(&src, kin, ent, i, world->radiusScales, world->maxRadiusScale, world->candidates, params, &steering)) force = Vector2Add(force, steering);
+        if (AlignmentSteering(&src, kin, ent, i, world->radiusScales, world->maxRadiusScale, world->candidates, params, &steering)) force = Vector2Add(force, steering);
+        if (CohesionSteering(&src, kin, ent, i, world->radiusScales, world->maxRadiusScale, world->candidates, params, &steering)) force = Vector2Add(force, steering);
+        if (obstacles)
+        {
+            ObstacleHit hit;
+            int self = 0;
+            ObstacleBvhNearestBatch(&world->obstacles, &pos, &self, 1, params.obstacleLookahead, &hit);
+            if (hit.segment >= 0) force = Vector2Add(force, ObstacleSteering(hit, vel, params));
+        }
+        if (goals && GoalSteering(world->flowFields, world->goalIds, kin, i, params, &steering)) force = Vector2Add(force, steering);
+        task->acc[i] = force;
+        
+        // PhysicsSystem and WrapAroundSystem
+        vel = Vector2Limit(Vector2Add(vel, Vector2Scale(force, task->dt)), params.maxSpeed);
+        pos = Vector2Add(pos, Vector2Scale(vel, task->dt));
+        pos.x = WrapCoordinate(pos.x, width);
+        pos.y = WrapCoordinate(pos.y, height);
+        
+        SetBoidPosition(next, i, pos);
+        SetBoidVelocity(next, i, vel);
+        world->cellIds[i] = SpatialGridCellIndex(&world->grid, pos);
+    }
+}
+
+static void FusedTask(void *context, int worker)
+{
+    StepTask *task = context;
+    int begin, end;
+    WorkerSlice(task->world, worker, &begin, &end);
+    FusedRange(task, worker, begin, end);
+}
+
+static void FusedStealTask(void *context, int worker, int t)
+{
+    StepTask *task = context;
+    FusedRange(task, worker, task->world->taskBounds[t], task->world->taskBounds[t + 1]);
+}
+
+// One substep after the grid build: scheduled like the flocking systems,
+// then the written buffer becomes the current one
+static void FusedPassSystem(BoidWorld *world, BoidParams params, float dt)
+{
+    RefreshObstacleBvh(world);
+    if (world->radiiUniform) params.radiusPolicy = BOID_RADIUS_OWN;
+    
+    StepTask task = { world, world->accelerations, params, dt };
+    CutFlockingTasks(world);
+    if (!BoidPoolRunTasks(world->pool, FusedStealTask, &task, world->taskOwners, world->taskCount))
+    {
+        BoidPoolRun(world->pool, FusedTask, &task);
+    }
+    
+    BoidKinematics written = world->kinBack;
+    world->kinBack = world->kin;
+    world->kin = written;
+    world->cellKeysValid = true;
+}
+
+void BoidWorldStep(BoidWorld *world, int steps, BoidStepTimings *timings)
+{
+    BoidStepTimings local = { 0 };
+    BoidParams params = world->params;
+    int substeps = params.substeps > 0 ? params.substeps : 1;
+    float dt = 1.0f / substeps;
+    BoidPoolRun(world->pool, HostWrapTask, world);
+    
+    for (int step = 0; step < steps; step++)
+    {
+        double fieldStart = NowSeconds();
+        FlowFieldSystem(world, params.flowFieldBudget);
+        local.steering += NowSeconds() - fieldStart;
+        
+        for (int sub = 0; sub < substeps; sub++)
+        {
+            double t0 = NowSeconds();
+            
+            // Build spatial grid for fast neighbor queries, then the
+            // broadphase the flocking systems use (a no-op for the grid)
+            RebuildGrid(world, world->cellIds);
+            world->broadphaseReady = BoidBroadphaseBuild(world->broadphase, &world->kin, world->entities, world->count);
+            for (int w = 0; w < BoidPoolWorkers(world->pool); w++)
+            {
+                world->neighborScratch[w].truncatedQueries = 0;
+                world->neighborScratch[w].clampedQueries = 0;
+                world->neighborScratch[w].trimmedQueries = 0;
+            }
+            if (world->zones) ZoneSetUpdate(world->zones, world->cellIds, &world->kin, world->entities, world->count, world->tick);
+            
+            double t1 = NowSeconds();
+            
+            double t2, t3;
+            if (params.fusedPipeline)
+            {
+                FusedPassSystem(world, params, dt);
+                t2 = t3 = NowSeconds();
+            }
+            else
+            {
+                SteeringSystems(world, world->accelerations, params);
+                t2 = NowSeconds();
+                
+                StepTask integrate = { world, world->accelerations, params, dt };
+                BoidPoolRun(world->pool, IntegrateTask, &integrate);
+                world->cellKeysValid = false;
+                t3 = NowSeconds();
+            }
+            
+            // The pass's budget trims join the build's stats
+            for (int w = 0; w < BoidPoolWorkers(world->pool); w++) world->grid.stats.truncatedQueries += world->neighborScratch[w].trimmedQueries;
+            
+            local.grid += t1 - t0;
+            local.steering += t2 - t1;
+            local.physics += t3 - t2;
+        }
+        world->tick++;
+    }
+    
+    // Once per call, not per tick: hosts only look between steps
+    double publishStart = NowSeconds();
+    KinematicsExport(&world->kin, world->positions, world->velocities, world->count);
+#if !BOID_AOSOA_LANES
+    // SoA hosts read and write the arrays in place, so they hold the state
+    // between steps; the fused buffer they were copied from goes back
+    if (world->kin.positions != world->positions)
+    {
+        BoidKinematics host = world->kinBack;
+        world->kinBack = world->kin;
+        world->kin = host;
+    }
+#endif
+    local.publish += NowSeconds() - publishStart;
+    
+    if (timings) *timings = local;
+}
+
+NeighborBudgetError BoidWorldMeasureNeighborBudgetError(BoidWorld *world)
+{
+    NeighborBudgetError result = { 0 };
+    
+    Vector2 *exact = malloc(world->count * sizeof(Vector2));
+    Vector2 *capped = malloc(world->count * sizeof(Vector2));
+    if (!exact || !capped)
+    {
+        free(exact);
+        free(capped);
+        return result;
+    }
+    
+    BoidPoolRun(world->pool, HostWrapTask, world);
+    BoidParams uncapped = world->params;
+    uncapped.maxNeighbors = 0;
+    
+    SteeringSystems(world, exact, uncapped);
+    SteeringSystems(world, capped, world->params);
+    
+    double errorSum = 0.0;
+    double magnitudeSum = 0.0;
+    int n = 0;
+    for (int i = 0; i < world->count; i++)
+    {
+        if (!world->entities[i].active) continue;
+        errorSum += Vector2Distance(exact[i], capped[i]);
+        magnitudeSum += Vector2Length(exact[i]);
+        n++;
+    }
+    
+    if (n > 0) result.meanError = errorSum / n;
+    if (magnitudeSum > 0.0) result.relativeError = errorSum / magnitudeSum;
+    
+    free(exact);
+    free(capped);
+    return result;
+}
+
+// ============================================================================
+// FLOCK METRICS
+// ============================================================================
+
+static int FindRoot(int *parent, int i)
+{
+    while (parent[i] != i)
+    {
+        parent[i] = parent[parent[i]]; // Path halving
+        i = parent[i];
+    }
+    return i;
+}
+
+FlockMetrics BoidWorldMeasureFlock(BoidWorld *world)
+{
+    FlockMetrics metrics = { 0 };
+    SpatialGrid *grid = &world->grid;
+    const BoidKinematics *kin = &world->kin;
+    BoidEntity *ent = world->entities;
+    int count = world->count;
+    float linkRadius = BoidRadius(world->params.perceptionRadius, 1.0f);
+    
+    int *parent = malloc(count * sizeof(int));
+    int *size = calloc(count, sizeof(int));
+    if (!parent || !size)
+    {
+        free(parent);
+        free(size);
+        return metrics;
+    }
+    
+    BoidPoolRun(world->pool, HostWrapTask, world);
+    RebuildGrid(world, NULL);
+    
+    Vector2 headingSum = { 0, 0 };
+    double nearestSum = 0.0;
+    int active = 0;
+    NeighborSpan spans[NEIGHBOR_STENCIL_CELLS];
+    
+    for (int i = 0; i < count; i++) parent[i] = i;
+    
+    for (int i = 0; i < count; i++)
+    {
+        if (!ent[i].active) continue;
+        active++;
+        
+        Vector2 self = BoidPosition(kin, i);
+        Vector2 vel = BoidVelocity(kin, i);
+        float speed = Vector2Length(vel);
+        if (speed > 0) headingSum = Vector2Add(headingSum, Vector2Scale(vel, 1.0f / speed));
+        
+        float nearest = BOID_CELL_SIZE;
+        int spanCount = GatherNeighborSpans(grid, self, BOID_CELL_SIZE, BOID_CELL_SIZE, 0, NEIGHBOR_BUDGET_NEAREST, spans, NULL);
+        
+        for (int s = 0; s < spanCount; s++)
+        {
+            for (int k = 0; k < spans[s].count; k++)
+            {
+                int j = spans[s].ids[k];
+                if (i == j || !ent[j].active) continue;
+                
+                float dist = Vector2Distance(self, Vector2Add(BoidPosition(kin, j), spans[s].offset));
+                if (dist < nearest) nearest = dist;
+                
+                // Each link is seen from both ends; union once
+                if (j > i && dist < linkRadius)
+                {
+                    int a = FindRoot(parent, i);
+                    int b = FindRoot(parent, j);
+                    if (a != b) parent[a] = b;
+                }
+            }
+        }
+        nearestSum += nearest;
+    }
+    
+    for (int i = 0; i < count; i++)
+    {
+        if (!ent[i].active) continue;
+        
+        int root = FindRoot(parent, i);
+        if (size[root]++ == 0) metrics.clusterCount++;
+        if (size[root] > metrics.largestCluster) metrics.largestCluster = size[root];
+    }
+    
+    if (active > 0)
+    {
+        metrics.polarization = Vector2Length(headingSum) / active;
+        metrics.meanNearestNeighbor = (float)(nearestSum / active);
+    }
+    
+    free(parent);
+    free(size);
+    return metrics;
+}
+
+// ============================================================================
+// SNAPSHOTS
+// ============================================================================
+
+#define SNAPSHOT_MAGIC 0x54504b4344494f42ull // "BOIDCKPT"
+#define SNAPSHOT_VERSION 8
+
+typedef struct {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t headerSize; // Catches BoidParams layout changes between builds
+    int32_t capacity, count;
+    int32_t width, height;
+    int32_t obstacleCount;
+    int32_t goalCount;
+    int32_t blockedDirty;
+    int32_t zoneCount;
+    int32_t workers, pages;
+    int32_t broadphase;
+    uint64_t rngState;
+    uint64_t tick;
+    BoidParams params;
+} SnapshotHeader;
+
+// Per-boid bytes across all component arrays
+#define SNAPSHOT_BOID_SIZE (sizeof(BoidEntity) + 3 * sizeof(Vector2) + sizeof(BoidColor) + sizeof(int) + sizeof(float))
+
+// Flow fields are saved mid-rebuild so a restored world settles the same
+// cells on the same ticks
+typedef struct {
+    Vector2 goal;
+    int32_t building;
+    int32_t heapCount;
+} SnapshotFlowField;
+
+static size_t FlowFieldSnapshotSize(int cells, int heapCount)
+{
+    return sizeof(SnapshotFlowField) + (size_t)cells * (sizeof(Vector2) + sizeof(float)) + (size_t)heapCount * sizeof(FlowHeapEntry);
+}
+
+size_t BoidWorldSnapshotSize(const BoidWorld *world)
+{
+    size_t size = sizeof(SnapshotHeader) + (size_t)world->count * SNAPSHOT_BOID_SIZE + (size_t)world->obstacleCount * sizeof(ObstacleSegment);
+    int cells = world->grid.width * world->grid.height;
+    for (int g = 0; g < world->goalCount; g++) size += FlowFieldSnapshotSize(cells, world->flowFields[g].heapCount);
+    if (world->zones) size += world->zones->zoneCount * sizeof(BoidZone) + (size_t)world->count * sizeof(uint32_t);
+    return size;
+}
+
+void BoidWorldSnapshot(const BoidWorld *world, void *buffer)
+{
+    SnapshotHeader header = {
+        .magic = SNAPSHOT_MAGIC,
+        .version = SNAPSHOT_VERSION,
+        .headerSize = sizeof(SnapshotHeader),
+        .capacity = world->capacity,
+        .count = world->count,
+        .width = world->width,
+        .height = world->height,
+        .obstacleCount = world->obstacleCount,
+        .goalCount = world->goalCount,
+        .blockedDirty = world->blockedDirty,
+        .zoneCount = world->zones ? world->zones->zoneCount : 0,
+        .workers = BoidPoolWorkers(world->pool),
+        .pages = world->pages,
+        .broadphase = world->broadphase->stats.kind,
+        .rngState = world->rngState,
+        .tick = world->tick,
+        .params = world->params,
+    };
+    
+    // The grid is rebuilt from positions every step, so it is not saved
+    unsigned char *out = buffer;
+    size_t n = world->count;
+    memcpy(out, &header, sizeof(header));
+    out += sizeof(header);
+    memcpy(out, world->entities, n * sizeof(BoidEntity));
+    out += n * sizeof(BoidEntity);
+    memcpy(out, world->positions, n * sizeof(Vector2));
+    out += n * sizeof(Vector2);
+    memcpy(out, world->velocities, n * sizeof(Vector2));
+    out += n * sizeof(Vector2);
+    memcpy(out, world->accelerations, n * sizeof(Vector2));
+    out += n * sizeof(Vector2);
+    memcpy(out, world->colors, n * sizeof(BoidColor));
+    out += n * sizeof(BoidColor);
+    memcpy(out, world->goalIds, n * sizeof(int));
+    out += n * sizeof(int);
+    memcpy(out, world->radiusScales, n * sizeof(float));
+    out += n * sizeof(float);
+    memcpy(out, world->obstacleList, world->obstacleCount * sizeof(ObstacleSegment));
+    out += world->obstacleCount * sizeof(ObstacleSegment);
+    
+    size_t cells = (size_t)world->grid.width * world->grid.height;
+    for (int g = 0; g < world->goalCount; g++)
+    {
+        const FlowField *field = &world->flowFields[g];
+        SnapshotFlowField fieldHeader = { field->goal, field->building, field->heapCount };
+        memcpy(out, &fieldHeader, sizeof(fieldHeader));
+        out += sizeof(fieldHeader);
+        memcpy(out, field->direction, cells * sizeof(Vector2));
+        out += cells * sizeof(Vector2);
+        memcpy(out, field->distance, cells * sizeof(float));
+        out += cells * sizeof(float);
+        memcpy(out, field->heap, field->heapCount * sizeof(FlowHeapEntry));
+        out += field->heapCount * sizeof(FlowHeapEntry);
+    }
+    
+    // Memberships, so a restored world does not replay enter events
+    if (header.zoneCount > 0)
+    {
+        memcpy(out, world->zones->zones, header.zoneCount * sizeof(BoidZone));
+        out += header.zoneCount * sizeof(BoidZone);
+        memcpy(out, world->zones->masks, n * sizeof(uint32_t));
+    }
+}
+
+BoidWorld *BoidWorldRestore(const void *buffer, size_t size)
+{
+    return BoidWorldRestoreWith(buffer, size, NULL);
+}
+
+BoidWorld *BoidWorldRestoreWith(const void *buffer, size_t size, const BoidRestoreOptions *options)
+{
+    SnapshotHeader header;
+    if (size < sizeof(header)) return NULL;
+    memcpy(&header, buffer, sizeof(header));
+    
+    if (header.magic != SNAPSHOT_MAGIC || header.version != SNAPSHOT_VERSION || header.headerSize != sizeof(SnapshotHeader)) return NULL;
+    if (header.count < 0 || header.count > header.capacity || header.obstacleCount < 0 || header.goalCount < 0 || header.zoneCount < 0) return NULL;
+    
+    // Fixed part first; the flow fields are checked as they are read
+    size_t fixedSize = sizeof(header) + (size_t)header.count * SNAPSHOT_BOID_SIZE + (size_t)header.obstacleCount * sizeof(ObstacleSegment);
+    if (size < fixedSize) return NULL;
+    
+    BoidWorldConfig config = {
+        .capacity = header.capacity,
+        .width = header.width,
+        .height = header.height,
+        .seed = header.rngState,
+        .params = header.params,
+        .workers = header.workers,
+        .pages = (header.pages >= 0 && header.pages < BOID_PAGES_MODE_COUNT) ? header.pages : BOID_PAGES_DEFAULT,
+        .broadphase = (header.broadphase >= 0 && header.broadphase < BOID_BROADPHASE_COUNT) ? header.broadphase : BOID_BROADPHASE_GRID,
+    };
+    if (options && options->workers >= 1) config.workers = options->workers;
+    if (options && options->pages >= 0 && options->pages < BOID_PAGES_MODE_COUNT) config.pages = options->pages;
+    if (options) config.pinWorkers = options->pinWorkers;
+    BoidWorld *world = BoidWorldCreate(&config);
+    if (!world) return NULL;
+    
+    const unsigned char *in = (const unsigned char *)buffer + sizeof(header);
+    size_t n = header.count;
+    memcpy(world->entities, in, n * sizeof(BoidEntity));
+    in += n * sizeof(BoidEntity);
+    memcpy(world->positions, in, n * sizeof(Vector2));
+    in += n * sizeof(Vector2);
+    memcpy(world->velocities, in, n * sizeof(Vector2));
+    in += n * sizeof(Vector2);
+    memcpy(world->accelerations, in, n * sizeof(Vector2));
+    in += n * sizeof(Vector2);
+    memcpy(world->colors, in, n * sizeof(BoidColor));
+    in += n * sizeof(BoidColor);
+    memcpy(world->goalIds, in, n * sizeof(int));
+    in += n * sizeof(int);
+    memcpy(world->radiusScales, in, n * sizeof(float));
+    in += n * sizeof(float);
+    KinematicsImport(&world->kin, world->positions, world->velocities, header.count);
+    
+    for (int o = 0; o < header.obstacleCount; o++)
+    {
+        ObstacleSegment segment;
+        memcpy(&segment, in + o * sizeof(ObstacleSegment), sizeof(segment));
+        if (!BoidWorldAddObstacle(world, segment.a, segment.b))
+        {
+            BoidWorldDestroy(world);
+            return NULL;
+        }
+    }
+    in += header.obstacleCount * sizeof(ObstacleSegment);
+    
+    // Rebuild the blocked mask now rather than on the next step, which would
+    // restart every field's pass in progress
+    FlowFieldBlockSegments(world->blocked, world->grid.width, world->grid.height, BOID_CELL_SIZE, world->obstacleList, world->obstacleCount);
+    world->blockedDirty = header.blockedDirty;
+    
+    const unsigned char *end = (const unsigned char *)buffer + size;
+    size_t cells = (size_t)world->grid.width * world->grid.height;
+    for (int g = 0; g < header.goalCount; g++)
+    {
+        SnapshotFlowField fieldHeader;
+        if ((size_t)(end - in) < sizeof(fieldHeader)) goto corrupt;
+        memcpy(&fieldHeader, in, sizeof(fieldHeader));
+        in += sizeof(fieldHeader);
+        
+        if (BoidWorldAddGoal(world, fieldHeader.goal) != g) goto corrupt;
+        FlowField *field = &world->flowFields[g];
+        if (fieldHeader.heapCount < 0 || fieldHeader.heapCount > field->heapCapacity) goto corrupt;
+        if ((size_t)(end - in) < FlowFieldSnapshotSize(cells, fieldHeader.heapCount) - sizeof(fieldHeader)) goto corrupt;
+        
+        field->building = fieldHeader.building;
+        field->heapCount = fieldHeader.heapCount;
+        memcpy(field->direction, in, cells * sizeof(Vector2));
+        in += cells * sizeof(Vector2);
+        memcpy(field->distance, in, cells * sizeof(float));
+        in += cells * sizeof(float);
+        memcpy(field->heap, in, field->heapCount * sizeof(FlowHeapEntry));
+        in += field->heapCount * sizeof(FlowHeapEntry);
+    }
+    
+    if (header.zoneCount > 0)
+    {
+        size_t zoneSize = header.zoneCount * sizeof(BoidZone);
+        if (header.zoneCount > BOID_MAX_ZONES || (size_t)(end - in) != zoneSize + n * sizeof(uint32_t)) goto corrupt;
+        
+        for (int z = 0; z < header.zoneCount; z++)
+        {
+            BoidZone zone;
+            memcpy(&zone, in + z * sizeof(BoidZone), sizeof(zone));
+            if (AddZone(world, zone) != z) goto corrupt;
+        }
+        in += zoneSize;
+        memcpy(world->zones->masks, in, n * sizeof(uint32_t));
+        in += n * sizeof(uint32_t);
+    }
+    if (in != end) goto corrupt;
+    
+    for (size_t i = 0; i < n; i++)
+    {
+        if (world->goalIds[i] >= header.goalCount) goto corrupt;
+    }
+    
+    world->count = header.count;
+    world->tick = header.tick;
+    return world;
+
+corrupt:
+    BoidWorldDestroy(world);
+    return NULL;
+}
+
+// ============================================================================
+// QUERIES AND ACCESSORS
+// ============================================================================
+
+void BoidWorldQuery(BoidWorld *world, Vector2 pos, float radius, int *outEntities, int *outCount, int maxResults)
+{
+    SpatialGrid *grid = &world->grid;
+    *outCount = 0;
+    bool truncated = false;
+    
+    // Clamp the cell range to the world cells
+    int minX = (int)floorf((pos.x - radius) / BOID_CELL_SIZE);
+    int maxX = (int)floorf((pos.x + radius) / BOID_CELL_SIZE);
+    int minY = (int)floorf((pos.y - radius) / BOID_CELL_SIZE);
+    int maxY = (int)floorf((pos.y + radius) / BOID_CELL_SIZE);
+    if (minX < 0) minX = 0;
+    if (maxX >= grid->width) maxX = grid->width - 1;
+    if (minY < 0) minY = 0;
+    if (maxY >= grid->height) maxY = grid->height - 1;
+    
+    for (int y = minY; y <= maxY; y++)
+    {
+        for (int x = minX; x <= maxX; x++)
+        {
+            const GridCell *cell = SpatialGridCell(grid, x, y);
+            int n = cell->count;
+            if (n > maxResults - *outCount)
+            {
+                n = maxResults - *outCount;
+                truncated = true;
+            }
+            
+            memcpy(outEntities + *outCount, cell->entities, n * sizeof(int));
+            *outCount += n;
+        }
+    }
+    
+    if (truncated) grid->stats.truncatedQueries++;
+}
+
+typedef struct {
+    int level, x, y;
+} PyramidNode;
+
+// Interior aggregates and boundary boids both come from the last grid build:
+// boundary cells test binnedPositions, never the current positions
+GridAggregate BoidWorldQueryAggregate(BoidWorld *world, Vector2 pos, float radius)
+{
+    const SpatialGrid *grid = &world->grid;
+    const GridPyramid *pyramid = &grid->pyramid;
+    float radiusSqr = radius * radius;
+    GridAggregate result = { 0 };
+    
+    // Depth-first from the single top cell; each pop pushes at most 4 children
+    PyramidNode stack[4 * GRID_PYRAMID_MAX_LEVELS];
+    int top = 0;
+    stack[top++] = (PyramidNode){ pyramid->levelCount - 1, 0, 0 };
+    
+    while (top > 0)
+    {
+        int k = stack[--top].level;
+        int x = stack[top].x;
+        int y = stack[top].y;
+        
+        const GridLevel *level = &pyramid->levels[k];
+        const GridAggregate *agg = &level->cells[y * level->width + x];
+        if (agg->count == 0) continue; // Empty regions drop out whole
+        
+        // Cell bounds in world units, clipped to the world
+        float size = (float)BOID_CELL_SIZE * (1 << k);
+        float x0 = x * size, y0 = y * size;
+        float x1 = fminf(x0 + size, (float)world->width);
+        float y1 = fminf(y0 + size, (float)world->height);
+        
+        float nx = fmaxf(x0, fminf(pos.x, x1)) - pos.x;
+        float ny = fmaxf(y0, fminf(pos.y, y1)) - pos.y;
+        if (nx * nx + ny * ny >= radiusSqr) continue;
+        
+        float fx = fmaxf(fabsf(x0 - pos.x), fabsf(x1 - pos.x));
+        float fy = fmaxf(fabsf(y0 - pos.y), fabsf(y1 - pos.y));
+        if (fx * fx + fy * fy < radiusSqr)
+        {
+            AddAggregate(&result, agg);
+            continue;
+        }
+        
+        if (k > 0)
+        {
+            const GridLevel *child = &pyramid->levels[k - 1];
+            for (int cy = 2 * y; cy <= 2 * y + 1 && cy < child->height; cy++)
+                for (int cx = 2 * x; cx <= 2 * x + 1 && cx < child->width; cx++)
+                    stack[top++] = (PyramidNode){ k - 1, cx, cy };
+            continue;
+        }
+        
+        // Boundary world cell: test its boids one by one, as they were binned
+        const GridCell *cell = SpatialGridCellAt(grid, x, y);
+        for (int i = 0; i < cell->count; i++)
+        {
+            int id = cell->entities[i];
+            Vector2 p = world->binnedPositions[id];
+            if (Vector2Distance(pos, p) >= radius) continue;
+            
+            GridAggregate one = { 1, p, world->binnedVelocities[id] };
+            AddAggregate(&result, &one);
+        }
+    }
+    
+    return result;
+}
+
+BoidParams *BoidWorldParams(BoidWorld *world) { return &world->params; }
+
+const char *BoidLayoutName(void) { return BOID_LAYOUT_NAME; }
+
+const char *BoidBroadphaseName(BoidBroadphaseKind kind)
+{
+    static const char *names[BOID_BROADPHASE_COUNT] = { "grid", "kdtree", "sweep", "hash" };
+    return (kind >= 0 && kind < BOID_BROADPHASE_COUNT) ? names[kind] : "unknown";
+}
+
+bool BoidWorldSetBroadphase(BoidWorld *world, BoidBroadphaseKind kind)
+{
+    BoidBroadphase *next = BoidBroadphaseCreate(kind, &world->grid, world->capacity);
+    if (!next) return false;
+    BoidPoolRun(world->pool, HostWrapTask, world);
+    
+    // Only the index is new; the grid is as of the last step
+    if (!BoidBroadphaseBuild(next, &world->kin, world->entities, world->count))
+    {
+        BoidBroadphaseDestroy(next);
+        return false;
+    }
+    BoidBroadphaseDestroy(world->broadphase);
+    world->broadphase = next;
+    world->broadphaseReady = true;
+    return true;
+}
+
+BoidBroadphaseStats BoidWorldBroadphaseStats(const BoidWorld *world)
+{
+    BoidBroadphaseStats stats = world->broadphase->stats;
+    long long candidates = 0;
+    int active = 0;
+    for (int i = 0; i < world->count; i++)
+    {
+        if (!world->entities[i].active) continue;
+        candidates += world->candidates[i];
+        active++;
+    }
+    stats.distanceTestsPerBoid = active ? (double)candidates / active : 0.0;
+    for (int w = 0; w < BoidPoolWorkers(world->pool); w++)
+    {
+        stats.truncatedQueries += world->neighborScratch[w].truncatedQueries;
+        stats.clampedQueries += world->neighborScratch[w].clampedQueries;
+    }
+    return stats;
+}
+
+int BoidWorldQueryNearest(BoidWorld *world, Vector2 pos, int k, int *outEntities)
+{
+    if (!world->broadphaseReady) return 0;
+    
+    BoidNearestSet set;
+    BoidNearestSetInit(&set, k, FLT_MAX);
+    BoidBroadphaseQueryNearest(world->broadphase, pos, &set);
+    BoidNearestSetSort(&set);
+    memcpy(outEntities, set.ids, set.count * sizeof(int));
+    return set.count;
+}
+
+BoidMemoryInfo BoidWorldMemoryInfo(const BoidWorld *world)
+{
+    return (BoidMemoryInfo){ world->arena.pages, world->arena.size, BoidPoolWorkers(world->pool), BoidPoolPinned(world->pool) };
+}
+
+void BoidWorldWorkerStats(const BoidWorld *world, BoidWorkerStats *out)
+{
+    BoidPoolStats(world->pool, out);
+}
+
+const ObstacleSegment *BoidWorldObstacles(const BoidWorld *world, int *count)
+{
+    *count = world->obstacleCount;
+    return world->obstacleList;
+}
+
+const BoidZone *BoidWorldZones(const BoidWorld *world, int *count)
+{
+    *count = world->zones ? world->zones->zoneCount : 0;
+    return world->zones ? world->zones->zones : NULL;
+}
+
+const uint32_t *BoidWorldZoneMasks(const BoidWorld *world)
+{
+    return world->zones ? world->zones->masks : NULL;
+}
+
+int BoidWorldDrainZoneEvents(BoidWorld *world, BoidZoneEvent *out, int maxEvents)
+{
+    return world->zones ? ZoneSetDrain(world->zones, out, maxEvents) : 0;
+}
+
+BoidZoneStats BoidWorldZoneStats(const BoidWorld *world)
+{
+    return world->zones ? world->zones->stats : (BoidZoneStats){ 0 };
+}
+
+int BoidWorldGoalCount(const BoidWorld *world) { return world->goalCount; }
+int *BoidWorldGoalIds(BoidWorld *world) { return world->goalIds; }
+
+const struct FlowField *BoidWorldFlowField(const BoidWorld *world, int goal)
+{
+    return (goal >= 0 && goal < world->goalCount) ? &world->flowFields[goal] : NULL;
+}
+
+int BoidWorldCount(const BoidWorld *world) { return world->count; }
+int BoidWorldCapacity(const BoidWorld *world) { return world->capacity; }
+int BoidWorldWidth(const BoidWorld *world) { return world->width; }
+int BoidWorldHeight(const BoidWorld *world) { return world->height; }
+uint64_t BoidWorldTick(const BoidWorld *world) { return world->tick; }
+
+BoidEntity *BoidWorldEntities(BoidWorld *world) { return world->entities; }
+Vector2 *BoidWorldPositions(BoidWorld *world) { return world->positions; }
+Vector2 *BoidWorldVelocities(BoidWorld *world) { return world->velocities; }
+Vector2 *BoidWorldAccelerations(BoidWorld *world) { return world->accelerations; }
+BoidColor *BoidWorldColors(BoidWorld *world) { return world->colors; }
+float *BoidWorldRadiusScales(BoidWorld *world) { return world->radiusScales; }
+
+const SpatialGrid *BoidWorldGrid(const BoidWorld *world) { return &world->grid; }
@@ -0,0 +1,466 @@
+#ifndef BOID_H
+#define BOID_H
+
+// ============================================================================
+// BOID CORE - Embeddable flocking simulation, no raylib dependency
+// ============================================================================
+//
+// Everything the simulation needs (world storage, spatial grid, systems and
+// parameters) lives behind an opaque BoidWorld handle. Component arrays are
+// handed out as raw pointers (zero copy) and stay valid for the life of the
+// world.
+//
+// Static library:  cc -O2 -pthread -c boid.c boid_obstacles.c boid_flowfield.c boid_zones.c boid_memory.c boid_pool.c boid_broadphase.c boid_hash.c boid_splat.c boid_ensemble.c && ar rcs libboid.a boid*.o
+// Shared library:  cc -O2 -pthread -fPIC -shared boid.c boid_obstacles.c boid_flowfield.c boid_zones.c boid_memory.c boid_pool.c boid_broadphase.c boid_hash.c boid_splat.c boid_ensemble.c -o libboid.so -lm
+// Demo:            cc -O2 -pthread main.c boid.c boid_obstacles.c boid_flowfield.c boid_zones.c boid_memory.c boid_pool.c boid_broadphase.c boid_hash.c boid_splat.c boid_checkpoint.c boid_telemetry.c boid_watchdog.c boid_writer.c -lraylib -lm -o boids
+// Any of these:    add -DBOID_AOSOA_LANES=8 (or 16) for the blocked layout in boid_layout.h
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Layout-compatible with raylib's Vector2; whichever header comes first
+// defines it
+#ifndef RL_VECTOR2_TYPE
+typedef struct Vector2 {
+    float x;
+    float y;
+} Vector2;
+#define RL_VECTOR2_TYPE
+#endif
+
+// Same layout as raylib's Color, kept distinct so the headers can be
+// included in any order
+typedef struct {
+    unsigned char r, g, b, a;
+} BoidColor;
+
+// ============================================================================
+// COMPONENTS - Pure data
+// ============================================================================
+
+typedef struct {
+    bool active;
+} BoidEntity;
+
+// ============================================================================
+// SPATIAL GRID - Read-only view for hosts
+// ============================================================================
+
+#define BOID_CELL_SIZE 40 // World sizes must be a multiple of this
+#define MAX_ENTITIES_PER_CELL 100
+#define OCCUPANCY_BIN_SIZE 10
+#define OCCUPANCY_BINS (MAX_ENTITIES_PER_CELL / OCCUPANCY_BIN_SIZE + 1) // Last bin = full cells
+
+// Boids are binned by radius: class k holds radii up to
+// (k + 1) * BOID_CELL_SIZE / BOID_RADIUS_CLASSES
+#define BOID_RADIUS_CLASSES 4
+
+#define BOID_BROADPHASE_MAX_K 256 // Largest k for nearest-neighbor queries
+
+typedef struct {
+    int entities[MAX_ENTITIES_PER_CELL]; // Largest radius class first
+    int count;
+    unsigned char classCounts[BOID_RADIUS_CLASSES]; // Entities per radius class
+    Vector2 positionSum; // Sums of inserted positions and velocities, for per-cell means
+    Vector2 velocitySum;
+} GridCell;
+
+// Per-build counters; reset with the grid every step
+typedef struct {
+    int droppedInserts;   // Boids not inserted because their cell was full
+    // Grid neighbor queries the BoidParams.maxNeighbors budget trimmed in
+    // the flocking pass after the build, plus BoidWorldQuery calls cut off
+    // at maxResults. Queries through another broadphase count in
+    // BoidBroadphaseStats instead.
+    int truncatedQueries;
+    int maxOccupancy;
+    int occupancyHistogram[OCCUPANCY_BINS]; // Cells per occupancy bin, empty cells excluded
+} SpatialGridStats;
+
+// Boids summarized over a block of world cells
+typedef struct {
+    int count;
+    Vector2 positionSum;
+    Vector2 velocitySum;
+} GridAggregate;
+
+// Row-major aggregates; cell (x, y) of level k covers world cells
+// [x * 2^k, (x + 1) * 2^k) on each axis, clipped to the world
+typedef struct {
+    int width, height;
+    GridAggregate *cells;
+} GridLevel;
+
+#define GRID_PYRAMID_MAX_LEVELS 24
+
+// levels[0] mirrors the world cells; each level above halves the resolution
+// (rounding up) until the last one is a single cell
+typedef struct {
+    int levelCount;
+    GridLevel levels[GRID_PYRAMID_MAX_LEVELS];
+} GridPyramid;
+
+// Row-major with a one-cell ghost ring: world cell (x, y) lives at
+// cells[(y + 1) * paddedWidth + x + 1]. Ghost cells are empty unless the world
+// is periodic, in which case they mirror the opposite edge.
+typedef struct {
+    int width, height;             // World cells
+    int paddedWidth, paddedHeight; // Including the ghost ring
+    GridCell *cells;
+    SpatialGridStats stats;
+    GridPyramid pyramid; // Built with the grid, world cells only
+} SpatialGrid;
+
+static inline const GridCell *SpatialGridCellAt(const SpatialGrid *grid, int x, int y)
+{
+    return &grid->cells[(y + 1) * grid->paddedWidth + x + 1];
+}
+
+// ============================================================================
+// BOID PARAMETERS
+// ============================================================================
+
+typedef enum {
+    NEIGHBOR_BUDGET_NEAREST = 0, // Whole cells, nearest cell first, until the budget runs out
+    NEIGHBOR_BUDGET_STRATIFIED,  // Evenly spaced samples from every overlapped cell
+    NEIGHBOR_BUDGET_MODE_COUNT
+} NeighborBudgetMode;
+
+// Which radius decides whether two boids with different radii interact
+typedef enum {
+    BOID_RADIUS_OWN = 0, // Each boid sees others within its own radius
+    BOID_RADIUS_MIN,     // Symmetric: both within the smaller radius
+    BOID_RADIUS_MAX,     // Symmetric: either within its radius
+    BOID_RADIUS_POLICY_COUNT
+} BoidRadiusPolicy;
+
+typedef struct {
+    // Scaled per boid, then clamped to [0, BOID_CELL_SIZE] wherever they are
+    // read (the query stencil is at most 3x3 cells), so larger values act as
+    // BOID_CELL_SIZE and NaN as 0
+    float perceptionRadius;
+    float separationRadius;
+    float maxSpeed;
+    float maxForce;
+    
+    float separationWeight;
+    float alignmentWeight;
+    float cohesionWeight;
+    
+    // Per-boid, per-query candidate cap; 0 = unlimited. Through the kdtree,
+    // sweep and hash broadphases it takes the nearest, so it is capped at
+    // BOID_BROADPHASE_MAX_K; capped queries count in BoidBroadphaseStats.
+    int maxNeighbors;
+    NeighborBudgetMode neighborBudgetMode;
+    
+    int substeps;  // Steering + integration passes per step, each covering 1/substeps of it
+    bool periodic; // Neighbor queries see across the wrapped world edges
+    
+    float obstacleLookahead; // Obstacles closer than this push boids away
+    float avoidanceWeight;
+    
+    float goalWeight;    // Pull along the flow field of a boid's goal
+    int flowFieldBudget; // Cells settled per field per step while a field rebuilds; 0 = all at once
+    
+    BoidRadiusPolicy radiusPolicy; // Only matters once per-boid radius scales differ
+    
+    // One pass per boid per substep computes all steering, stores it (no
+    // reset), integrates, wraps and writes the boid's next cell, which the next
+    // grid build reads instead of the positions. Same results as the separate
+    // systems, boids the host moves between steps included.
+    bool fusedPipeline;
+} BoidParams;
+
+BoidParams BoidDefaultParams(void);
+
+// ============================================================================
+// WORLD
+// ============================================================================
+
+typedef struct BoidWorld BoidWorld;
+
+// Pages backing the world's storage; each mode falls back to the next one
+// down when the system cannot provide it
+typedef enum {
+    BOID_PAGES_DEFAULT = 0,  // Plain pages
+    BOID_PAGES_TRANSPARENT,  // madvise(MADV_HUGEPAGE)
+    BOID_PAGES_EXPLICIT,     // MAP_HUGETLB; needs reserved huge pages
+    BOID_PAGES_MODE_COUNT
+} BoidPageMode;
+
+// Index the flocking systems find neighbors through. The grid is built every
+// step regardless (zones, aggregates and obstacles use it); the others are
+// built alongside it.
+typedef enum {
+    BOID_BROADPHASE_GRID = 0, // Uniform grid, cells scanned in place
+    BOID_BROADPHASE_KDTREE,   // 2-d tree, median splits
+    BOID_BROADPHASE_SWEEP,    // Boids sorted along x, re-sorted incrementally
+    BOID_BROADPHASE_HASH,     // Sparse cell hash (boid_hash.h)
+    BOID_BROADPHASE_COUNT
+} BoidBroadphaseKind;
+
+typedef struct {
+    int capacity;      // Max boids
+    int width, height; // World size, multiples of BOID_CELL_SIZE
+    uint64_t seed;     // For BoidWorldSpawnRandom
+    BoidParams params;
+    int workers;       // Threads running the per-boid systems, the caller included; < 1 = 1
+    bool pinWorkers;   // One CPU per worker, the caller's thread included, while the world lives (Linux)
+    BoidPageMode pages;
+    BoidBroadphaseKind broadphase;
+} BoidWorldConfig;
+
+// Per worker, summed over every work-stealing run (the flocking systems)
+typedef struct {
+    double busy; // Seconds spent running tasks
+    double idle; // Seconds of the runs spent looking for work or waiting for the others
+    int tasks;   // Tasks run, stolen ones included
+    int steals;  // Tasks taken from another worker's deque
+} BoidWorkerStats;
+
+typedef struct {
+    BoidPageMode pages; // What the world got, which may be less than asked for
+    size_t bytes;       // Arena holding the per-boid arrays and grid cells
+    int workers;
+    bool pinned; // Every worker on its own CPU, so first-touched pages stay on its node
+} BoidMemoryInfo;
+
+typedef struct {
+    BoidBroadphaseKind kind;
+    double buildSeconds; // Last build, included in BoidStepTimings.grid
+    size_t bytes;        // Index storage; the grid's cells for the grid
+    // Per boid, last flocking pass: the ids the systems tested plus the
+    // index's own distance tests (the grid makes none), so that every index
+    // is charged for the same work
+    double distanceTestsPerBoid;
+    int truncatedQueries; // Radius queries cut short by memory, since the last build
+    int clampedQueries;   // Nearest queries capped at BOID_BROADPHASE_MAX_K, since the last build
+} BoidBroadphaseStats;
+
+// Wall-clock seconds spent per phase, summed over the steps of one call
+typedef struct {
+    double grid;
+    double steering;
+    double physics; // Part of steering with BoidParams.fusedPipeline
+    double publish; // AoSoA builds: copying out the host Vector2 arrays, once per call
+} BoidStepTimings;
+
+typedef struct {
+    double meanError;     // Mean |a_capped - a_exact| over active boids
+    double relativeError; // meanError / mean |a_exact|
+} NeighborBudgetError;
+
+BoidWorldConfig BoidDefaultConfig(void);
+
+// Returns NULL on allocation failure or a world size that is not a multiple
+// of BOID_CELL_SIZE
+BoidWorld *BoidWorldCreate(const BoidWorldConfig *config);
+void BoidWorldDestroy(BoidWorld *world);
+
+// Returns the new boid's id, or -1 when the world is full. The world is a
+// torus: positions outside [0, width) x [0, height) are wrapped into it (NaN
+// becomes 0).
+int BoidWorldAddBoid(BoidWorld *world, Vector2 position, Vector2 velocity, BoidColor color);
+// Random positions at least border away from the edges, random palette colors
+void BoidWorldSpawnRandom(BoidWorld *world, int count, int border);
+
+// "soa", "aosoa8" or "aosoa16": the layout the core was built with
+const char *BoidLayoutName(void);
+
+// Advances the world by steps ticks; timings is optional
+void BoidWorldStep(BoidWorld *world, int steps, BoidStepTimings *timings);
+
+// Mutable; changes apply from the next step
+BoidParams *BoidWorldParams(BoidWorld *world);
+
+int BoidWorldCount(const BoidWorld *world);
+BoidMemoryInfo BoidWorldMemoryInfo(const BoidWorld *world);
+// Fills out[0 .. workers - 1] (see BoidWorldMemoryInfo); imbalance shows as
+// uneven busy times
+void BoidWorldWorkerStats(const BoidWorld *world, BoidWorkerStats *out);
+int BoidWorldCapacity(const BoidWorld *world);
+int BoidWorldWidth(const BoidWorld *world);
+int BoidWorldHeight(const BoidWorld *world);
+uint64_t BoidWorldTick(const BoidWorld *world);
+
+// Zero-copy component arrays, BoidWorldCount() entries each. Built with
+// -DBOID_AOSOA_LANES (see boid_layout.h), positions and velocities are copies
+// refreshed by every BoidWorldStep and are read-only. Otherwise positions may
+// be written between steps, anywhere: the next call that reads them (step,
+// flock or budget measurement, broadphase switch) wraps them as AddBoid does.
+BoidEntity *BoidWorldEntities(BoidWorld *world);
+Vector2 *BoidWorldPositions(BoidWorld *world);
+Vector2 *BoidWorldVelocities(BoidWorld *world);
+Vector2 *BoidWorldAccelerations(BoidWorld *world);
+BoidColor *BoidWorldColors(BoidWorld *world);
+// Per-boid multiplier on perceptionRadius and separationRadius, 1 by default
+float *BoidWorldRadiusScales(BoidWorld *world);
+
+// Grid as of the last step
+const SpatialGrid *BoidWorldGrid(const BoidWorld *world);
+
+// "grid", "kdtree", "sweep" or "hash"
+const char *BoidBroadphaseName(BoidBroadphaseKind kind);
+// Builds the new index from the current positions and drops the old one;
+// false (old one kept) on allocation failure. The grid drops boids from full
+// cells (SpatialGridStats.droppedInserts) and the other indexes do not, so
+// whenever a cell overflows they see different neighbors and the flocks
+// diverge. Otherwise only the order neighbors are summed in differs, which
+// changes results in the last bits.
+bool BoidWorldSetBroadphase(BoidWorld *world, BoidBroadphaseKind kind);
+BoidBroadphaseStats BoidWorldBroadphaseStats(const BoidWorld *world);
+
+// Up to k (at most BOID_BROADPHASE_MAX_K) ids nearest to pos, nearest first,
+// through the current broadphase (no periodic images), as of the last step
+int BoidWorldQueryNearest(BoidWorld *world, Vector2 pos, int k, int *outEntities);
+
+// Flat id list of world cells (no periodic images) overlapping a radius of any
+// size, as of the last step; stops at maxResults
+void BoidWorldQuery(BoidWorld *world, Vector2 pos, float radius, int *outEntities, int *outCount, int maxResults);
+
+// Count and position/velocity sums of the boids within radius of pos (no
+// periodic images). Counts the same boids as a brute-force pass over the
+// positions of the last grid build, which are those at the start of the last
+// substep of the last BoidWorldStep (or at BoidWorldMeasureFlock, if that came
+// later), not the current ones; the sums use that build's positions and
+// velocities too, added in another order. Boids the build dropped from full
+// cells are not counted. Pyramid cells wholly inside the radius contribute
+// their aggregate; only boundary world cells test boids one by one, so the
+// cost grows with the radius' perimeter rather than its area.
+GridAggregate BoidWorldQueryAggregate(BoidWorld *world, Vector2 pos, float radius);
+
+// Re-runs steering on the current grid with and without the neighbor cap.
+// Does not touch the live accelerations.
+NeighborBudgetError BoidWorldMeasureNeighborBudgetError(BoidWorld *world);
+
+// ============================================================================
+// OBSTACLES - Static level geometry, see boid_obstacles.h
+// ============================================================================
+
+typedef struct {
+    Vector2 a, b;
+} ObstacleSegment;
+
+// Both return false on allocation failure. The obstacle BVH is rebuilt before
+// the next step, so add geometry in bulk rather than between steps.
+bool BoidWorldAddObstacle(BoidWorld *world, Vector2 a, Vector2 b);
+// Closed loop through the vertices
+bool BoidWorldAddObstaclePolygon(BoidWorld *world, const Vector2 *vertices, int vertexCount);
+
+// In the order they were added
+const ObstacleSegment *BoidWorldObstacles(const BoidWorld *world, int *count);
+
+// ============================================================================
+// GOALS - One shared flow field per goal, see boid_flowfield.h
+// ============================================================================
+
+// Returns the goal id, or -1 on allocation failure. Its field is built over
+// the following steps; obstacle changes rebuild every field.
+int BoidWorldAddGoal(BoidWorld *world, Vector2 target);
+void BoidWorldMoveGoal(BoidWorld *world, int goal, Vector2 target);
+int BoidWorldGoalCount(const BoidWorld *world);
+
+// Zero-copy, BoidWorldCount() entries: each boid's goal id, -1 for none
+int *BoidWorldGoalIds(BoidWorld *world);
+
+// Defined in boid_flowfield.h
+struct FlowField;
+const struct FlowField *BoidWorldFlowField(const BoidWorld *world, int goal);
+
+// ============================================================================
+// ZONES - Enter/exit events for level regions, see boid_zones.h
+// ============================================================================
+
+#define BOID_MAX_ZONES 32 // Membership is one bit per zone
+
+typedef enum {
+    BOID_ZONE_RECT = 0, // [min, max)
+    BOID_ZONE_CIRCLE
+} BoidZoneShape;
+
+typedef struct {
+    BoidZoneShape shape;
+    Vector2 min, max; // Rect
+    Vector2 center;   // Circle
+    float radius;
+} BoidZone;
+
+typedef enum {
+    BOID_ZONE_ENTER = 0,
+    BOID_ZONE_EXIT
+} BoidZoneEventType;
+
+typedef struct {
+    int boid;
+    int zone;
+    BoidZoneEventType type;
+    uint64_t tick; // Tick being simulated when the boid crossed
+} BoidZoneEvent;
+
+// Running totals since the first zone was added
+typedef struct {
+    long long transitions; // Boids re-evaluated because they changed cell
+    long long exactTests;  // Point-in-zone tests, boundary cells only
+    long long events;
+    long long dropped;     // Events lost because the queue was full
+} BoidZoneStats;
+
+// Return the zone id, or -1 when BOID_MAX_ZONES are in use or on allocation
+// failure. Boids already inside a new zone get an enter event.
+int BoidWorldAddZoneRect(BoidWorld *world, Vector2 min, Vector2 max);
+int BoidWorldAddZoneCircle(BoidWorld *world, Vector2 center, float radius);
+
+// In the order they were added
+const BoidZone *BoidWorldZones(const BoidWorld *world, int *count);
+
+// BoidWorldCount() entries, bit z set while boid i is inside zone z, as of the
+// last step; NULL before the first zone is added
+const uint32_t *BoidWorldZoneMasks(const BoidWorld *world);
+
+// Pops up to maxEvents in order. May run on another thread while the world
+// steps, but from one thread at a time; drain at least once per frame, since
+// events that do not fit the queue are dropped.
+int BoidWorldDrainZoneEvents(BoidWorld *world, BoidZoneEvent *out, int maxEvents);
+BoidZoneStats BoidWorldZoneStats(const BoidWorld *world);
+
+// ============================================================================
+// FLOCK METRICS
+// ============================================================================
+
+typedef struct {
+    float polarization;        // |mean unit heading|: 0 = disordered, 1 = all aligned
+    int clusterCount;          // Groups connected by links shorter than perceptionRadius
+    int largestCluster;        // Boids in the biggest group
+    float meanNearestNeighbor; // Mean distance to the nearest boid, capped at BOID_CELL_SIZE
+} FlockMetrics;
+
+// Rebuilds the grid from the current positions, then measures it
+FlockMetrics BoidWorldMeasureFlock(BoidWorld *world);
+
+// ============================================================================
+// SNAPSHOTS
+// ============================================================================
+
+// The full world state (component arrays, params, PRNG state, tick,
+// obstacles, goals and their flow fields, zones and memberships) as one flat
+// blob in native layout. A restored world steps exactly like the original
+// would have. Undrained zone events are not included.
+size_t BoidWorldSnapshotSize(const BoidWorld *world);
+void BoidWorldSnapshot(const BoidWorld *world, void *buffer);
+
+// What a restore may take from the restoring host instead of the snapshot.
+// Neither changes results; the rest of BoidWorldConfig is the saved world's.
+typedef struct {
+    int workers;     // < 1: as saved
+    int pages;       // A BoidPageMode; < 0: as saved
+    bool pinWorkers; // Never saved
+} BoidRestoreOptions;
+
+// NULL on a truncated blob, one from a different build layout, or allocation
+// failure
+BoidWorld *BoidWorldRestore(const void *buffer, size_t size);
+// options may be NULL, which is BoidWorldRestore
+BoidWorld *BoidWorldRestoreWith(const void *buffer, size_t size, const BoidRestoreOptions *options);
+
+#endif // BOID_H
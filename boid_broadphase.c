@@ -0,0 +1,750 @@
+#define _POSIX_C_SOURCE 199309L // clock_gettime
+
+#include "boid_broadphase.h"
+#include "boid_hash.h"
+
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define KD_LEAF_SIZE 8
+#define KD_STACK_DEPTH 64 // Nodes pending in a radius query; trees are about log2(n / 4) deep
+#define SWEEP_MAX_SHIFTS 8 // Per point; past that the re-sort gives up on coherence and sorts afresh
+#define SWEEP_JUMP BOID_CELL_SIZE // Moves farther than this (wrapping, teleports) are re-inserted by merge
+
+static double NowSeconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// ============================================================================
+// NEAREST SETS
+// ============================================================================
+
+void BoidNearestSetInit(BoidNearestSet *set, int k, float maxDist)
+{
+    set->k = (k < 0) ? 0 : (k > BOID_BROADPHASE_MAX_K) ? BOID_BROADPHASE_MAX_K : k;
+    set->count = 0;
+    set->maxDistSqr = (maxDist < sqrtf(FLT_MAX)) ? maxDist * maxDist : FLT_MAX;
+    set->image = 0;
+    set->tests = 0;
+}
+
+static inline void NearestSetSwap(BoidNearestSet *set, int a, int b)
+{
+    float d = set->distSqr[a]; set->distSqr[a] = set->distSqr[b]; set->distSqr[b] = d;
+    int id = set->ids[a]; set->ids[a] = set->ids[b]; set->ids[b] = id;
+    unsigned char image = set->images[a]; set->images[a] = set->images[b]; set->images[b] = image;
+}
+
+// Max-heap over the first count entries
+static void NearestSetSiftDown(BoidNearestSet *set, int i, int count)
+{
+    for (;;)
+    {
+        int largest = i;
+        int l = 2 * i + 1, r = l + 1;
+        if (l < count && set->distSqr[l] > set->distSqr[largest]) largest = l;
+        if (r < count && set->distSqr[r] > set->distSqr[largest]) largest = r;
+        if (largest == i) return;
+        NearestSetSwap(set, i, largest);
+        i = largest;
+    }
+}
+
+void BoidNearestSetOffer(BoidNearestSet *set, int id, float distSqr)
+{
+    set->tests++;
+    if (set->k == 0 || distSqr >= BoidNearestSetBound(set)) return;
+    
+    if (set->count < set->k)
+    {
+        int i = set->count++;
+        set->distSqr[i] = distSqr;
+        set->ids[i] = id;
+        set->images[i] = (unsigned char)set->image;
+        while (i > 0 && set->distSqr[(i - 1) / 2] < set->distSqr[i])
+        {
+            NearestSetSwap(set, i, (i - 1) / 2);
+            i = (i - 1) / 2;
+        }
+        return;
+    }
+    
+    // Replace the farthest
+    set->distSqr[0] = distSqr;
+    set->ids[0] = id;
+    set->images[0] = (unsigned char)set->image;
+    NearestSetSiftDown(set, 0, set->count);
+}
+
+void BoidNearestSetSort(BoidNearestSet *set)
+{
+    for (int end = set->count - 1; end > 0; end--)
+    {
+        NearestSetSwap(set, 0, end);
+        NearestSetSiftDown(set, 0, end);
+    }
+}
+
+static inline float DistanceSqr(Vector2 a, float x, float y)
+{
+    float dx = x - a.x, dy = y - a.y;
+    return dx * dx + dy * dy;
+}
+
+// ============================================================================
+// CELL WALKS - Shared by the grid and the hash
+// ============================================================================
+
+// A cell's ids, or 0 for an empty or absent cell
+typedef int (*CellLookup)(const BoidBroadphase *bp, int x, int y, const int **ids);
+
+typedef struct {
+    int minX, minY, maxX, maxY; // Cells that can hold boids
+} CellBounds;
+
+static int CellRadiusQuery(const BoidBroadphase *bp, CellLookup lookup, CellBounds bounds, Vector2 pos, float radius, int *out, int maxResults, int *tests)
+{
+    if (!isfinite(pos.x) || !isfinite(pos.y) || !isfinite(radius)) return 0;
+    
+    // Clamped coordinates: a far-off pos must not overflow the cast
+    int minX = SpatialHashCoord(pos.x - radius, BOID_CELL_SIZE);
+    int maxX = SpatialHashCoord(pos.x + radius, BOID_CELL_SIZE);
+    int minY = SpatialHashCoord(pos.y - radius, BOID_CELL_SIZE);
+    int maxY = SpatialHashCoord(pos.y + radius, BOID_CELL_SIZE);
+    if (minX < bounds.minX) minX = bounds.minX;
+    if (maxX > bounds.maxX) maxX = bounds.maxX;
+    if (minY < bounds.minY) minY = bounds.minY;
+    if (maxY > bounds.maxY) maxY = bounds.maxY;
+    
+    float radiusSqr = radius * radius;
+    int count = 0;
+    int tested = 0;
+    for (long long y = minY; y <= maxY; y++)
+    {
+        for (long long x = minX; x <= maxX; x++)
+        {
+            const int *ids;
+            int n = lookup(bp, (int)x, (int)y, &ids);
+            for (int k = 0; k < n; k++)
+            {
+                int id = ids[k];
+                tested++;
+                if (DistanceSqr(pos, BOID_X(bp->kin, id), BOID_Y(bp->kin, id)) >= radiusSqr) continue;
+                if (count == maxResults) goto done;
+                out[count++] = id;
+            }
+        }
+    }
+done:
+    *tests += tested;
+    return count;
+}
+
+// Rings of cells around pos' cell, nearest ring first. Boids in ring r are at
+// least r - 1 cells away, so the walk stops once the set's bound is inside
+// that or the rings cover every occupied cell.
+static void CellNearestQuery(const BoidBroadphase *bp, CellLookup lookup, CellBounds bounds, Vector2 pos, BoidNearestSet *set)
+{
+    if (bounds.minX > bounds.maxX || bounds.minY > bounds.maxY) return;
+    if (!isfinite(pos.x) || !isfinite(pos.y)) return;
+    
+    // 64-bit so rings around a clamped cell don't overflow
+    long long cx = SpatialHashCoord(pos.x, BOID_CELL_SIZE);
+    long long cy = SpatialHashCoord(pos.y, BOID_CELL_SIZE);
+    
+    for (long long ring = 0; ; ring++)
+    {
+        float gap = (ring > 0) ? (ring - 1) * (float)BOID_CELL_SIZE : 0.0f;
+        if (gap * gap >= BoidNearestSetBound(set)) return;
+        if (cx - ring < bounds.minX && cx + ring > bounds.maxX && cy - ring < bounds.minY && cy + ring > bounds.maxY) return;
+        
+        for (long long y = cy - ring; y <= cy + ring; y++)
+        {
+            if (y < bounds.minY || y > bounds.maxY) continue;
+            
+            // Whole rows at the ring's top and bottom, the two ends elsewhere
+            bool edgeRow = (y == cy - ring || y == cy + ring);
+            long long step = (edgeRow || ring == 0) ? 1 : 2 * ring;
+            for (long long x = cx - ring; x <= cx + ring; x += step)
+            {
+                if (x < bounds.minX || x > bounds.maxX) continue;
+                
+                const int *ids;
+                int n = lookup(bp, (int)x, (int)y, &ids);
+                for (int k = 0; k < n; k++)
+                {
+                    int id = ids[k];
+                    BoidNearestSetOffer(set, id, DistanceSqr(pos, BOID_X(bp->kin, id), BOID_Y(bp->kin, id)));
+                }
+            }
+        }
+    }
+}
+
+// ============================================================================
+// GRID - The world's cells, as built by SpatialGridUpdateSystem
+// ============================================================================
+
+typedef struct {
+    BoidBroadphase base;
+    const SpatialGrid *grid;
+} GridBroadphase;
+
+static int GridLookup(const BoidBroadphase *bp, int x, int y, const int **ids)
+{
+    const GridCell *cell = SpatialGridCellAt(((const GridBroadphase *)bp)->grid, x, y);
+    *ids = cell->entities;
+    return cell->count;
+}
+
+static CellBounds GridBounds(const GridBroadphase *bp)
+{
+    return (CellBounds){ 0, 0, bp->grid->width - 1, bp->grid->height - 1 };
+}
+
+static bool GridBuild(BoidBroadphase *bp, const BoidKinematics *kin, const BoidEntity *ent, int count)
+{
+    (void)kin, (void)ent, (void)count;
+    const SpatialGrid *grid = ((GridBroadphase *)bp)->grid;
+    bp->stats.bytes = (size_t)grid->paddedWidth * grid->paddedHeight * sizeof(GridCell);
+    return true;
+}
+
+static int GridQueryRadius(const BoidBroadphase *bp, Vector2 pos, float radius, int *out, int maxResults, int *tests)
+{
+    return CellRadiusQuery(bp, GridLookup, GridBounds((const GridBroadphase *)bp), pos, radius, out, maxResults, tests);
+}
+
+static void GridQueryNearest(const BoidBroadphase *bp, Vector2 pos, BoidNearestSet *set)
+{
+    CellNearestQuery(bp, GridLookup, GridBounds((const GridBroadphase *)bp), pos, set);
+}
+
+static void GridDestroy(BoidBroadphase *bp)
+{
+    free(bp);
+}
+
+static const BoidBroadphaseOps gridOps = { GridBuild, GridQueryRadius, GridQueryNearest, GridDestroy };
+
+// ============================================================================
+// POINTS - Position copies for the kd-tree and the sweep
+// ============================================================================
+
+typedef struct {
+    float x, y;
+    int id;
+} BroadphasePoint;
+
+// Active boids in id order; returns how many
+static int GatherPoints(BroadphasePoint *out, const BoidKinematics *kin, const BoidEntity *ent, int count)
+{
+    int n = 0;
+    for (int i = 0; i < count; i++)
+    {
+        if (ent[i].active) out[n++] = (BroadphasePoint){ BOID_X(kin, i), BOID_Y(kin, i), i };
+    }
+    return n;
+}
+
+static inline float PointAxis(const BroadphasePoint *p, int axis)
+{
+    return axis ? p->y : p->x;
+}
+
+static inline void SwapPoints(BroadphasePoint *a, BroadphasePoint *b)
+{
+    BroadphasePoint t = *a;
+    *a = *b;
+    *b = t;
+}
+
+// ============================================================================
+// KD-TREE
+// ============================================================================
+
+typedef struct {
+    float split;    // Points left of it have coordinate <= split, right >= split
+    int axis;       // 0 = x, 1 = y, -1 = leaf
+    int begin, end; // Leaf points
+    int left, right;
+} KdNode;
+
+typedef struct {
+    BoidBroadphase base;
+    BroadphasePoint *points; // Permuted so every node's points are a run
+    int count;
+    KdNode *nodes;
+    int nodeCount;
+    int root; // -1 when empty
+} KdTreeBroadphase;
+
+// Every leaf of a median-split tree holds at least (KD_LEAF_SIZE + 1) / 2
+// points, which bounds the leaves and so the nodes
+static int KdMaxNodes(int capacity)
+{
+    return 2 * (capacity / ((KD_LEAF_SIZE + 1) / 2) + 1);
+}
+
+// Hoare partitioning until points[nth] is the nth smallest on axis, with
+// nothing larger before it and nothing smaller after
+static void KdSelect(BroadphasePoint *points, int begin, int end, int nth, int axis)
+{
+    int lo = begin, hi = end - 1;
+    while (lo < hi)
+    {
+        float pivot = PointAxis(&points[(lo + hi) / 2], axis);
+        int i = lo, j = hi;
+        while (i <= j)
+        {
+            while (PointAxis(&points[i], axis) < pivot) i++;
+            while (PointAxis(&points[j], axis) > pivot) j--;
+            if (i <= j) SwapPoints(&points[i++], &points[j--]);
+        }
+        if (nth <= j) hi = j;
+        else if (nth >= i) lo = i;
+        else return;
+    }
+}
+
+static int KdBuildNode(KdTreeBroadphase *tree, int begin, int end)
+{
+    int node = tree->nodeCount++;
+    KdNode *n = &tree->nodes[node];
+    
+    if (end - begin <= KD_LEAF_SIZE)
+    {
+        *n = (KdNode){ 0.0f, -1, begin, end, -1, -1 };
+        return node;
+    }
+    
+    // Split the wider extent
+    float minX = FLT_MAX, maxX = -FLT_MAX, minY = FLT_MAX, maxY = -FLT_MAX;
+    for (int i = begin; i < end; i++)
+    {
+        const BroadphasePoint *p = &tree->points[i];
+        minX = (p->x < minX) ? p->x : minX;
+        maxX = (p->x > maxX) ? p->x : maxX;
+        minY = (p->y < minY) ? p->y : minY;
+        maxY = (p->y > maxY) ? p->y : maxY;
+    }
+    int axis = (maxY - minY > maxX - minX);
+    int mid = (begin + end) / 2;
+    KdSelect(tree->points, begin, end, mid, axis);
+    
+    float split = PointAxis(&tree->points[mid], axis);
+    int left = KdBuildNode(tree, begin, mid);
+    int right = KdBuildNode(tree, mid, end);
+    tree->nodes[node] = (KdNode){ split, axis, begin, end, left, right };
+    return node;
+}
+
+static bool KdBuild(BoidBroadphase *bp, const BoidKinematics *kin, const BoidEntity *ent, int count)
+{
+    KdTreeBroadphase *tree = (KdTreeBroadphase *)bp;
+    tree->count = GatherPoints(tree->points, kin, ent, count);
+    tree->nodeCount = 0;
+    tree->root = tree->count ? KdBuildNode(tree, 0, tree->count) : -1;
+    bp->stats.bytes = (size_t)tree->count * sizeof(BroadphasePoint) + (size_t)tree->nodeCount * sizeof(KdNode);
+    return true;
+}
+
+static int KdQueryRadius(const BoidBroadphase *bp, Vector2 pos, float radius, int *out, int maxResults, int *tests)
+{
+    const KdTreeBroadphase *tree = (const KdTreeBroadphase *)bp;
+    if (tree->root < 0) return 0;
+    
+    float radiusSqr = radius * radius;
+    int stack[KD_STACK_DEPTH];
+    int top = 0;
+    int count = 0;
+    int tested = 0;
+    stack[top++] = tree->root;
+    
+    while (top > 0)
+    {
+        const KdNode *n = &tree->nodes[stack[--top]];
+        if (n->axis < 0)
+        {
+            for (int i = n->begin; i < n->end; i++)
+            {
+                const BroadphasePoint *p = &tree->points[i];
+                tested++;
+                if (DistanceSqr(pos, p->x, p->y) >= radiusSqr) continue;
+                if (count == maxResults) goto done;
+                out[count++] = p->id;
+            }
+            continue;
+        }
+        
+        float d = (n->axis ? pos.y : pos.x) - n->split;
+        if (d <= radius) stack[top++] = n->left;
+        if (d >= -radius) stack[top++] = n->right;
+    }
+done:
+    *tests += tested;
+    return count;
+}
+
+// Near child first, so the far one is usually pruned by the set's bound
+static void KdNearestNode(const KdTreeBroadphase *tree, int node, Vector2 pos, BoidNearestSet *set)
+{
+    const KdNode *n = &tree->nodes[node];
+    if (n->axis < 0)
+    {
+        for (int i = n->begin; i < n->end; i++)
+        {
+            const BroadphasePoint *p = &tree->points[i];
+            BoidNearestSetOffer(set, p->id, DistanceSqr(pos, p->x, p->y));
+        }
+        return;
+    }
+    
+    float d = (n->axis ? pos.y : pos.x) - n->split;
+    KdNearestNode(tree, (d <= 0) ? n->left : n->right, pos, set);
+    if (d * d < BoidNearestSetBound(set)) KdNearestNode(tree, (d <= 0) ? n->right : n->left, pos, set);
+}
+
+static void KdQueryNearest(const BoidBroadphase *bp, Vector2 pos, BoidNearestSet *set)
+{
+    const KdTreeBroadphase *tree = (const KdTreeBroadphase *)bp;
+    if (tree->root >= 0) KdNearestNode(tree, tree->root, pos, set);
+}
+
+static void KdDestroy(BoidBroadphase *bp)
+{
+    KdTreeBroadphase *tree = (KdTreeBroadphase *)bp;
+    free(tree->points);
+    free(tree->nodes);
+    free(tree);
+}
+
+static const BoidBroadphaseOps kdTreeOps = { KdBuild, KdQueryRadius, KdQueryNearest, KdDestroy };
+
+// ============================================================================
+// SORT AND SWEEP
+// ============================================================================
+
+typedef struct {
+    BoidBroadphase base;
+    BroadphasePoint *points; // Ascending x
+    BroadphasePoint *scratch; // Jumped points, then the merge
+    int count;
+    int worldCount; // Boids the last build saw; -1 forces a fresh sort
+} SweepBroadphase;
+
+// By x, then id: a total order, so the incremental and the fresh sort agree
+// and a restored world sweeps its neighbors in the same order
+static inline bool SweepBefore(const BroadphasePoint *a, const BroadphasePoint *b)
+{
+    return a->x < b->x || (a->x == b->x && a->id < b->id);
+}
+
+static int CompareX(const void *a, const void *b)
+{
+    const BroadphasePoint *pa = a, *pb = b;
+    return SweepBefore(pb, pa) - SweepBefore(pa, pb);
+}
+
+// Insertion sort from the last order; false once it has shifted more than
+// SWEEP_MAX_SHIFTS per point (the old order is no help then)
+static bool SweepResort(BroadphasePoint *points, int n)
+{
+    long long budget = (long long)n * SWEEP_MAX_SHIFTS;
+    for (int i = 1; i < n; i++)
+    {
+        BroadphasePoint key = points[i];
+        int j = i - 1;
+        while (j >= 0 && SweepBefore(&key, &points[j]))
+        {
+            points[j + 1] = points[j];
+            j--;
+            if (--budget < 0) return false;
+        }
+        points[j + 1] = key;
+    }
+    return true;
+}
+
+// Same boids as last time (none added or deactivated): refresh positions in
+// the old order, insertion sort the ones that moved a little and merge the
+// few that jumped back in. False if the boids changed or the order is too
+// far gone.
+static bool SweepUpdate(SweepBroadphase *sweep, const BoidKinematics *kin, const BoidEntity *ent, int count)
+{
+    if (count != sweep->worldCount) return false;
+    
+    int active = 0;
+    for (int i = 0; i < count; i++) active += ent[i].active;
+    if (active != sweep->count) return false;
+    
+    int kept = 0, jumped = 0;
+    for (int i = 0; i < sweep->count; i++)
+    {
+        BroadphasePoint p = sweep->points[i];
+        if (!ent[p.id].active) return false;
+        
+        float x = BOID_X(kin, p.id);
+        BroadphasePoint moved = { x, BOID_Y(kin, p.id), p.id };
+        if (fabsf(x - p.x) > SWEEP_JUMP) sweep->scratch[jumped++] = moved;
+        else sweep->points[kept++] = moved;
+    }
+    if (!SweepResort(sweep->points, kept)) return false;
+    if (jumped == 0) return true;
+    
+    // Jumped points to the back of the scratch, then merge from the front
+    qsort(sweep->scratch, jumped, sizeof(BroadphasePoint), CompareX);
+    BroadphasePoint *tail = sweep->scratch + sweep->count - jumped;
+    memmove(tail, sweep->scratch, jumped * sizeof(BroadphasePoint));
+    
+    int a = 0, b = 0, out = 0;
+    while (a < kept || b < jumped)
+    {
+        bool takeKept = (b == jumped) || (a < kept && SweepBefore(&sweep->points[a], &tail[b]));
+        sweep->scratch[out++] = takeKept ? sweep->points[a++] : tail[b++];
+    }
+    
+    BroadphasePoint *swap = sweep->points;
+    sweep->points = sweep->scratch;
+    sweep->scratch = swap;
+    return true;
+}
+
+static bool SweepBuild(BoidBroadphase *bp, const BoidKinematics *kin, const BoidEntity *ent, int count)
+{
+    SweepBroadphase *sweep = (SweepBroadphase *)bp;
+    
+    if (!SweepUpdate(sweep, kin, ent, count))
+    {
+        sweep->count = GatherPoints(sweep->points, kin, ent, count);
+        qsort(sweep->points, sweep->count, sizeof(BroadphasePoint), CompareX);
+    }
+    sweep->worldCount = count;
+    bp->stats.bytes = 2 * (size_t)sweep->count * sizeof(BroadphasePoint);
+    return true;
+}
+
+// First point with x >= value
+static int SweepLowerBound(const SweepBroadphase *sweep, float value)
+{
+    int lo = 0, hi = sweep->count;
+    while (lo < hi)
+    {
+        int mid = (lo + hi) / 2;
+        if (sweep->points[mid].x < value) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+static int SweepQueryRadius(const BoidBroadphase *bp, Vector2 pos, float radius, int *out, int maxResults, int *tests)
+{
+    const SweepBroadphase *sweep = (const SweepBroadphase *)bp;
+    float radiusSqr = radius * radius;
+    float maxX = pos.x + radius;
+    int count = 0;
+    int tested = 0;
+    
+    for (int i = SweepLowerBound(sweep, pos.x - radius); i < sweep->count && sweep->points[i].x <= maxX; i++)
+    {
+        const BroadphasePoint *p = &sweep->points[i];
+        tested++;
+        if (DistanceSqr(pos, p->x, p->y) >= radiusSqr) continue;
+        if (count == maxResults) break;
+        out[count++] = p->id;
+    }
+    *tests += tested;
+    return count;
+}
+
+// Outwards from pos along x, always the closer side next, until the x gap
+// alone beats the set's bound
+static void SweepQueryNearest(const BoidBroadphase *bp, Vector2 pos, BoidNearestSet *set)
+{
+    const SweepBroadphase *sweep = (const SweepBroadphase *)bp;
+    int hi = SweepLowerBound(sweep, pos.x);
+    int lo = hi - 1;
+    
+    while (lo >= 0 || hi < sweep->count)
+    {
+        float left = (lo >= 0) ? pos.x - sweep->points[lo].x : FLT_MAX;
+        float right = (hi < sweep->count) ? sweep->points[hi].x - pos.x : FLT_MAX;
+        float gap = (left < right) ? left : right;
+        if (gap >= FLT_MAX || gap * gap >= BoidNearestSetBound(set)) return;
+        
+        const BroadphasePoint *p = (left < right) ? &sweep->points[lo--] : &sweep->points[hi++];
+        BoidNearestSetOffer(set, p->id, DistanceSqr(pos, p->x, p->y));
+    }
+}
+
+static void SweepDestroy(BoidBroadphase *bp)
+{
+    free(((SweepBroadphase *)bp)->points);
+    free(((SweepBroadphase *)bp)->scratch);
+    free(bp);
+}
+
+static const BoidBroadphaseOps sweepOps = { SweepBuild, SweepQueryRadius, SweepQueryNearest, SweepDestroy };
+
+// ============================================================================
+// HASH - boid_hash.h, cell size BOID_CELL_SIZE
+// ============================================================================
+
+typedef struct {
+    BoidBroadphase base;
+    SpatialHash hash;
+    Vector2 *positions; // AoSoA builds: gathered for SpatialHashBuild
+    CellBounds bounds;  // Occupied cells
+} HashBroadphase;
+
+static int HashLookup(const BoidBroadphase *bp, int x, int y, const int **ids)
+{
+    const SpatialHash *hash = &((const HashBroadphase *)bp)->hash;
+    const SpatialHashCell *cell = SpatialHashFind(hash, x, y);
+    if (!cell) return 0;
+    *ids = hash->entries + cell->start;
+    return cell->count;
+}
+
+static bool HashBuild(BoidBroadphase *bp, const BoidKinematics *kin, const BoidEntity *ent, int count)
+{
+    HashBroadphase *h = (HashBroadphase *)bp;
+#if BOID_AOSOA_LANES
+    for (int i = 0; i < count; i++) h->positions[i] = BoidPosition(kin, i);
+    const Vector2 *positions = h->positions;
+#else
+    const Vector2 *positions = kin->positions;
+#endif
+
+    bool ok = SpatialHashBuild(&h->hash, positions, ent, count);
+    
+    // Cells are in (y, x) order
+    const SpatialHash *hash = &h->hash;
+    h->bounds = (CellBounds){ INT32_MAX, INT32_MAX, INT32_MIN, INT32_MIN };
+    if (hash->cellCount > 0)
+    {
+        h->bounds.minY = hash->cells[0].y;
+        h->bounds.maxY = hash->cells[hash->cellCount - 1].y;
+    }
+    for (int c = 0; c < hash->cellCount; c++)
+    {
+        h->bounds.minX = (hash->cells[c].x < h->bounds.minX) ? hash->cells[c].x : h->bounds.minX;
+        h->bounds.maxX = (hash->cells[c].x > h->bounds.maxX) ? hash->cells[c].x : h->bounds.maxX;
+    }
+    
+    bp->stats.bytes = (size_t)hash->capacity * (2 * sizeof(int) + 2 * sizeof(uint64_t)) + (size_t)hash->cellCapacity * sizeof(SpatialHashCell) +
+                      (size_t)(hash->table ? hash->tableMask + 1 : 0) * sizeof(int);
+    return ok;
+}
+
+static int HashQueryRadius(const BoidBroadphase *bp, Vector2 pos, float radius, int *out, int maxResults, int *tests)
+{
+    return CellRadiusQuery(bp, HashLookup, ((const HashBroadphase *)bp)->bounds, pos, radius, out, maxResults, tests);
+}
+
+static void HashQueryNearest(const BoidBroadphase *bp, Vector2 pos, BoidNearestSet *set)
+{
+    CellNearestQuery(bp, HashLookup, ((const HashBroadphase *)bp)->bounds, pos, set);
+}
+
+static void HashDestroy(BoidBroadphase *bp)
+{
+    HashBroadphase *h = (HashBroadphase *)bp;
+    SpatialHashFree(&h->hash);
+    free(h->positions);
+    free(h);
+}
+
+static const BoidBroadphaseOps hashOps = { HashBuild, HashQueryRadius, HashQueryNearest, HashDestroy };
+
+// ============================================================================
+// INTERFACE
+// ============================================================================
+
+BoidBroadphase *BoidBroadphaseCreate(BoidBroadphaseKind kind, const SpatialGrid *grid, int capacity)
+{
+    BoidBroadphase *bp = NULL;
+    bool ok = false;
+    
+    switch (kind)
+    {
+        case BOID_BROADPHASE_GRID:
+        {
+            GridBroadphase *g = calloc(1, sizeof(GridBroadphase));
+            if (!g) return NULL;
+            g->base.ops = &gridOps;
+            g->grid = grid;
+            bp = &g->base;
+            ok = true;
+            break;
+        }
+        case BOID_BROADPHASE_KDTREE:
+        {
+            KdTreeBroadphase *tree = calloc(1, sizeof(KdTreeBroadphase));
+            if (!tree) return NULL;
+            tree->base.ops = &kdTreeOps;
+            tree->points = malloc(capacity * sizeof(BroadphasePoint));
+            tree->nodes = malloc(KdMaxNodes(capacity) * sizeof(KdNode));
+            tree->root = -1;
+            bp = &tree->base;
+            ok = tree->points && tree->nodes;
+            break;
+        }
+        case BOID_BROADPHASE_SWEEP:
+        {
+            SweepBroadphase *sweep = calloc(1, sizeof(SweepBroadphase));
+            if (!sweep) return NULL;
+            sweep->base.ops = &sweepOps;
+            sweep->points = malloc(capacity * sizeof(BroadphasePoint));
+            sweep->scratch = malloc(capacity * sizeof(BroadphasePoint));
+            sweep->worldCount = -1;
+            bp = &sweep->base;
+            ok = sweep->points && sweep->scratch;
+            break;
+        }
+        case BOID_BROADPHASE_HASH:
+        {
+            HashBroadphase *h = calloc(1, sizeof(HashBroadphase));
+            if (!h) return NULL;
+            h->base.ops = &hashOps;
+            h->bounds = (CellBounds){ 0, 0, -1, -1 };
+            bp = &h->base;
+            ok = SpatialHashInit(&h->hash, BOID_CELL_SIZE);
+#if BOID_AOSOA_LANES
+            h->positions = malloc(capacity * sizeof(Vector2));
+            ok = ok && h->positions;
+#endif
+            break;
+        }
+        default:
+            return NULL;
+    }
+    
+    if (!ok)
+    {
+        BoidBroadphaseDestroy(bp);
+        return NULL;
+    }
+    bp->stats.kind = kind;
+    return bp;
+}
+
+void BoidBroadphaseDestroy(BoidBroadphase *bp)
+{
+    if (bp) bp->ops->destroy(bp);
+}
+
+bool BoidBroadphaseBuild(BoidBroadphase *bp, const BoidKinematics *kin, const BoidEntity *ent, int count)
+{
+    double start = NowSeconds();
+    bp->kin = kin;
+    bool ok = bp->ops->build(bp, kin, ent, count);
+    bp->stats.buildSeconds = NowSeconds() - start;
+    return ok;
+}
@@ -0,0 +1,91 @@
+#ifndef BOID_BROADPHASE_H
+#define BOID_BROADPHASE_H
+
+// ============================================================================
+// BROADPHASE - Interchangeable neighbor indexes behind one interface
+// ============================================================================
+//
+// Every index answers two questions about the positions it was last built
+// from: which boids lie within a radius, and which k lie nearest. Both work
+// in world coordinates without periodic images (the world asks again at the
+// shifted position for those) and only return ids closer than the radius.
+//
+//   grid    The world's SpatialGrid, shared rather than rebuilt; build only
+//           records the kinematics. Cells past MAX_ENTITIES_PER_CELL drop
+//           boids here exactly as they do for the flocking systems.
+//   kdtree  Median splits on the wider axis over a copy of the positions,
+//           leaves of up to KD_LEAF_SIZE points
+//   sweep   Positions sorted by x, kept from the last build and re-sorted by
+//           insertion, which is linear while boids barely move between steps
+//   hash    boid_hash.h's sparse cells, walked like the grid's
+//
+// Internal to the core, like boid_layout.h; hosts pick one through
+// BoidWorldConfig.broadphase or BoidWorldSetBroadphase. Queries are const and
+// safe to run from several threads at once.
+
+#include "boid_layout.h"
+
+// Up to k nearest offers, kept as a max-heap on distance. image tags the
+// entries offered from then on, so queries at several periodic images can
+// share one set.
+typedef struct {
+    int k;
+    int count;
+    float maxDistSqr;
+    int image;
+    int tests; // Offers, i.e. distance tests, since the last init
+    float distSqr[BOID_BROADPHASE_MAX_K];
+    int ids[BOID_BROADPHASE_MAX_K];
+    unsigned char images[BOID_BROADPHASE_MAX_K];
+} BoidNearestSet;
+
+// k is clamped to [0, BOID_BROADPHASE_MAX_K]
+void BoidNearestSetInit(BoidNearestSet *set, int k, float maxDist);
+void BoidNearestSetOffer(BoidNearestSet *set, int id, float distSqr);
+// Squared distance an offer has to beat: the k-th nearest once full
+static inline float BoidNearestSetBound(const BoidNearestSet *set)
+{
+    return (set->count < set->k) ? set->maxDistSqr : set->distSqr[0];
+}
+// Sorts the entries nearest first (the set is no longer a heap)
+void BoidNearestSetSort(BoidNearestSet *set);
+
+typedef struct BoidBroadphase BoidBroadphase;
+
+typedef struct {
+    // False on allocation failure; the index answers nothing then
+    bool (*build)(BoidBroadphase *bp, const BoidKinematics *kin, const BoidEntity *ent, int count);
+    // Up to maxResults ids within radius of pos; returns how many and adds
+    // the distance tests it made to *tests
+    int (*queryRadius)(const BoidBroadphase *bp, Vector2 pos, float radius, int *out, int maxResults, int *tests);
+    // Offers every id that could make the set
+    void (*queryNearest)(const BoidBroadphase *bp, Vector2 pos, BoidNearestSet *set);
+    void (*destroy)(BoidBroadphase *bp);
+} BoidBroadphaseOps;
+
+// Implementations embed this as their first member
+struct BoidBroadphase {
+    const BoidBroadphaseOps *ops;
+    const BoidKinematics *kin; // As of the last build
+    BoidBroadphaseStats stats; // distanceTestsPerBoid and the query counts are the world's to fill
+};
+
+// grid is only read by BOID_BROADPHASE_GRID; capacity sizes the others. NULL
+// on allocation failure.
+BoidBroadphase *BoidBroadphaseCreate(BoidBroadphaseKind kind, const SpatialGrid *grid, int capacity);
+void BoidBroadphaseDestroy(BoidBroadphase *bp);
+
+// Times the build into stats.buildSeconds
+bool BoidBroadphaseBuild(BoidBroadphase *bp, const BoidKinematics *kin, const BoidEntity *ent, int count);
+
+static inline int BoidBroadphaseQueryRadius(const BoidBroadphase *bp, Vector2 pos, float radius, int *out, int maxResults, int *tests)
+{
+    return bp->ops->queryRadius(bp, pos, radius, out, maxResults, tests);
+}
+
+static inline void BoidBroadphaseQueryNearest(const BoidBroadphase *bp, Vector2 pos, BoidNearestSet *set)
+{
+    bp->ops->queryNearest(bp, pos, set);
+}
+
+#endif // BOID_BROADPHASE_H
@@ -0,0 +1,177 @@
+#define _POSIX_C_SOURCE 200809L // strdup, clock_gettime
+
+#include "boid_checkpoint.h"
+#include "boid_writer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// ============================================================================
+// FILE FORMAT
+// ============================================================================
+
+static double NowSeconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static uint64_t Checksum(const void *data, size_t size)
+{
+    const unsigned char *bytes = data;
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+typedef struct {
+    const void *blob;
+    size_t size;
+} CheckpointBlob;
+
+static bool FillCheckpointFile(FILE *file, const void *context)
+{
+    const CheckpointBlob *c = context;
+    uint64_t sum = Checksum(c->blob, c->size);
+    return fwrite(c->blob, 1, c->size, file) == c->size && fwrite(&sum, sizeof(sum), 1, file) == 1;
+}
+
+// blob + checksum, atomically replacing <path>
+static bool WriteCheckpointFile(const char *path, const void *blob, size_t size)
+{
+    CheckpointBlob c = { blob, size };
+    return BoidWriteFileAtomic(path, FillCheckpointFile, &c);
+}
+
+bool BoidCheckpointSave(const char *path, const BoidWorld *world)
+{
+    size_t size = BoidWorldSnapshotSize(world);
+    void *blob = malloc(size);
+    if (!blob) return false;
+    
+    BoidWorldSnapshot(world, blob);
+    bool ok = WriteCheckpointFile(path, blob, size);
+    free(blob);
+    return ok;
+}
+
+BoidWorld *BoidCheckpointLoad(const char *path)
+{
+    return BoidCheckpointLoadWith(path, NULL);
+}
+
+BoidWorld *BoidCheckpointLoadWith(const char *path, const BoidRestoreOptions *options)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file) return NULL;
+    
+    BoidWorld *world = NULL;
+    unsigned char *data = NULL;
+    long size = -1;
+    
+    if (fseek(file, 0, SEEK_END) == 0) size = ftell(file);
+    if (size > (long)sizeof(uint64_t) && fseek(file, 0, SEEK_SET) == 0) data = malloc(size);
+    
+    if (data && fread(data, 1, size, file) == (size_t)size)
+    {
+        size_t blobSize = size - sizeof(uint64_t);
+        uint64_t sum;
+        memcpy(&sum, data + blobSize, sizeof(sum));
+        if (sum == Checksum(data, blobSize)) world = BoidWorldRestoreWith(data, blobSize, options);
+    }
+    
+    free(data);
+    fclose(file);
+    return world;
+}
+
+// ============================================================================
+// BACKGROUND WRITER
+// ============================================================================
+
+struct BoidCheckpointer {
+    char *path;
+    BoidWriter *writer;
+    
+    // The requester's while it holds the writer's claim, the writer's after
+    void *buffer;
+    size_t bufferCapacity;
+    size_t size;
+    
+    double lastCopySeconds; // Requesting thread only
+};
+
+static bool CheckpointWrite(void *context)
+{
+    BoidCheckpointer *cp = context;
+    return WriteCheckpointFile(cp->path, cp->buffer, cp->size);
+}
+
+BoidCheckpointer *BoidCheckpointerCreate(const char *path)
+{
+    BoidCheckpointer *cp = calloc(1, sizeof(BoidCheckpointer));
+    if (!cp) return NULL;
+    
+    cp->path = strdup(path);
+    if (cp->path) cp->writer = BoidWriterCreate(CheckpointWrite, cp);
+    if (!cp->writer)
+    {
+        free(cp->path);
+        free(cp);
+        return NULL;
+    }
+    return cp;
+}
+
+void BoidCheckpointerDestroy(BoidCheckpointer *cp)
+{
+    if (!cp) return;
+    
+    BoidWriterDestroy(cp->writer);
+    free(cp->buffer);
+    free(cp->path);
+    free(cp);
+}
+
+bool BoidCheckpointerRequest(BoidCheckpointer *cp, const BoidWorld *world)
+{
+    if (!BoidWriterClaim(cp->writer)) return false;
+    
+    double start = NowSeconds();
+    size_t size = BoidWorldSnapshotSize(world);
+    if (size > cp->bufferCapacity)
+    {
+        void *grown = realloc(cp->buffer, size);
+        if (!grown)
+        {
+            BoidWriterCancel(cp->writer);
+            return false;
+        }
+        cp->buffer = grown;
+        cp->bufferCapacity = size;
+    }
+    BoidWorldSnapshot(world, cp->buffer);
+    cp->size = size;
+    cp->lastCopySeconds = NowSeconds() - start;
+    
+    BoidWriterSubmit(cp->writer);
+    return true;
+}
+
+BoidCheckpointStats BoidCheckpointerStats(BoidCheckpointer *cp)
+{
+    BoidWriteStats ws = BoidWriterStats(cp->writer);
+    return (BoidCheckpointStats){
+        .written = ws.written,
+        .skipped = ws.skipped,
+        .failed = ws.failed,
+        .lastCopySeconds = cp->lastCopySeconds,
+        .lastWriteSeconds = ws.lastWriteSeconds,
+    };
+}
@@ -0,0 +1,48 @@
+#ifndef BOID_CHECKPOINT_H
+#define BOID_CHECKPOINT_H
+
+// ============================================================================
+// BOID CHECKPOINTS - Crash-safe world snapshots on disk
+// ============================================================================
+//
+// A checkpoint file is a BoidWorldSnapshot blob followed by a 64-bit FNV-1a
+// checksum. Files are written to "<path>.tmp", fsync'd, then renamed over
+// <path>, so a crash at any point leaves either the old or the new checkpoint.
+//
+// The checkpointer does the disk work on a BoidWriter thread. A request only
+// copies the world into a private buffer; if the previous write is still in
+// flight the request is skipped rather than queued, which bounds the cost on
+// the simulation thread to one copy.
+//
+// POSIX only; link with -pthread.
+
+#include "boid.h"
+
+typedef struct BoidCheckpointer BoidCheckpointer;
+
+typedef struct {
+    int written;
+    int skipped; // Requests dropped because a write was still in flight
+    int failed;
+    double lastCopySeconds;  // Snapshot copy on the requesting thread
+    double lastWriteSeconds; // Write + fsync + rename on the background thread
+} BoidCheckpointStats;
+
+// Returns NULL if the background thread cannot be started
+BoidCheckpointer *BoidCheckpointerCreate(const char *path);
+// Waits for an in-flight write before returning
+void BoidCheckpointerDestroy(BoidCheckpointer *checkpointer);
+
+// Snapshots the world and hands it to the writer; false if skipped
+bool BoidCheckpointerRequest(BoidCheckpointer *checkpointer, const BoidWorld *world);
+// From the requesting thread, which owns lastCopySeconds
+BoidCheckpointStats BoidCheckpointerStats(BoidCheckpointer *checkpointer);
+
+// Synchronous versions of the above
+bool BoidCheckpointSave(const char *path, const BoidWorld *world);
+// NULL on a missing, torn or incompatible file
+BoidWorld *BoidCheckpointLoad(const char *path);
+// With BoidWorldRestoreWith's options; NULL options is BoidCheckpointLoad
+BoidWorld *BoidCheckpointLoadWith(const char *path, const BoidRestoreOptions *options);
+
+#endif // BOID_CHECKPOINT_H
@@ -0,0 +1,313 @@
+#define _POSIX_C_SOURCE 200112L // posix_memalign
+
+#include "boid_ensemble.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__AVX__) || defined(__SSE__)
+#include <immintrin.h>
+#endif
+
+// ============================================================================
+// LANE MATH - One float per world; comparisons give 0 / -1 integer masks
+// ============================================================================
+
+typedef float BoidLanes __attribute__((vector_size(BOID_ENSEMBLE_LANES * sizeof(float))));
+typedef int BoidLaneMask __attribute__((vector_size(BOID_ENSEMBLE_LANES * sizeof(int))));
+
+static inline BoidLanes LanesSplat(float v)
+{
+    BoidLanes out;
+    for (int l = 0; l < BOID_ENSEMBLE_LANES; l++) out[l] = v;
+    return out;
+}
+
+// Mask to 1.0f / 0.0f, so selects become multiplies
+static inline BoidLanes LanesFromMask(BoidLaneMask m)
+{
+    return -__builtin_convertvector(m, BoidLanes);
+}
+
+static inline BoidLanes LanesSqrt(BoidLanes v)
+{
+#if defined(__AVX__) && BOID_ENSEMBLE_LANES == 8
+    return (BoidLanes)_mm256_sqrt_ps((__m256)v);
+#elif defined(__SSE__) && BOID_ENSEMBLE_LANES % 4 == 0
+    union { BoidLanes v; __m128 q[BOID_ENSEMBLE_LANES / 4]; } u = { v };
+    for (int h = 0; h < BOID_ENSEMBLE_LANES / 4; h++) u.q[h] = _mm_sqrt_ps(u.q[h]);
+    return u.v;
+#else
+    for (int l = 0; l < BOID_ENSEMBLE_LANES; l++) v[l] = __builtin_sqrtf(v[l]);
+    return v;
+#endif
+}
+
+// Vector2Limit per lane
+static inline void LanesLimit(BoidLanes *x, BoidLanes *y, BoidLanes max)
+{
+    BoidLanes magSq = *x * *x + *y * *y;
+    BoidLanes over = LanesFromMask(magSq > max * max);
+    BoidLanes scale = over * max / LanesSqrt(magSq + (1.0f - over)) + (1.0f - over);
+    *x *= scale;
+    *y *= scale;
+}
+
+// ============================================================================
+// ENSEMBLE
+// ============================================================================
+
+struct BoidEnsemble {
+    int count; // Boids per world
+    int width, height;
+    
+    // Lane-interleaved components: x[i][l] is boid i of world l
+    BoidLanes *x, *y;
+    BoidLanes *vx, *vy;
+    BoidLanes *ax, *ay;
+    
+    // Per-lane params, pre-splatted for the kernels
+    BoidLanes perceptionSqr, separationSqr;
+    BoidLanes maxSpeed, maxForce;
+    BoidLanes separationWeight, alignmentWeight, cohesionWeight;
+    BoidLanes wrapWidth, wrapHeight; // World size on periodic lanes, 0 elsewhere
+    
+    BoidParams params[BOID_ENSEMBLE_LANES];
+};
+
+// The bounds a BoidWorld applies, so a lane flocks like one
+static inline float ClampRadius(float r)
+{
+    r = (r > 0.0f) ? r : 0.0f;
+    return (r < BOID_CELL_SIZE) ? r : BOID_CELL_SIZE;
+}
+
+BoidEnsemble *BoidEnsembleCreate(int boidsPerWorld, int width, int height, int border,
+    const BoidParams params[BOID_ENSEMBLE_LANES], const uint64_t seeds[BOID_ENSEMBLE_LANES])
+{
+    if (boidsPerWorld < 1) return NULL;
+    
+    // The splatted params need vector alignment too, which calloc does not promise
+    void *self;
+    if (posix_memalign(&self, sizeof(BoidLanes), sizeof(BoidEnsemble)) != 0) return NULL;
+    memset(self, 0, sizeof(BoidEnsemble));
+    BoidEnsemble *ensemble = self;
+    
+    ensemble->count = boidsPerWorld;
+    ensemble->width = width;
+    ensemble->height = height;
+    
+    void *block;
+    if (posix_memalign(&block, sizeof(BoidLanes), 6 * boidsPerWorld * sizeof(BoidLanes)) != 0)
+    {
+        free(ensemble);
+        return NULL;
+    }
+    memset(block, 0, 6 * boidsPerWorld * sizeof(BoidLanes));
+    
+    BoidLanes *lanes = block;
+    ensemble->x = lanes;
+    ensemble->y = lanes + boidsPerWorld;
+    ensemble->vx = lanes + 2 * boidsPerWorld;
+    ensemble->vy = lanes + 3 * boidsPerWorld;
+    ensemble->ax = lanes + 4 * boidsPerWorld;
+    ensemble->ay = lanes + 5 * boidsPerWorld;
+    
+    for (int l = 0; l < BOID_ENSEMBLE_LANES; l++)
+    {
+        BoidParams p = params[l];
+        ensemble->params[l] = p;
+        float perception = ClampRadius(p.perceptionRadius);
+        float separation = ClampRadius(p.separationRadius);
+        ensemble->perceptionSqr[l] = perception * perception;
+        ensemble->separationSqr[l] = separation * separation;
+        ensemble->maxSpeed[l] = p.maxSpeed;
+        ensemble->maxForce[l] = p.maxForce;
+        ensemble->separationWeight[l] = p.separationWeight;
+        ensemble->alignmentWeight[l] = p.alignmentWeight;
+        ensemble->cohesionWeight[l] = p.cohesionWeight;
+        ensemble->wrapWidth[l] = p.periodic ? (float)width : 0.0f;
+        ensemble->wrapHeight[l] = p.periodic ? (float)height : 0.0f;
+        
+        // Spawn through a scalar world so lane l matches a BoidWorld with the same seed
+        BoidWorldConfig config = { .capacity = boidsPerWorld, .width = width, .height = height, .seed = seeds[l], .params = p };
+        BoidWorld *world = BoidWorldCreate(&config);
+        if (!world)
+        {
+            BoidEnsembleDestroy(ensemble);
+            return NULL;
+        }
+        
+        BoidWorldSpawnRandom(world, boidsPerWorld, border);
+        Vector2 *pos = BoidWorldPositions(world);
+        Vector2 *vel = BoidWorldVelocities(world);
+        
+        for (int i = 0; i < boidsPerWorld; i++)
+        {
+            ensemble->x[i][l] = pos[i].x;
+            ensemble->y[i][l] = pos[i].y;
+            ensemble->vx[i][l] = vel[i].x;
+            ensemble->vy[i][l] = vel[i].y;
+        }
+        BoidWorldDestroy(world);
+    }
+    
+    return ensemble;
+}
+
+void BoidEnsembleDestroy(BoidEnsemble *ensemble)
+{
+    if (!ensemble) return;
+    free(ensemble->x);
+    free(ensemble);
+}
+
+// ============================================================================
+// KERNELS - Same rules as the BoidWorld systems, all lanes at once
+// ============================================================================
+
+// Mean of n summed samples, steered towards at maxSpeed, force-limited and
+// weighted; zero on lanes with no samples
+static inline void SteerLanes(BoidLanes sumX, BoidLanes sumY, BoidLanes n, BoidLanes velX, BoidLanes velY,
+    const BoidEnsemble *e, BoidLanes weight, BoidLanes *accX, BoidLanes *accY)
+{
+    BoidLanes has = LanesFromMask(n > 0.0f);
+    BoidLanes invN = has / (n + (1.0f - has));
+    BoidLanes x = sumX * invN;
+    BoidLanes y = sumY * invN;
+    
+    // Vector2SetMag(maxSpeed)
+    BoidLanes mag = LanesSqrt(x * x + y * y);
+    BoidLanes nonZero = LanesFromMask(mag > 0.0f);
+    BoidLanes scale = nonZero * e->maxSpeed / (mag + (1.0f - nonZero)) + (1.0f - nonZero);
+    x = x * scale - velX;
+    y = y * scale - velY;
+    
+    LanesLimit(&x, &y, e->maxForce);
+    
+    *accX += has * weight * x;
+    *accY += has * weight * y;
+}
+
+// Separation, alignment and cohesion in one brute-force pass over the boids
+static void EnsembleSteeringSystem(BoidEnsemble *e)
+{
+    BoidLanes halfWidth = e->wrapWidth * 0.5f;
+    BoidLanes halfHeight = e->wrapHeight * 0.5f;
+    
+    for (int i = 0; i < e->count; i++)
+    {
+        BoidLanes xi = e->x[i], yi = e->y[i];
+        BoidLanes zero = LanesSplat(0.0f);
+        BoidLanes sepX = zero, sepY = zero, sepN = zero;
+        BoidLanes aliX = zero, aliY = zero;
+        BoidLanes cohX = zero, cohY = zero, perN = zero;
+        
+        for (int j = 0; j < e->count; j++)
+        {
+            if (j == i) continue;
+            
+            BoidLanes dx = xi - e->x[j];
+            BoidLanes dy = yi - e->y[j];
+            
+            // Nearest periodic image; wrap sizes are 0 on bounded lanes
+            dx += e->wrapWidth * (LanesFromMask(dx < -halfWidth) - LanesFromMask(dx > halfWidth));
+            dy += e->wrapHeight * (LanesFromMask(dy < -halfHeight) - LanesFromMask(dy > halfHeight));
+            
+            BoidLanes distSqr = dx * dx + dy * dy;
+            
+            BoidLanes inSeparation = LanesFromMask((distSqr < e->separationSqr) & (distSqr > 0.0f));
+            BoidLanes inPerception = LanesFromMask(distSqr < e->perceptionSqr);
+            
+            // diff / dist, with the divisor nudged to 1 where the lane is masked out
+            BoidLanes invDist = inSeparation / LanesSqrt(distSqr + (1.0f - inSeparation));
+            sepX += dx * invDist;
+            sepY += dy * invDist;
+            sepN += inSeparation;
+            
+            aliX += inPerception * e->vx[j];
+            aliY += inPerception * e->vy[j];
+            cohX -= inPerception * dx; // Sum of (other - self)
+            cohY -= inPerception * dy;
+            perN += inPerception;
+        }
+        
+        BoidLanes vxi = e->vx[i], vyi = e->vy[i];
+        BoidLanes accX = zero, accY = zero;
+        
+        SteerLanes(sepX, sepY, sepN, vxi, vyi, e, e->separationWeight, &accX, &accY);
+        SteerLanes(aliX, aliY, perN, vxi, vyi, e, e->alignmentWeight, &accX, &accY);
+        SteerLanes(cohX, cohY, perN, vxi, vyi, e, e->cohesionWeight, &accX, &accY);
+        
+        e->ax[i] = accX;
+        e->ay[i] = accY;
+    }
+}
+
+static void EnsemblePhysicsSystem(BoidEnsemble *e)
+{
+    BoidLanes width = LanesSplat((float)e->width);
+    BoidLanes height = LanesSplat((float)e->height);
+    
+    for (int i = 0; i < e->count; i++)
+    {
+        BoidLanes vx = e->vx[i] + e->ax[i];
+        BoidLanes vy = e->vy[i] + e->ay[i];
+        LanesLimit(&vx, &vy, e->maxSpeed);
+        
+        BoidLanes x = e->x[i] + vx;
+        BoidLanes y = e->y[i] + vy;
+        
+        // WrapAroundSystem
+        x += width * LanesFromMask(x < 0.0f);
+        x -= width * LanesFromMask(x >= width);
+        y += height * LanesFromMask(y < 0.0f);
+        y -= height * LanesFromMask(y >= height);
+        
+        e->vx[i] = vx;
+        e->vy[i] = vy;
+        e->x[i] = x;
+        e->y[i] = y;
+    }
+}
+
+void BoidEnsembleStep(BoidEnsemble *ensemble, int steps)
+{
+    for (int step = 0; step < steps; step++)
+    {
+        EnsembleSteeringSystem(ensemble);
+        EnsemblePhysicsSystem(ensemble);
+    }
+}
+
+// ============================================================================
+// LANE ACCESS
+// ============================================================================
+
+void BoidEnsembleGetWorld(const BoidEnsemble *ensemble, int lane, Vector2 *positions, Vector2 *velocities)
+{
+    for (int i = 0; i < ensemble->count; i++)
+    {
+        if (positions) positions[i] = (Vector2){ ensemble->x[i][lane], ensemble->y[i][lane] };
+        if (velocities) velocities[i] = (Vector2){ ensemble->vx[i][lane], ensemble->vy[i][lane] };
+    }
+}
+
+FlockMetrics BoidEnsembleMeasureFlock(const BoidEnsemble *ensemble, int lane)
+{
+    FlockMetrics metrics = { 0 };
+    
+    BoidWorldConfig config = { .capacity = ensemble->count, .width = ensemble->width, .height = ensemble->height, .params = ensemble->params[lane] };
+    BoidWorld *world = BoidWorldCreate(&config);
+    if (!world) return metrics;
+    
+    for (int i = 0; i < ensemble->count; i++)
+    {
+        Vector2 pos = { ensemble->x[i][lane], ensemble->y[i][lane] };
+        Vector2 vel = { ensemble->vx[i][lane], ensemble->vy[i][lane] };
+        BoidWorldAddBoid(world, pos, vel, (BoidColor){ 0 });
+    }
+    
+    metrics = BoidWorldMeasureFlock(world);
+    BoidWorldDestroy(world);
+    return metrics;
+}
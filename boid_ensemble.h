@@ -0,0 +1,44 @@
+#ifndef BOID_ENSEMBLE_H
+#define BOID_ENSEMBLE_H
+
+// ============================================================================
+// BOID ENSEMBLE - BOID_ENSEMBLE_LANES small worlds advanced in SIMD lockstep
+// ============================================================================
+//
+// Boid i of every world is stored side by side, one world per SIMD lane, so a
+// single kernel pass over the boids advances all worlds at once. Neighbors
+// are found by brute force, which beats a grid at a few hundred boids and
+// keeps every lane on the same instruction stream.
+//
+// All worlds share a size and boid count; each keeps its own params and seed.
+// maxNeighbors and substeps are ignored (always unlimited / 1).
+//
+// Build alongside boid.c; GCC or Clang (vector extensions). Lanes fill one
+// register: 8 with -mavx, 4 otherwise. Compile every user with the same flags.
+
+#include "boid.h"
+
+#if defined(__AVX__)
+#define BOID_ENSEMBLE_LANES 8
+#else
+#define BOID_ENSEMBLE_LANES 4
+#endif
+
+typedef struct BoidEnsemble BoidEnsemble;
+
+// Lane l starts exactly like BoidWorldSpawnRandom(world, boidsPerWorld, border)
+// on a world created with seeds[l]. Returns NULL on bad sizes or allocation
+// failure.
+BoidEnsemble *BoidEnsembleCreate(int boidsPerWorld, int width, int height, int border,
+    const BoidParams params[BOID_ENSEMBLE_LANES], const uint64_t seeds[BOID_ENSEMBLE_LANES]);
+void BoidEnsembleDestroy(BoidEnsemble *ensemble);
+
+void BoidEnsembleStep(BoidEnsemble *ensemble, int steps);
+
+// Copies one lane's boids out, boidsPerWorld entries each
+void BoidEnsembleGetWorld(const BoidEnsemble *ensemble, int lane, Vector2 *positions, Vector2 *velocities);
+
+// BoidWorldMeasureFlock on one lane
+FlockMetrics BoidEnsembleMeasureFlock(const BoidEnsemble *ensemble, int lane);
+
+#endif // BOID_ENSEMBLE_H
@@ -0,0 +1,249 @@
+#include "boid_flowfield.h"
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// 8-connected neighbors; diagonals cost sqrt(2)
+static const int neighborDx[8] = { 1, -1, 0, 0, 1, 1, -1, -1 };
+static const int neighborDy[8] = { 0, 0, 1, -1, 1, -1, 1, -1 };
+static const float neighborCost[8] = { 1, 1, 1, 1, 1.41421356f, 1.41421356f, 1.41421356f, 1.41421356f };
+
+// ============================================================================
+// LIFETIME
+// ============================================================================
+
+bool FlowFieldInit(FlowField *field, int width, int height, float cellSize)
+{
+    memset(field, 0, sizeof(FlowField));
+    field->width = width;
+    field->height = height;
+    field->cellSize = cellSize;
+    
+    // Lazy-deletion Dijkstra pushes at most once per relaxed edge
+    int cells = width * height;
+    field->heapCapacity = 8 * cells + 1;
+    field->direction = calloc(cells, sizeof(Vector2));
+    field->distance = malloc(cells * sizeof(float));
+    field->heap = malloc(field->heapCapacity * sizeof(FlowHeapEntry));
+    
+    if (!field->direction || !field->distance || !field->heap)
+    {
+        FlowFieldFree(field);
+        return false;
+    }
+    return true;
+}
+
+void FlowFieldFree(FlowField *field)
+{
+    free(field->direction);
+    free(field->distance);
+    free(field->heap);
+    memset(field, 0, sizeof(FlowField));
+}
+
+// ============================================================================
+// DIJKSTRA - Binary min-heap on distance
+// ============================================================================
+
+static void HeapPush(FlowField *field, float distance, int cell)
+{
+    FlowHeapEntry *heap = field->heap;
+    int i = field->heapCount++;
+    while (i > 0)
+    {
+        int parent = (i - 1) / 2;
+        if (heap[parent].distance <= distance) break;
+        heap[i] = heap[parent];
+        i = parent;
+    }
+    heap[i] = (FlowHeapEntry){ distance, cell };
+}
+
+static FlowHeapEntry HeapPop(FlowField *field)
+{
+    FlowHeapEntry *heap = field->heap;
+    FlowHeapEntry top = heap[0];
+    FlowHeapEntry last = heap[--field->heapCount];
+    int n = field->heapCount;
+    
+    int i = 0;
+    for (;;)
+    {
+        int child = 2 * i + 1;
+        if (child >= n) break;
+        if (child + 1 < n && heap[child + 1].distance < heap[child].distance) child++;
+        if (last.distance <= heap[child].distance) break;
+        heap[i] = heap[child];
+        i = child;
+    }
+    if (n > 0) heap[i] = last;
+    return top;
+}
+
+static inline bool InBounds(const FlowField *field, int x, int y, int d)
+{
+    int nx = x + neighborDx[d], ny = y + neighborDy[d];
+    return nx >= 0 && ny >= 0 && nx < field->width && ny < field->height;
+}
+
+// Diagonal steps may not squeeze between two blocked orthogonal cells
+static inline bool CanStep(const FlowField *field, const unsigned char *blocked, int x, int y, int d)
+{
+    int nx = x + neighborDx[d], ny = y + neighborDy[d];
+    if (!InBounds(field, x, y, d)) return false;
+    if (blocked[ny * field->width + nx]) return false;
+    if (d < 4) return true;
+    return !blocked[y * field->width + nx] && !blocked[ny * field->width + x];
+}
+
+void FlowFieldRequest(FlowField *field, Vector2 goal)
+{
+    int cells = field->width * field->height;
+    for (int c = 0; c < cells; c++) field->distance[c] = FLT_MAX;
+    
+    int gx = (int)(goal.x / field->cellSize);
+    int gy = (int)(goal.y / field->cellSize);
+    if (gx < 0) gx = 0;
+    if (gy < 0) gy = 0;
+    if (gx >= field->width) gx = field->width - 1;
+    if (gy >= field->height) gy = field->height - 1;
+    
+    field->goal = goal;
+    field->building = true;
+    field->heapCount = 0;
+    field->distance[gy * field->width + gx] = 0;
+    HeapPush(field, 0, gy * field->width + gx);
+}
+
+// Each reachable cell points at its cheapest neighbor; the goal cell at the goal
+static void ComputeDirections(FlowField *field, const unsigned char *blocked)
+{
+    for (int y = 0; y < field->height; y++)
+    {
+        for (int x = 0; x < field->width; x++)
+        {
+            int c = y * field->width + x;
+            Vector2 dir = { 0, 0 };
+            
+            if (field->distance[c] == 0)
+            {
+                Vector2 center = { (x + 0.5f) * field->cellSize, (y + 0.5f) * field->cellSize };
+                dir = (Vector2){ field->goal.x - center.x, field->goal.y - center.y };
+            }
+            else
+            {
+                // Blocked cells (thin walls leave boids inside them) lead out
+                // to their best open neighbor
+                float best = field->distance[c];
+                for (int d = 0; d < 8; d++)
+                {
+                    if (blocked[c] ? !InBounds(field, x, y, d) : !CanStep(field, blocked, x, y, d)) continue;
+                    float nd = field->distance[(y + neighborDy[d]) * field->width + x + neighborDx[d]];
+                    if (nd < best)
+                    {
+                        best = nd;
+                        dir = (Vector2){ (float)neighborDx[d], (float)neighborDy[d] };
+                    }
+                }
+            }
+            
+            float length = sqrtf(dir.x * dir.x + dir.y * dir.y);
+            field->direction[c] = (length > 0) ? (Vector2){ dir.x / length, dir.y / length } : (Vector2){ 0, 0 };
+        }
+    }
+}
+
+bool FlowFieldUpdate(FlowField *field, const unsigned char *blocked, int budget)
+{
+    if (!field->building) return false;
+    
+    for (int settled = 0; field->heapCount > 0 && (budget <= 0 || settled < budget); settled++)
+    {
+        FlowHeapEntry entry = HeapPop(field);
+        if (entry.distance > field->distance[entry.cell]) continue; // Stale
+        
+        int x = entry.cell % field->width;
+        int y = entry.cell / field->width;
+        for (int d = 0; d < 8; d++)
+        {
+            if (!CanStep(field, blocked, x, y, d)) continue;
+            
+            int n = (y + neighborDy[d]) * field->width + x + neighborDx[d];
+            float nd = entry.distance + neighborCost[d];
+            if (nd < field->distance[n])
+            {
+                field->distance[n] = nd;
+                HeapPush(field, nd, n);
+            }
+        }
+    }
+    
+    if (field->heapCount > 0) return false;
+    
+    // Pass finished: publish it in one go
+    ComputeDirections(field, blocked);
+    field->building = false;
+    return true;
+}
+
+// ============================================================================
+// BLOCKED CELLS
+// ============================================================================
+
+// Liang-Barsky clip of segment ab against the box
+static bool SegmentHitsBox(Vector2 a, Vector2 b, float x0, float y0, float x1, float y1)
+{
+    float t0 = 0, t1 = 1;
+    float d[2] = { b.x - a.x, b.y - a.y };
+    float p[2] = { a.x, a.y };
+    float lo[2] = { x0, y0 };
+    float hi[2] = { x1, y1 };
+    
+    for (int axis = 0; axis < 2; axis++)
+    {
+        if (d[axis] == 0)
+        {
+            if (p[axis] < lo[axis] || p[axis] > hi[axis]) return false;
+            continue;
+        }
+        float ta = (lo[axis] - p[axis]) / d[axis];
+        float tb = (hi[axis] - p[axis]) / d[axis];
+        if (ta > tb)
+        {
+            float tmp = ta;
+            ta = tb;
+            tb = tmp;
+        }
+        if (ta > t0) t0 = ta;
+        if (tb < t1) t1 = tb;
+        if (t0 > t1) return false;
+    }
+    return true;
+}
+
+void FlowFieldBlockSegments(unsigned char *blocked, int width, int height, float cellSize, const ObstacleSegment *segments, int count)
+{
+    memset(blocked, 0, (size_t)width * height);
+    
+    for (int s = 0; s < count; s++)
+    {
+        Vector2 a = segments[s].a, b = segments[s].b;
+        int minX = (int)floorf(fminf(a.x, b.x) / cellSize), maxX = (int)floorf(fmaxf(a.x, b.x) / cellSize);
+        int minY = (int)floorf(fminf(a.y, b.y) / cellSize), maxY = (int)floorf(fmaxf(a.y, b.y) / cellSize);
+        if (minX < 0) minX = 0;
+        if (minY < 0) minY = 0;
+        if (maxX >= width) maxX = width - 1;
+        if (maxY >= height) maxY = height - 1;
+        
+        for (int y = minY; y <= maxY; y++)
+        {
+            for (int x = minX; x <= maxX; x++)
+            {
+                if (SegmentHitsBox(a, b, x * cellSize, y * cellSize, (x + 1) * cellSize, (y + 1) * cellSize))
+                    blocked[y * width + x] = 1;
+            }
+        }
+    }
+}
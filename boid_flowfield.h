@@ -0,0 +1,62 @@
+#ifndef BOID_FLOWFIELD_H
+#define BOID_FLOWFIELD_H
+
+// ============================================================================
+// FLOW FIELD - Shared goal-seeking directions over the grid cells
+// ============================================================================
+//
+// One field per goal: a Dijkstra pass (8-connected, no corner cutting past
+// blocked cells) gives every cell its path distance to the goal cell, and each
+// cell points at its cheapest neighbor. Boids sample their cell's direction in
+// O(1).
+//
+// Rebuilds are time-sliced: FlowFieldRequest starts a new pass in a back
+// buffer, FlowFieldUpdate settles at most a budget of cells per call, and the
+// finished field is swapped in whole. Boids keep following the previous field
+// until then, so a moving goal or new obstacle never stalls a frame.
+
+#include "boid.h"
+
+typedef struct {
+    float distance;
+    int cell;
+} FlowHeapEntry;
+
+typedef struct FlowField {
+    int width, height; // Cells
+    float cellSize;
+    Vector2 goal;
+    
+    Vector2 *direction; // Front: unit per cell, zero where unreachable
+    
+    // Back buffer and Dijkstra state of the pass in progress
+    bool building;
+    float *distance;
+    FlowHeapEntry *heap;
+    int heapCount;
+    int heapCapacity;
+} FlowField;
+
+bool FlowFieldInit(FlowField *field, int width, int height, float cellSize);
+void FlowFieldFree(FlowField *field);
+
+// Restarts the back pass towards goal; the front field stays in use
+void FlowFieldRequest(FlowField *field, Vector2 goal);
+
+// Settles up to budget cells (<= 0: finish the pass) and swaps the field in
+// when done. blocked is width * height bytes, non-zero = impassable. Returns
+// true when a new field was swapped in.
+bool FlowFieldUpdate(FlowField *field, const unsigned char *blocked, int budget);
+
+static inline Vector2 FlowFieldSample(const FlowField *field, Vector2 pos)
+{
+    int x = (int)(pos.x / field->cellSize);
+    int y = (int)(pos.y / field->cellSize);
+    if (x < 0 || y < 0 || x >= field->width || y >= field->height) return (Vector2){ 0, 0 };
+    return field->direction[y * field->width + x];
+}
+
+// Marks every cell a segment passes through
+void FlowFieldBlockSegments(unsigned char *blocked, int width, int height, float cellSize, const ObstacleSegment *segments, int count);
+
+#endif // BOID_FLOWFIELD_H
@@ -0,0 +1,279 @@
+#include "boid_hash.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ============================================================================
+// CELL KEYS
+// ============================================================================
+
+// Sign-flipped so unsigned order is (y, x) order, matching grid row-major scans
+static inline uint64_t CellKey(int32_t x, int32_t y)
+{
+    return ((uint64_t)((uint32_t)y ^ 0x80000000u) << 32) | ((uint32_t)x ^ 0x80000000u);
+}
+
+int32_t SpatialHashCoord(float pos, float cellSize)
+{
+    // Clamped before the cast, which is undefined outside the int32 range
+    float c = floorf(pos / cellSize);
+    if (c <= (float)INT32_MIN) return INT32_MIN;
+    if (c >= 2147483648.0f) return INT32_MAX;
+    return (int32_t)c;
+}
+
+static inline uint32_t HashCellKey(uint64_t key)
+{
+    key ^= key >> 31;
+    key *= 0xbf58476d1ce4e5b9ull;
+    key ^= key >> 29;
+    return (uint32_t)key;
+}
+
+// ============================================================================
+// BUILD
+// ============================================================================
+
+bool SpatialHashInit(SpatialHash *hash, float cellSize)
+{
+    memset(hash, 0, sizeof(SpatialHash));
+    hash->cellSize = cellSize;
+    return cellSize > 0;
+}
+
+void SpatialHashFree(SpatialHash *hash)
+{
+    free(hash->entries);
+    free(hash->keys);
+    free(hash->scratchKeys);
+    free(hash->scratchIds);
+    free(hash->cells);
+    free(hash->table);
+    memset(hash, 0, sizeof(SpatialHash));
+}
+
+static bool GrowEntries(SpatialHash *hash, int needed)
+{
+    if (needed <= hash->capacity) return true;
+    
+    int capacity = hash->capacity ? hash->capacity : 256;
+    while (capacity < needed) capacity *= 2;
+    
+    int *entries = realloc(hash->entries, capacity * sizeof(int));
+    if (entries) hash->entries = entries;
+    uint64_t *keys = realloc(hash->keys, capacity * sizeof(uint64_t));
+    if (keys) hash->keys = keys;
+    uint64_t *scratchKeys = realloc(hash->scratchKeys, capacity * sizeof(uint64_t));
+    if (scratchKeys) hash->scratchKeys = scratchKeys;
+    int *scratchIds = realloc(hash->scratchIds, capacity * sizeof(int));
+    if (scratchIds) hash->scratchIds = scratchIds;
+    
+    if (!entries || !keys || !scratchKeys || !scratchIds) return false;
+    hash->capacity = capacity;
+    return true;
+}
+
+// Stable LSD radix sort on 8-bit digits; digits shared by every key (usually
+// the high ones, since flocks span few cells) are skipped
+static void SortEntries(SpatialHash *hash, int n)
+{
+    uint64_t *keys = hash->keys, *tmpKeys = hash->scratchKeys;
+    int *ids = hash->entries, *tmpIds = hash->scratchIds;
+    
+    for (int shift = 0; shift < 64; shift += 8)
+    {
+        int counts[256] = { 0 };
+        for (int i = 0; i < n; i++) counts[(keys[i] >> shift) & 0xff]++;
+        if (counts[(keys[0] >> shift) & 0xff] == n) continue;
+        
+        int offset = 0;
+        for (int d = 0; d < 256; d++)
+        {
+            int c = counts[d];
+            counts[d] = offset;
+            offset += c;
+        }
+        
+        for (int i = 0; i < n; i++)
+        {
+            int dst = counts[(keys[i] >> shift) & 0xff]++;
+            tmpKeys[dst] = keys[i];
+            tmpIds[dst] = ids[i];
+        }
+        
+        uint64_t *swapKeys = keys; keys = tmpKeys; tmpKeys = swapKeys;
+        int *swapIds = ids; ids = tmpIds; tmpIds = swapIds;
+    }
+    
+    // Results live wherever the last pass left them
+    hash->keys = keys;
+    hash->scratchKeys = tmpKeys;
+    hash->entries = ids;
+    hash->scratchIds = tmpIds;
+}
+
+static bool IndexCells(SpatialHash *hash)
+{
+    int n = hash->count;
+    
+    int runs = 0;
+    for (int i = 0; i < n; i++) runs += (i == 0 || hash->keys[i] != hash->keys[i - 1]);
+    
+    if (runs > hash->cellCapacity)
+    {
+        SpatialHashCell *cells = realloc(hash->cells, runs * sizeof(SpatialHashCell));
+        if (!cells) return false;
+        hash->cells = cells;
+        hash->cellCapacity = runs;
+    }
+    
+    // At most half full, so probe chains stay short
+    int tableSize = 16;
+    while (tableSize < 2 * runs) tableSize *= 2;
+    if (tableSize > hash->tableMask + 1 || !hash->table)
+    {
+        int *table = realloc(hash->table, tableSize * sizeof(int));
+        if (!table) return false;
+        hash->table = table;
+        hash->tableMask = tableSize - 1;
+    }
+    memset(hash->table, 0xff, (hash->tableMask + 1) * sizeof(int));
+    
+    hash->cellCount = 0;
+    hash->stats.maxOccupancy = 0;
+    for (int i = 0; i < n; )
+    {
+        uint64_t key = hash->keys[i];
+        int start = i;
+        while (i < n && hash->keys[i] == key) i++;
+        
+        int c = hash->cellCount++;
+        hash->cells[c] = (SpatialHashCell){
+            .x = (int32_t)((uint32_t)key ^ 0x80000000u),
+            .y = (int32_t)((uint32_t)(key >> 32) ^ 0x80000000u),
+            .start = start,
+            .count = i - start,
+        };
+        if (i - start > hash->stats.maxOccupancy) hash->stats.maxOccupancy = i - start;
+        
+        uint32_t slot = HashCellKey(key) & hash->tableMask;
+        while (hash->table[slot] >= 0) slot = (slot + 1) & hash->tableMask;
+        hash->table[slot] = c;
+    }
+    hash->stats.occupiedCells = hash->cellCount;
+    return true;
+}
+
+bool SpatialHashBuild(SpatialHash *hash, const Vector2 *pos, const BoidEntity *ent, int count)
+{
+    hash->count = 0;
+    hash->cellCount = 0;
+    hash->stats = (SpatialHashStats){ 0 };
+    
+    if (!GrowEntries(hash, count)) return false;
+    
+    int n = 0;
+    for (int i = 0; i < count; i++)
+    {
+        if (!ent[i].active) continue;
+        if (!isfinite(pos[i].x) || !isfinite(pos[i].y))
+        {
+            hash->stats.skippedBoids++;
+            continue;
+        }
+        
+        int32_t x = SpatialHashCoord(pos[i].x, hash->cellSize);
+        int32_t y = SpatialHashCoord(pos[i].y, hash->cellSize);
+        hash->keys[n] = CellKey(x, y);
+        hash->entries[n] = i;
+        n++;
+    }
+    hash->count = n;
+    if (n == 0) return true;
+    
+    SortEntries(hash, n);
+    if (IndexCells(hash)) return true;
+    
+    hash->count = 0;
+    hash->cellCount = 0;
+    return false;
+}
+
+// ============================================================================
+// QUERIES
+// ============================================================================
+
+const SpatialHashCell *SpatialHashFind(const SpatialHash *hash, int x, int y)
+{
+    if (hash->cellCount == 0) return NULL;
+    
+    uint64_t key = CellKey(x, y);
+    uint32_t slot = HashCellKey(key) & hash->tableMask;
+    
+    for (;;)
+    {
+        int c = hash->table[slot];
+        if (c < 0) return NULL;
+        
+        const SpatialHashCell *cell = &hash->cells[c];
+        if (cell->x == x && cell->y == y) return cell;
+        slot = (slot + 1) & hash->tableMask;
+    }
+}
+
+static inline bool AppendCell(const SpatialHash *hash, const SpatialHashCell *cell, int *outEntities, int *outCount, int maxResults)
+{
+    int n = cell->count;
+    bool truncated = false;
+    if (n > maxResults - *outCount)
+    {
+        n = maxResults - *outCount;
+        truncated = true;
+    }
+    
+    memcpy(outEntities + *outCount, hash->entries + cell->start, n * sizeof(int));
+    *outCount += n;
+    return truncated;
+}
+
+void SpatialHashQuery(SpatialHash *hash, Vector2 pos, float radius, int *outEntities, int *outCount, int maxResults)
+{
+    *outCount = 0;
+    bool truncated = false;
+    if (!isfinite(pos.x) || !isfinite(pos.y) || !isfinite(radius)) return;
+    
+    int32_t minX = SpatialHashCoord(pos.x - radius, hash->cellSize);
+    int32_t maxX = SpatialHashCoord(pos.x + radius, hash->cellSize);
+    int32_t minY = SpatialHashCoord(pos.y - radius, hash->cellSize);
+    int32_t maxY = SpatialHashCoord(pos.y + radius, hash->cellSize);
+    
+    // Probe each covered cell, or walk the occupied cells when there are
+    // fewer of those; both visit cells in (y, x) order. 64-bit throughout:
+    // the spans and the loop counters can pass INT32_MAX, and the width is
+    // checked first so the product can't overflow either.
+    long long spanX = (long long)maxX - minX + 1;
+    long long spanY = (long long)maxY - minY + 1;
+    
+    if (spanX <= hash->cellCount && spanX * spanY <= hash->cellCount)
+    {
+        for (long long y = minY; y <= maxY; y++)
+        {
+            for (long long x = minX; x <= maxX; x++)
+            {
+                const SpatialHashCell *cell = SpatialHashFind(hash, (int32_t)x, (int32_t)y);
+                if (cell) truncated |= AppendCell(hash, cell, outEntities, outCount, maxResults);
+            }
+        }
+    }
+    else
+    {
+        for (int c = 0; c < hash->cellCount; c++)
+        {
+            const SpatialHashCell *cell = &hash->cells[c];
+            if (cell->x < minX || cell->x > maxX || cell->y < minY || cell->y > maxY) continue;
+            truncated |= AppendCell(hash, cell, outEntities, outCount, maxResults);
+        }
+    }
+    
+    if (truncated) hash->stats.truncatedQueries++;
+}
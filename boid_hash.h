@@ -0,0 +1,66 @@
+#ifndef BOID_HASH_H
+#define BOID_HASH_H
+
+// ============================================================================
+// SPATIAL HASH - Sparse broadphase for unbounded worlds
+// ============================================================================
+//
+// Only occupied cells are stored. Each build sorts (cell key, id) pairs into
+// one compact entry array, then indexes the runs with an open-addressing
+// table keyed on cell coordinates. Memory is proportional to the boid count
+// plus the occupied cell count, independent of how far apart flocks roam.
+//
+// Queries return the same ids in the same order as BoidWorldQuery does for a
+// grid of the same cell size (minus any grid cell overflow).
+
+#include "boid.h"
+
+typedef struct {
+    int32_t x, y;     // Cell coordinates, SpatialHashCoord
+    int start, count; // Run in SpatialHash.entries
+} SpatialHashCell;
+
+typedef struct {
+    int occupiedCells;
+    int maxOccupancy;
+    int truncatedQueries; // SpatialHashQuery calls cut off at maxResults
+    int skippedBoids;     // Active boids left out of the build: non-finite position
+} SpatialHashStats;
+
+typedef struct {
+    float cellSize;
+    
+    int count;       // Entries in the last build
+    int capacity;    // Entry arrays grow to fit
+    int *entries;    // Boid ids grouped by cell, ascending within a cell
+    uint64_t *keys;  // Sort keys, parallel to entries
+    uint64_t *scratchKeys;
+    int *scratchIds;
+    
+    SpatialHashCell *cells; // Occupied cells in (y, x) order
+    int cellCount;
+    int cellCapacity;
+    
+    int *table; // Open addressing, linear probing: index into cells or -1
+    int tableMask;
+    
+    SpatialHashStats stats;
+} SpatialHash;
+
+bool SpatialHashInit(SpatialHash *hash, float cellSize);
+void SpatialHashFree(SpatialHash *hash);
+
+// floor(pos / cellSize) clamped to the int32 range; pos must be finite
+int32_t SpatialHashCoord(float pos, float cellSize);
+
+// Rebuilds from the active boids; false on allocation failure (hash left empty)
+bool SpatialHashBuild(SpatialHash *hash, const Vector2 *pos, const BoidEntity *ent, int count);
+
+// NULL for an empty cell
+const SpatialHashCell *SpatialHashFind(const SpatialHash *hash, int x, int y);
+
+// Flat id list of cells overlapping the radius; stops at maxResults. Empty
+// for a non-finite pos or radius.
+void SpatialHashQuery(SpatialHash *hash, Vector2 pos, float radius, int *outEntities, int *outCount, int maxResults);
+
+#endif // BOID_HASH_H
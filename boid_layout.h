@@ -0,0 +1,121 @@
+#ifndef BOID_LAYOUT_H
+#define BOID_LAYOUT_H
+
+// ============================================================================
+// LAYOUT - Compile-time storage of positions and velocities
+// ============================================================================
+//
+// Default: struct of arrays, one Vector2 array each for positions and
+// velocities. Build with -DBOID_AOSOA_LANES=8 (or 16) for array of structs of
+// arrays: boids are grouped into blocks of that many, each block holding
+// x[], y[], vx[] and vy[] lanes, so a neighbor's position and velocity sit in
+// one block and a block's lanes fill SIMD registers.
+//
+// Systems go through the accessors below and compile against either layout.
+// Internal to the core; hosts keep seeing Vector2 arrays (see boid.h).
+// Compile every core file with the same flag.
+
+#include "boid.h"
+#include <string.h>
+
+#ifndef BOID_AOSOA_LANES
+#define BOID_AOSOA_LANES 0
+#endif
+
+#if BOID_AOSOA_LANES != 0 && BOID_AOSOA_LANES != 8 && BOID_AOSOA_LANES != 16
+#error "BOID_AOSOA_LANES must be 0 (SoA), 8 or 16"
+#endif
+
+#if BOID_AOSOA_LANES
+
+typedef struct {
+    float x[BOID_AOSOA_LANES];
+    float y[BOID_AOSOA_LANES];
+    float vx[BOID_AOSOA_LANES];
+    float vy[BOID_AOSOA_LANES];
+} BoidBlock;
+
+typedef struct {
+    BoidBlock *blocks; // (capacity + BOID_AOSOA_LANES - 1) / BOID_AOSOA_LANES
+} BoidKinematics;
+
+// Unsigned so the power-of-two divide is a shift
+#define BOID_BLOCK(k, i) ((k)->blocks[(unsigned)(i) / BOID_AOSOA_LANES])
+#define BOID_LANE(i) ((unsigned)(i) % BOID_AOSOA_LANES)
+
+#define BOID_X(k, i) (BOID_BLOCK(k, i).x[BOID_LANE(i)])
+#define BOID_Y(k, i) (BOID_BLOCK(k, i).y[BOID_LANE(i)])
+#define BOID_VX(k, i) (BOID_BLOCK(k, i).vx[BOID_LANE(i)])
+#define BOID_VY(k, i) (BOID_BLOCK(k, i).vy[BOID_LANE(i)])
+
+#define BOID_LAYOUT_NAME (BOID_AOSOA_LANES == 8 ? "aosoa8" : "aosoa16")
+
+#else
+
+typedef struct {
+    Vector2 *positions;
+    Vector2 *velocities;
+} BoidKinematics;
+
+#define BOID_X(k, i) ((k)->positions[i].x)
+#define BOID_Y(k, i) ((k)->positions[i].y)
+#define BOID_VX(k, i) ((k)->velocities[i].x)
+#define BOID_VY(k, i) ((k)->velocities[i].y)
+
+#define BOID_LAYOUT_NAME "soa"
+
+#endif
+
+static inline Vector2 BoidPosition(const BoidKinematics *k, int i)
+{
+    return (Vector2){ BOID_X(k, i), BOID_Y(k, i) };
+}
+
+static inline Vector2 BoidVelocity(const BoidKinematics *k, int i)
+{
+    return (Vector2){ BOID_VX(k, i), BOID_VY(k, i) };
+}
+
+static inline void SetBoidPosition(BoidKinematics *k, int i, Vector2 v)
+{
+    BOID_X(k, i) = v.x;
+    BOID_Y(k, i) = v.y;
+}
+
+static inline void SetBoidVelocity(BoidKinematics *k, int i, Vector2 v)
+{
+    BOID_VX(k, i) = v.x;
+    BOID_VY(k, i) = v.y;
+}
+
+// Vector2 copies for hosts and snapshots. Under SoA the kinematics are the
+// Vector2 arrays themselves between steps: import is a no-op, and export only
+// copies when a fused pass left the state in its back buffer.
+static inline void KinematicsExport(const BoidKinematics *k, Vector2 *pos, Vector2 *vel, int count)
+{
+#if BOID_AOSOA_LANES
+    for (int i = 0; i < count; i++)
+    {
+        pos[i] = BoidPosition(k, i);
+        vel[i] = BoidVelocity(k, i);
+    }
+#else
+    if (k->positions != pos) memcpy(pos, k->positions, count * sizeof(Vector2));
+    if (k->velocities != vel) memcpy(vel, k->velocities, count * sizeof(Vector2));
+#endif
+}
+
+static inline void KinematicsImport(BoidKinematics *k, const Vector2 *pos, const Vector2 *vel, int count)
+{
+#if BOID_AOSOA_LANES
+    for (int i = 0; i < count; i++)
+    {
+        SetBoidPosition(k, i, pos[i]);
+        SetBoidVelocity(k, i, vel[i]);
+    }
+#else
+    (void)k, (void)pos, (void)vel, (void)count;
+#endif
+}
+
+#endif // BOID_LAYOUT_H
@@ -0,0 +1,90 @@
+#define _DEFAULT_SOURCE // MAP_ANONYMOUS, madvise
+
+#include "boid_memory.h"
+#include <stdlib.h>
+#include <string.h>
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#endif
+
+#define HUGE_PAGE_SIZE (2u << 20) // x86-64 and arm64 default
+
+static size_t RoundUp(size_t size, size_t to)
+{
+    return (size + to - 1) / to * to;
+}
+
+bool BoidArenaInit(BoidArena *arena, size_t size, BoidPageMode pages)
+{
+    memset(arena, 0, sizeof(BoidArena));
+    if (size == 0) size = 1;
+
+#if defined(MAP_ANONYMOUS)
+#if defined(MAP_HUGETLB)
+    if (pages == BOID_PAGES_EXPLICIT)
+    {
+        size_t hugeSize = RoundUp(size, HUGE_PAGE_SIZE);
+        void *p = mmap(NULL, hugeSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p != MAP_FAILED)
+        {
+            *arena = (BoidArena){ p, hugeSize, 0, BOID_PAGES_EXPLICIT, true };
+            return true;
+        }
+    }
+#endif
+
+    // Transparent huge pages only form inside 2 MB aligned ranges: map one
+    // page extra and trim to an aligned start
+    size_t mapSize = RoundUp(size, HUGE_PAGE_SIZE);
+    bool wantHuge = (pages != BOID_PAGES_DEFAULT);
+    size_t slack = wantHuge ? HUGE_PAGE_SIZE : 0;
+    unsigned char *p = mmap(NULL, mapSize + slack, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p != MAP_FAILED)
+    {
+        unsigned char *start = p;
+        if (wantHuge)
+        {
+            start = (unsigned char *)RoundUp((size_t)p, HUGE_PAGE_SIZE);
+            if (start > p) munmap(p, start - p);
+            if (start + mapSize < p + mapSize + slack) munmap(start + mapSize, p + mapSize + slack - (start + mapSize));
+        }
+        
+        BoidPageMode obtained = BOID_PAGES_DEFAULT;
+#if defined(MADV_HUGEPAGE)
+        if (wantHuge && madvise(start, mapSize, MADV_HUGEPAGE) == 0) obtained = BOID_PAGES_TRANSPARENT;
+#endif
+        *arena = (BoidArena){ start, mapSize, 0, obtained, true };
+        return true;
+    }
+#else
+    (void)pages;
+#endif
+
+    unsigned char *fallback = calloc(1, size + BOID_ARENA_ALIGN);
+    if (!fallback) return false;
+    *arena = (BoidArena){ fallback, size + BOID_ARENA_ALIGN, 0, BOID_PAGES_DEFAULT, false };
+    return true;
+}
+
+void BoidArenaFree(BoidArena *arena)
+{
+#if defined(MAP_ANONYMOUS)
+    if (arena->mapped)
+    {
+        munmap(arena->base, arena->size);
+        memset(arena, 0, sizeof(BoidArena));
+        return;
+    }
+#endif
+    free(arena->base);
+    memset(arena, 0, sizeof(BoidArena));
+}
+
+void *BoidArenaTake(BoidArena *arena, size_t size)
+{
+    // The calloc fallback is not aligned itself, so align the address
+    size_t start = RoundUp((size_t)arena->base + arena->used, BOID_ARENA_ALIGN) - (size_t)arena->base;
+    arena->used = start + RoundUp(size, BOID_ARENA_ALIGN);
+    if (!arena->base || arena->used > arena->size) return NULL;
+    return arena->base + start;
+}
@@ -0,0 +1,47 @@
+#ifndef BOID_MEMORY_H
+#define BOID_MEMORY_H
+
+// ============================================================================
+// MEMORY - One arena per world, optionally on huge pages
+// ============================================================================
+//
+// All per-boid arrays and the grid cells are carved out of a single mapping,
+// so huge pages cover them with a handful of TLB entries. The mapping is left
+// untouched: whichever thread first writes a page decides its NUMA node, and
+// the world has each worker zero its own slice before anything else runs.
+// The pages stay where they were placed while the workers may not, so the
+// placement only holds with BoidWorldConfig.pinWorkers.
+//
+// Explicit huge pages (MAP_HUGETLB) need pages reserved by the admin and fall
+// back to transparent ones (madvise MADV_HUGEPAGE), which fall back to plain
+// pages; without mmap the arena is one calloc. BoidArena.pages says what was
+// actually obtained.
+
+#include "boid.h"
+
+#define BOID_ARENA_ALIGN 64 // Every array starts on its own cache line
+
+typedef struct {
+    unsigned char *base; // NULL while only measuring
+    size_t size;
+    size_t used;
+    BoidPageMode pages;
+    bool mapped; // munmap rather than free
+} BoidArena;
+
+// Zero-size arena that only adds up BoidArenaTake requests
+static inline BoidArena BoidArenaMeasure(void)
+{
+    return (BoidArena){ 0 };
+}
+
+// Maps size bytes with the best pages available up to the requested mode;
+// false on failure
+bool BoidArenaInit(BoidArena *arena, size_t size, BoidPageMode pages);
+void BoidArenaFree(BoidArena *arena);
+
+// Next BOID_ARENA_ALIGN-aligned size bytes, not yet touched (reads as zero).
+// NULL when measuring or out of space.
+void *BoidArenaTake(BoidArena *arena, size_t size);
+
+#endif // BOID_MEMORY_H
@@ -0,0 +1,224 @@
+#include "boid_obstacles.h"
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define OBSTACLE_LEAF_SIZE 4
+#define OBSTACLE_STACK_SIZE 64    // Median splits keep depth near log2(segments / leaf)
+#define OBSTACLE_BATCH_LEAVES 128 // Candidate leaves gathered per pass
+
+// ============================================================================
+// BUILD
+// ============================================================================
+
+// Twice the centroid; only the order matters
+static inline float SegmentCentroid(const ObstacleSegment *s, int axis)
+{
+    return axis ? s->a.y + s->b.y : s->a.x + s->b.x;
+}
+
+// Quickselect: segments[k] ends up where a full sort would put it
+static void SelectMedian(ObstacleSegment *segments, int count, int k, int axis)
+{
+    int lo = 0, hi = count - 1;
+    while (lo < hi)
+    {
+        float pivot = SegmentCentroid(&segments[(lo + hi) / 2], axis);
+        int i = lo, j = hi;
+        while (i <= j)
+        {
+            while (SegmentCentroid(&segments[i], axis) < pivot) i++;
+            while (SegmentCentroid(&segments[j], axis) > pivot) j--;
+            if (i <= j)
+            {
+                ObstacleSegment tmp = segments[i];
+                segments[i++] = segments[j];
+                segments[j--] = tmp;
+            }
+        }
+        if (k <= j) hi = j;
+        else if (k >= i) lo = i;
+        else return;
+    }
+}
+
+static void BuildNode(ObstacleBvh *bvh, int nodeIndex, int first, int count)
+{
+    ObstacleBvhNode *node = &bvh->nodes[nodeIndex];
+    node->min = (Vector2){ FLT_MAX, FLT_MAX };
+    node->max = (Vector2){ -FLT_MAX, -FLT_MAX };
+    
+    Vector2 cmin = node->min, cmax = node->max;
+    for (int i = first; i < first + count; i++)
+    {
+        ObstacleSegment *s = &bvh->segments[i];
+        node->min.x = fminf(node->min.x, fminf(s->a.x, s->b.x));
+        node->min.y = fminf(node->min.y, fminf(s->a.y, s->b.y));
+        node->max.x = fmaxf(node->max.x, fmaxf(s->a.x, s->b.x));
+        node->max.y = fmaxf(node->max.y, fmaxf(s->a.y, s->b.y));
+        
+        float cx = SegmentCentroid(s, 0), cy = SegmentCentroid(s, 1);
+        cmin.x = fminf(cmin.x, cx);
+        cmin.y = fminf(cmin.y, cy);
+        cmax.x = fmaxf(cmax.x, cx);
+        cmax.y = fmaxf(cmax.y, cy);
+    }
+    
+    if (count <= OBSTACLE_LEAF_SIZE)
+    {
+        node->first = first;
+        node->count = count;
+        return;
+    }
+    
+    // Median on the wider centroid axis: balanced, so the depth stays bounded
+    int axis = (cmax.y - cmin.y > cmax.x - cmin.x) ? 1 : 0;
+    int half = count / 2;
+    SelectMedian(bvh->segments + first, count, half, axis);
+    
+    int left = bvh->nodeCount;
+    bvh->nodeCount += 2;
+    node->first = left;
+    node->count = 0;
+    
+    BuildNode(bvh, left, first, half);
+    BuildNode(bvh, left + 1, first + half, count - half);
+}
+
+bool ObstacleBvhBuild(ObstacleBvh *bvh, const ObstacleSegment *segments, int count)
+{
+    memset(bvh, 0, sizeof(ObstacleBvh));
+    if (count <= 0) return true;
+    
+    bvh->segments = malloc(count * sizeof(ObstacleSegment));
+    bvh->nodes = malloc((2 * count - 1) * sizeof(ObstacleBvhNode));
+    if (!bvh->segments || !bvh->nodes)
+    {
+        ObstacleBvhFree(bvh);
+        return false;
+    }
+    
+    memcpy(bvh->segments, segments, count * sizeof(ObstacleSegment));
+    bvh->segmentCount = count;
+    bvh->nodeCount = 1;
+    BuildNode(bvh, 0, 0, count);
+    return true;
+}
+
+void ObstacleBvhFree(ObstacleBvh *bvh)
+{
+    free(bvh->segments);
+    free(bvh->nodes);
+    memset(bvh, 0, sizeof(ObstacleBvh));
+}
+
+// ============================================================================
+// BATCHED NEAREST QUERY
+// ============================================================================
+
+static inline float BoxDistanceSqr(const ObstacleBvhNode *node, Vector2 p)
+{
+    float dx = fmaxf(fmaxf(node->min.x - p.x, 0.0f), p.x - node->max.x);
+    float dy = fmaxf(fmaxf(node->min.y - p.y, 0.0f), p.y - node->max.y);
+    return dx * dx + dy * dy;
+}
+
+static inline Vector2 ClosestPointOnSegment(const ObstacleSegment *s, Vector2 p)
+{
+    Vector2 ab = { s->b.x - s->a.x, s->b.y - s->a.y };
+    float lengthSqr = ab.x * ab.x + ab.y * ab.y;
+    float t = (lengthSqr > 0) ? ((p.x - s->a.x) * ab.x + (p.y - s->a.y) * ab.y) / lengthSqr : 0.0f;
+    t = fminf(fmaxf(t, 0.0f), 1.0f);
+    return (Vector2){ s->a.x + ab.x * t, s->a.y + ab.y * t };
+}
+
+// Every boid of the batch against the gathered leaves
+static void TestLeaves(const ObstacleBvh *bvh, const int *leaves, int leafCount, const Vector2 *pos, const int *ids, int count, ObstacleHit *hits)
+{
+    for (int i = 0; i < count; i++)
+    {
+        Vector2 p = pos[ids[i]];
+        ObstacleHit *hit = &hits[i];
+        float bestSqr = hit->distance * hit->distance;
+        
+        for (int l = 0; l < leafCount; l++)
+        {
+            const ObstacleBvhNode *leaf = &bvh->nodes[leaves[l]];
+            if (BoxDistanceSqr(leaf, p) >= bestSqr) continue;
+            
+            for (int s = leaf->first; s < leaf->first + leaf->count; s++)
+            {
+                Vector2 c = ClosestPointOnSegment(&bvh->segments[s], p);
+                float dx = p.x - c.x, dy = p.y - c.y;
+                float dSqr = dx * dx + dy * dy;
+                if (dSqr >= bestSqr) continue;
+                
+                bestSqr = dSqr;
+                hit->segment = s;
+                hit->distance = sqrtf(dSqr);
+                if (hit->distance > 0)
+                {
+                    hit->normal = (Vector2){ dx / hit->distance, dy / hit->distance };
+                }
+                else
+                {
+                    // On the segment: push off along its perpendicular
+                    const ObstacleSegment *seg = &bvh->segments[s];
+                    Vector2 d = { seg->b.x - seg->a.x, seg->b.y - seg->a.y };
+                    float len = sqrtf(d.x * d.x + d.y * d.y);
+                    hit->normal = (len > 0) ? (Vector2){ -d.y / len, d.x / len } : (Vector2){ 0, 0 };
+                }
+            }
+        }
+    }
+}
+
+void ObstacleBvhNearestBatch(const ObstacleBvh *bvh, const Vector2 *pos, const int *ids, int count, float lookahead, ObstacleHit *hits)
+{
+    for (int i = 0; i < count; i++) hits[i] = (ObstacleHit){ -1, lookahead, { 0, 0 } };
+    if (count == 0 || bvh->segmentCount == 0) return;
+    
+    // One traversal for the whole batch, against its bounds grown by lookahead
+    ObstacleBvhNode box = { pos[ids[0]], pos[ids[0]], 0, 0 };
+    for (int i = 1; i < count; i++)
+    {
+        Vector2 p = pos[ids[i]];
+        box.min.x = fminf(box.min.x, p.x);
+        box.min.y = fminf(box.min.y, p.y);
+        box.max.x = fmaxf(box.max.x, p.x);
+        box.max.y = fmaxf(box.max.y, p.y);
+    }
+    box.min.x -= lookahead;
+    box.min.y -= lookahead;
+    box.max.x += lookahead;
+    box.max.y += lookahead;
+    
+    int leaves[OBSTACLE_BATCH_LEAVES];
+    int leafCount = 0;
+    int stack[OBSTACLE_STACK_SIZE];
+    int top = 0;
+    stack[top++] = 0;
+    
+    while (top > 0)
+    {
+        const ObstacleBvhNode *node = &bvh->nodes[stack[--top]];
+        if (node->min.x > box.max.x || node->max.x < box.min.x || node->min.y > box.max.y || node->max.y < box.min.y) continue;
+        
+        if (node->count == 0)
+        {
+            stack[top++] = node->first;
+            stack[top++] = node->first + 1;
+            continue;
+        }
+        
+        if (leafCount == OBSTACLE_BATCH_LEAVES)
+        {
+            TestLeaves(bvh, leaves, leafCount, pos, ids, count, hits);
+            leafCount = 0;
+        }
+        leaves[leafCount++] = (int)(node - bvh->nodes);
+    }
+    
+    TestLeaves(bvh, leaves, leafCount, pos, ids, count, hits);
+}
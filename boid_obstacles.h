@@ -0,0 +1,43 @@
+#ifndef BOID_OBSTACLES_H
+#define BOID_OBSTACLES_H
+
+// ============================================================================
+// OBSTACLES - Static segment geometry behind a bounding-volume hierarchy
+// ============================================================================
+//
+// Level geometry is a list of line segments (polygons contribute their edge
+// loops). The BVH is built once, top-down with median splits, and answers
+// "nearest obstacle within lookahead" for a whole batch of nearby boids with a
+// single traversal: the batch's bounds gather candidate leaves, then each boid
+// only tests those.
+
+#include "boid.h"
+
+typedef struct {
+    Vector2 min, max;
+    int first; // Leaf: first segment; internal: left child (right is first + 1)
+    int count; // Leaf: segment count; internal: 0
+} ObstacleBvhNode;
+
+typedef struct {
+    ObstacleSegment *segments; // Reordered into leaf order
+    int segmentCount;
+    ObstacleBvhNode *nodes;    // nodes[0] is the root
+    int nodeCount;
+} ObstacleBvh;
+
+typedef struct {
+    int segment;    // Index into bvh->segments, -1 if nothing within lookahead
+    float distance;
+    Vector2 normal; // Unit, from the closest point towards the boid
+} ObstacleHit;
+
+// Copies the segments; false on allocation failure. An empty list is valid.
+bool ObstacleBvhBuild(ObstacleBvh *bvh, const ObstacleSegment *segments, int count);
+void ObstacleBvhFree(ObstacleBvh *bvh);
+
+// Nearest segment within lookahead of pos[ids[i]] for each i, into hits[i].
+// Cheapest when the boids are close together (e.g. one grid cell).
+void ObstacleBvhNearestBatch(const ObstacleBvh *bvh, const Vector2 *pos, const int *ids, int count, float lookahead, ObstacleHit *hits);
+
+#endif // BOID_OBSTACLES_H
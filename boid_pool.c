@@ -0,0 +1,331 @@
+#define _GNU_SOURCE // pthread_setaffinity_np, sched_getaffinity; clock_gettime
+
+#include "boid_pool.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define POOL_CACHE_LINE 64
+
+// Chase-Lev deque of task indices. Tasks are only pushed by the caller before
+// a run starts, so the buffer never changes while workers read it.
+typedef struct {
+    _Alignas(POOL_CACHE_LINE) atomic_int top; // Next task a thief takes
+    _Alignas(POOL_CACHE_LINE) atomic_int bottom; // One past the owner's next pop
+    int *tasks;
+    int capacity;
+    double runBusy; // This run; folded into stats by the caller
+    BoidWorkerStats stats; // Written by the owner only
+} WorkerDeque;
+
+struct BoidPool {
+    int workers;
+    pthread_t *threads;
+    pthread_mutex_t lock;
+    pthread_cond_t wake; // Workers: a new run or stop
+    pthread_cond_t done; // Caller: the last worker finished
+    
+    // Current run; generation changes once per run
+    BoidPoolTask task;
+    void *context;
+    unsigned generation;
+    int pending;
+    bool stop;
+    
+    // BoidPoolRunTasks state
+    WorkerDeque *deques;
+    BoidPoolRangeTask rangeTask;
+    void *rangeContext;
+    
+    bool pinned;
+#ifdef __linux__
+    cpu_set_t callerAffinity; // Given back to the caller on destroy
+#endif
+};
+
+typedef struct {
+    BoidPool *pool;
+    int worker;
+} PoolThreadArgs;
+
+static double NowSeconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+#ifdef __linux__
+// Worker w gets the w-th CPU of allowed, wrapping around
+static bool PinThread(pthread_t thread, const cpu_set_t *allowed, int worker)
+{
+    int cpus = CPU_COUNT(allowed);
+    if (cpus == 0) return false;
+    
+    int skip = worker % cpus;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+    {
+        if (!CPU_ISSET(cpu, allowed) || skip-- > 0) continue;
+        cpu_set_t one;
+        CPU_ZERO(&one);
+        CPU_SET(cpu, &one);
+        return pthread_setaffinity_np(thread, sizeof(one), &one) == 0;
+    }
+    return false;
+}
+#endif
+
+static void *PoolThread(void *arg)
+{
+    PoolThreadArgs args = *(PoolThreadArgs *)arg;
+    free(arg);
+    BoidPool *pool = args.pool;
+    unsigned seen = 0;
+    
+    pthread_mutex_lock(&pool->lock);
+    for (;;)
+    {
+        while (pool->generation == seen && !pool->stop) pthread_cond_wait(&pool->wake, &pool->lock);
+        if (pool->stop) break;
+        seen = pool->generation;
+        BoidPoolTask task = pool->task;
+        void *context = pool->context;
+        pthread_mutex_unlock(&pool->lock);
+        
+        task(context, args.worker);
+        
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->pending == 0) pthread_cond_signal(&pool->done);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+BoidPool *BoidPoolCreate(int workers, bool pin)
+{
+    BoidPool *pool = calloc(1, sizeof(BoidPool));
+    if (!pool) return NULL;
+    
+    pool->workers = (workers > 1) ? workers : 1;
+    pool->threads = calloc(pool->workers, sizeof(pthread_t));
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    pthread_cond_init(&pool->done, NULL);
+    pool->deques = aligned_alloc(POOL_CACHE_LINE, pool->workers * sizeof(WorkerDeque));
+    if (pool->deques)
+    {
+        for (int w = 0; w < pool->workers; w++) pool->deques[w] = (WorkerDeque){ 0 };
+    }
+    if (!pool->threads || !pool->deques)
+    {
+        BoidPoolDestroy(pool);
+        return NULL;
+    }
+    
+    // Thread w - 1 is worker w; the caller is worker 0
+    for (int w = 1; w < pool->workers; w++)
+    {
+        PoolThreadArgs *args = malloc(sizeof(PoolThreadArgs));
+        if (args) *args = (PoolThreadArgs){ pool, w };
+        if (!args || pthread_create(&pool->threads[w - 1], NULL, PoolThread, args) != 0)
+        {
+            free(args);
+            pool->workers = w; // Join only the threads that started
+            BoidPoolDestroy(pool);
+            return NULL;
+        }
+    }
+
+#ifdef __linux__
+    // The threads are parked until the first run, so nothing has been
+    // touched from the wrong CPU yet
+    if (pin && pthread_getaffinity_np(pthread_self(), sizeof(pool->callerAffinity), &pool->callerAffinity) == 0)
+    {
+        pool->pinned = PinThread(pthread_self(), &pool->callerAffinity, 0);
+        for (int w = 1; w < pool->workers; w++) pool->pinned = PinThread(pool->threads[w - 1], &pool->callerAffinity, w) && pool->pinned;
+    }
+#else
+    (void)pin;
+#endif
+    return pool;
+}
+
+void BoidPoolDestroy(BoidPool *pool)
+{
+    if (!pool) return;
+    
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = true;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+    for (int w = 1; w < pool->workers && pool->threads; w++) pthread_join(pool->threads[w - 1], NULL);
+#ifdef __linux__
+    if (pool->pinned) pthread_setaffinity_np(pthread_self(), sizeof(pool->callerAffinity), &pool->callerAffinity);
+#endif
+
+    pthread_cond_destroy(&pool->done);
+    pthread_cond_destroy(&pool->wake);
+    pthread_mutex_destroy(&pool->lock);
+    for (int w = 0; w < pool->workers && pool->deques; w++) free(pool->deques[w].tasks);
+    free(pool->deques);
+    free(pool->threads);
+    free(pool);
+}
+
+int BoidPoolWorkers(const BoidPool *pool)
+{
+    return pool->workers;
+}
+
+bool BoidPoolPinned(const BoidPool *pool)
+{
+    return pool->pinned;
+}
+
+void BoidPoolRun(BoidPool *pool, BoidPoolTask task, void *context)
+{
+    if (pool->workers == 1)
+    {
+        task(context, 0);
+        return;
+    }
+    
+    pthread_mutex_lock(&pool->lock);
+    pool->task = task;
+    pool->context = context;
+    pool->pending = pool->workers - 1;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+    
+    task(context, 0);
+    
+    pthread_mutex_lock(&pool->lock);
+    while (pool->pending > 0) pthread_cond_wait(&pool->done, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+// ============================================================================
+// WORK STEALING
+// ============================================================================
+
+// Owner end; -1 once empty
+static int DequePop(WorkerDeque *deque)
+{
+    int b = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&deque->bottom, b, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    int t = atomic_load_explicit(&deque->top, memory_order_relaxed);
+    
+    if (t > b)
+    {
+        atomic_store_explicit(&deque->bottom, b + 1, memory_order_relaxed);
+        return -1;
+    }
+    
+    int task = deque->tasks[b];
+    if (t == b)
+    {
+        // Last task: race the thieves for it
+        if (!atomic_compare_exchange_strong_explicit(&deque->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed)) task = -1;
+        atomic_store_explicit(&deque->bottom, b + 1, memory_order_relaxed);
+    }
+    return task;
+}
+
+// Thief end; -1 if empty, -2 if another thread got there first
+static int DequeSteal(WorkerDeque *deque)
+{
+    int t = atomic_load_explicit(&deque->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    int b = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+    if (t >= b) return -1;
+    
+    int task = deque->tasks[t];
+    if (!atomic_compare_exchange_strong_explicit(&deque->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed)) return -2;
+    return task;
+}
+
+static void StealingWorker(void *context, int worker)
+{
+    BoidPool *pool = context;
+    WorkerDeque *own = &pool->deques[worker];
+    own->runBusy = 0.0;
+    
+    for (;;)
+    {
+        bool stolen = false;
+        int task = DequePop(own);
+        
+        // Own deque empty: sweep the others, starting next door. Nothing is
+        // pushed during a run, so one empty sweep means this worker is done.
+        for (int k = 1; task < 0 && k < pool->workers; k++)
+        {
+            WorkerDeque *victim = &pool->deques[(worker + k) % pool->workers];
+            do task = DequeSteal(victim); while (task == -2);
+            stolen = (task >= 0);
+        }
+        if (task < 0) return;
+        
+        double start = NowSeconds();
+        pool->rangeTask(pool->rangeContext, worker, task);
+        own->runBusy += NowSeconds() - start;
+        own->stats.tasks++;
+        own->stats.steals += stolen;
+    }
+}
+
+bool BoidPoolRunTasks(BoidPool *pool, BoidPoolRangeTask task, void *context, const int *owners, int taskCount)
+{
+    // Size every deque first so a failure leaves nothing queued
+    int *counts = calloc(pool->workers, sizeof(int));
+    if (!counts) return false;
+    for (int t = 0; t < taskCount; t++) counts[owners[t]]++;
+    for (int w = 0; w < pool->workers; w++)
+    {
+        WorkerDeque *deque = &pool->deques[w];
+        if (counts[w] <= deque->capacity) continue;
+        
+        int *grown = realloc(deque->tasks, counts[w] * sizeof(int));
+        if (!grown)
+        {
+            free(counts);
+            return false;
+        }
+        deque->tasks = grown;
+        deque->capacity = counts[w];
+    }
+    
+    // Queue back to front: the owner pops its tasks in order while thieves
+    // take the far end of its share
+    for (int t = taskCount - 1; t >= 0; t--)
+    {
+        WorkerDeque *deque = &pool->deques[owners[t]];
+        deque->tasks[atomic_load_explicit(&deque->bottom, memory_order_relaxed)] = t;
+        atomic_fetch_add_explicit(&deque->bottom, 1, memory_order_relaxed);
+    }
+    free(counts);
+    
+    pool->rangeTask = task;
+    pool->rangeContext = context;
+    double start = NowSeconds();
+    BoidPoolRun(pool, StealingWorker, pool);
+    double wall = NowSeconds() - start;
+    
+    for (int w = 0; w < pool->workers; w++)
+    {
+        WorkerDeque *deque = &pool->deques[w];
+        deque->stats.busy += deque->runBusy;
+        deque->stats.idle += (wall > deque->runBusy) ? wall - deque->runBusy : 0.0;
+        atomic_store_explicit(&deque->top, 0, memory_order_relaxed);
+        atomic_store_explicit(&deque->bottom, 0, memory_order_relaxed);
+    }
+    return true;
+}
+
+void BoidPoolStats(const BoidPool *pool, BoidWorkerStats *out)
+{
+    for (int w = 0; w < pool->workers; w++) out[w] = pool->deques[w].stats;
+}
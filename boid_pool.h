@@ -0,0 +1,62 @@
+#ifndef BOID_POOL_H
+#define BOID_POOL_H
+
+// ============================================================================
+// WORKER POOL - Fork/join over a fixed set of threads
+// ============================================================================
+//
+// A pool of n workers is the calling thread plus n - 1 parked threads. Each
+// run hands every worker the same task with its own index and returns once
+// all of them are done, so a task may split its range by worker index and
+// expect worker w to get the same slice on every run. First-touched pages
+// stay local to the thread that uses them only if the thread stays on its
+// NUMA node, so a pool can pin worker w to a CPU of its own (Linux only).
+//
+// Uneven work goes through BoidPoolRunTasks instead: the caller cuts it into
+// tasks and queues each on a worker's deque (Chase-Lev: the owner pops from
+// the bottom, others steal from the top). A worker drains its own deque in
+// order, then steals until every deque is empty. A stolen task runs away
+// from the thief's own pages; that is the price of the balance.
+//
+// POSIX only; link with -pthread.
+
+#include "boid.h"
+
+typedef struct BoidPool BoidPool;
+
+typedef void (*BoidPoolTask)(void *context, int worker);
+typedef void (*BoidPoolRangeTask)(void *context, int worker, int task);
+
+// NULL if a thread cannot be started; workers < 1 is treated as 1. pin puts
+// worker w, the calling thread being worker 0, on the w-th CPU the caller may
+// run on (wrapping); the caller gets its old affinity back on destroy.
+BoidPool *BoidPoolCreate(int workers, bool pin);
+void BoidPoolDestroy(BoidPool *pool);
+
+int BoidPoolWorkers(const BoidPool *pool);
+// True if pinning was asked for and every worker got its CPU
+bool BoidPoolPinned(const BoidPool *pool);
+
+// task(context, w) for every w in [0, workers); the caller runs w = 0
+void BoidPoolRun(BoidPool *pool, BoidPoolTask task, void *context);
+
+// task(context, w, t) once for every t in [0, taskCount), queued on worker
+// owners[t] and run by it unless stolen. False if the deques cannot grow to
+// fit; nothing has run then.
+bool BoidPoolRunTasks(BoidPool *pool, BoidPoolRangeTask task, void *context, const int *owners, int taskCount);
+
+// Cumulative since the pool was created; out has room for every worker
+void BoidPoolStats(const BoidPool *pool, BoidWorkerStats *out);
+
+// [begin, end) of worker w's share of count items, split on multiples of
+// align so neighboring workers never share a cache line or AoSoA block
+static inline void BoidPoolSlice(int count, int workers, int worker, int align, int *begin, int *end)
+{
+    int units = (count + align - 1) / align;
+    int lo = (int)((long long)units * worker / workers) * align;
+    int hi = (int)((long long)units * (worker + 1) / workers) * align;
+    *begin = (lo < count) ? lo : count;
+    *end = (hi < count) ? hi : count;
+}
+
+#endif // BOID_POOL_H
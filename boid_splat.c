@@ -0,0 +1,211 @@
+#include "boid_splat.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// ============================================================================
+// ATLAS - Rotated once at load time; the only trig in this file
+// ============================================================================
+
+// Bilinear, premultiplied; transparent outside the sprite
+static void SampleSprite(const uint8_t *sprite, int width, int height, float x, float y, float out[4])
+{
+    int x0 = (int)floorf(x), y0 = (int)floorf(y);
+    float fx = x - x0, fy = y - y0;
+    out[0] = out[1] = out[2] = out[3] = 0;
+    
+    for (int k = 0; k < 4; k++)
+    {
+        int sx = x0 + (k & 1), sy = y0 + (k >> 1);
+        if (sx < 0 || sy < 0 || sx >= width || sy >= height) continue;
+        
+        const uint8_t *p = &sprite[(sy * width + sx) * 4];
+        float w = ((k & 1) ? fx : 1 - fx) * ((k >> 1) ? fy : 1 - fy);
+        float a = p[3] * w;
+        out[0] += p[0] * a / 255.0f;
+        out[1] += p[1] * a / 255.0f;
+        out[2] += p[2] * a / 255.0f;
+        out[3] += a;
+    }
+}
+
+bool SplatAtlasBuild(SplatAtlas *atlas, const uint8_t *sprite, int width, int height)
+{
+    memset(atlas, 0, sizeof(SplatAtlas));
+    
+    // Big enough for the sprite's diagonal at any angle
+    int size = (int)ceilf((width > height ? width : height) * 1.41421356f);
+    atlas->size = size;
+    atlas->frames = calloc((size_t)SPLAT_ANGLES * size * size, 4);
+    if (!atlas->frames) return false;
+    
+    const float pi = 3.14159265f;
+    for (int k = 0; k < SPLAT_ANGLES / 8; k++) atlas->slopes[k] = tanf((k + 0.5f) * 2 * pi / SPLAT_ANGLES);
+    
+    for (int a = 0; a < SPLAT_ANGLES; a++)
+    {
+        // The sprite points up, so heading theta is a turn of theta + 90 degrees
+        float turn = a * 2 * pi / SPLAT_ANGLES + pi / 2;
+        float c = cosf(turn), s = sinf(turn);
+        uint8_t *frame = &atlas->frames[(size_t)a * size * size * 4];
+        
+        for (int y = 0; y < size; y++)
+        {
+            for (int x = 0; x < size; x++)
+            {
+                float dx = x + 0.5f - size * 0.5f, dy = y + 0.5f - size * 0.5f;
+                float sx = dx * c + dy * s + width * 0.5f;
+                float sy = -dx * s + dy * c + height * 0.5f;
+                
+                float rgba[4];
+                SampleSprite(sprite, width, height, sx - 0.5f, sy - 0.5f, rgba);
+                for (int ch = 0; ch < 4; ch++) frame[(y * size + x) * 4 + ch] = (uint8_t)fminf(rgba[ch] + 0.5f, 255.0f);
+            }
+        }
+    }
+    return true;
+}
+
+void SplatAtlasFree(SplatAtlas *atlas)
+{
+    free(atlas->frames);
+    memset(atlas, 0, sizeof(SplatAtlas));
+}
+
+// ============================================================================
+// ANGLE LOOKUP
+// ============================================================================
+
+int SplatAngleIndex(const SplatAtlas *atlas, Vector2 vel)
+{
+    float ax = fabsf(vel.x), ay = fabsf(vel.y);
+    bool steep = ay > ax;
+    float ratio = steep ? ax / ay : (ax > 0 ? ay / ax : 0);
+    
+    // Bin within the octant, 0 on the axis to 8 on the diagonal
+    int bin = 0;
+    while (bin < SPLAT_ANGLES / 8 && ratio > atlas->slopes[bin]) bin++;
+    
+    // Mirror into the quadrant, then the quadrant into the circle
+    int quadrant = SPLAT_ANGLES / 4;
+    int angle = steep ? quadrant - bin : bin;
+    if (vel.x < 0) angle = 2 * quadrant - angle;
+    if (vel.y < 0) angle = SPLAT_ANGLES - angle;
+    return angle & (SPLAT_ANGLES - 1);
+}
+
+// ============================================================================
+// BLIT - dst = src * tint + dst * (1 - src alpha * tint alpha), premultiplied
+// ============================================================================
+
+// Exact round(v / 255) for v <= 255 * 255
+static inline uint32_t Div255(uint32_t v)
+{
+    return ((v + 128) * 257) >> 16;
+}
+
+static inline void BlendPixel(uint8_t *dst, const uint8_t *src, const uint8_t tint[4])
+{
+    uint32_t s[4];
+    for (int ch = 0; ch < 4; ch++) s[ch] = Div255(src[ch] * tint[ch]);
+    
+    uint32_t inv = 255 - s[3];
+    for (int ch = 0; ch < 4; ch++)
+    {
+        uint32_t v = s[ch] + Div255(dst[ch] * inv);
+        dst[ch] = (uint8_t)(v < 255 ? v : 255); // Saturates like the SIMD pack
+    }
+}
+
+// Sprite partly off the target: per pixel with clipping
+static void BlitClipped(const uint8_t *frame, int size, SplatTarget *target, int x0, int y0, const uint8_t tint[4])
+{
+    for (int y = 0; y < size; y++)
+    {
+        int ty = y0 + y;
+        if (ty < 0 || ty >= target->height) continue;
+        
+        for (int x = 0; x < size; x++)
+        {
+            int tx = x0 + x;
+            if (tx < 0 || tx >= target->width) continue;
+            BlendPixel(&target->pixels[(size_t)ty * target->stride + tx * 4], &frame[(y * size + x) * 4], tint);
+        }
+    }
+}
+
+#ifdef __SSE2__
+static inline __m128i Div255x8(__m128i v)
+{
+    return _mm_mulhi_epu16(_mm_add_epi16(v, _mm_set1_epi16(128)), _mm_set1_epi16(257));
+}
+
+// Two pixels in 16-bit lanes
+static inline __m128i Blend2(__m128i dst, __m128i src, __m128i tint)
+{
+    __m128i s = Div255x8(_mm_mullo_epi16(src, tint));
+    __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+    __m128i inv = _mm_sub_epi16(_mm_set1_epi16(255), alpha);
+    return _mm_add_epi16(s, Div255x8(_mm_mullo_epi16(dst, inv)));
+}
+
+// Four pixels per step; the tail of rows not a multiple of four goes scalar
+static void BlitInside(const uint8_t *frame, int size, SplatTarget *target, int x0, int y0, const uint8_t tint[4])
+{
+    __m128i zero = _mm_setzero_si128();
+    __m128i tint16 = _mm_setr_epi16(tint[0], tint[1], tint[2], tint[3], tint[0], tint[1], tint[2], tint[3]);
+    
+    for (int y = 0; y < size; y++)
+    {
+        const uint8_t *src = &frame[y * size * 4];
+        uint8_t *dst = &target->pixels[(size_t)(y0 + y) * target->stride + x0 * 4];
+        
+        int x = 0;
+        for (; x + 4 <= size; x += 4)
+        {
+            __m128i s = _mm_loadu_si128((const __m128i *)(src + x * 4));
+            __m128i d = _mm_loadu_si128((const __m128i *)(dst + x * 4));
+            __m128i lo = Blend2(_mm_unpacklo_epi8(d, zero), _mm_unpacklo_epi8(s, zero), tint16);
+            __m128i hi = Blend2(_mm_unpackhi_epi8(d, zero), _mm_unpackhi_epi8(s, zero), tint16);
+            _mm_storeu_si128((__m128i *)(dst + x * 4), _mm_packus_epi16(lo, hi));
+        }
+        for (; x < size; x++) BlendPixel(dst + x * 4, src + x * 4, tint);
+    }
+}
+#else
+static void BlitInside(const uint8_t *frame, int size, SplatTarget *target, int x0, int y0, const uint8_t tint[4])
+{
+    for (int y = 0; y < size; y++)
+    {
+        const uint8_t *src = &frame[y * size * 4];
+        uint8_t *dst = &target->pixels[(size_t)(y0 + y) * target->stride + x0 * 4];
+        for (int x = 0; x < size; x++) BlendPixel(dst + x * 4, src + x * 4, tint);
+    }
+}
+#endif
+
+void SplatBoids(const SplatAtlas *atlas, SplatTarget *target, const Vector2 *pos, const Vector2 *vel, const BoidColor *col, const BoidEntity *ent, int count)
+{
+    int size = atlas->size;
+    size_t frameBytes = (size_t)size * size * 4;
+    
+    for (int i = 0; i < count; i++)
+    {
+        if (!ent[i].active) continue;
+        
+        int x0 = (int)floorf(pos[i].x + 0.5f) - size / 2;
+        int y0 = (int)floorf(pos[i].y + 0.5f) - size / 2;
+        if (x0 >= target->width || y0 >= target->height || x0 + size <= 0 || y0 + size <= 0) continue;
+        
+        const uint8_t *frame = &atlas->frames[SplatAngleIndex(atlas, vel[i]) * frameBytes];
+        uint8_t tint[4] = { col[i].r, col[i].g, col[i].b, col[i].a };
+        
+        if (x0 >= 0 && y0 >= 0 && x0 + size <= target->width && y0 + size <= target->height)
+            BlitInside(frame, size, target, x0, y0, tint);
+        else
+            BlitClipped(frame, size, target, x0, y0, tint);
+    }
+}
@@ -0,0 +1,42 @@
+#ifndef BOID_SPLAT_H
+#define BOID_SPLAT_H
+
+// ============================================================================
+// SPLAT - CPU sprite renderer for headless or software paths
+// ============================================================================
+//
+// The boid sprite is rotated and resampled once, at load time, into an atlas
+// of SPLAT_ANGLES frames. Per boid the renderer then only picks a frame from
+// the velocity (octant plus slope compares, no trig) and alpha-blends it
+// into an RGBA8 framebuffer, four pixels at a time with SSE2 where available.
+
+#include "boid.h"
+
+#define SPLAT_ANGLES 64
+
+typedef struct {
+    int size;        // Frames are size x size, centered on the boid
+    uint8_t *frames; // SPLAT_ANGLES frames of premultiplied RGBA8
+    float slopes[SPLAT_ANGLES / 8]; // tan of the bin edges within an octant
+} SplatAtlas;
+
+// RGBA8, rows stride bytes apart
+typedef struct {
+    uint8_t *pixels;
+    int width, height;
+    int stride;
+} SplatTarget;
+
+// sprite is width x height straight-alpha RGBA8 pointing up (-y), the way
+// the GPU path draws it. False on allocation failure.
+bool SplatAtlasBuild(SplatAtlas *atlas, const uint8_t *sprite, int width, int height);
+void SplatAtlasFree(SplatAtlas *atlas);
+
+// Nearest frame for a heading; frame k faces k * 360 / SPLAT_ANGLES degrees
+// from +x towards +y
+int SplatAngleIndex(const SplatAtlas *atlas, Vector2 vel);
+
+// Blends every active boid's frame, tinted by its color, over the target
+void SplatBoids(const SplatAtlas *atlas, SplatTarget *target, const Vector2 *pos, const Vector2 *vel, const BoidColor *col, const BoidEntity *ent, int count);
+
+#endif // BOID_SPLAT_H
@@ -0,0 +1,278 @@
+#define _POSIX_C_SOURCE 200809L // sockets, fcntl
+
+#include "boid_telemetry.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+_Static_assert(sizeof(BoidTelemetryHeader) == 24, "telemetry header must stay packed");
+_Static_assert(sizeof(BoidTelemetrySample) == 48, "telemetry sample must stay packed");
+
+#define TELEMETRY_DATAGRAM_MAX (sizeof(BoidTelemetryHeader) + BOID_TELEMETRY_BATCH * sizeof(BoidTelemetrySample))
+
+// ============================================================================
+// ADDRESSES
+// ============================================================================
+
+typedef struct {
+    struct sockaddr_storage storage;
+    socklen_t length;
+    int family;
+} TelemetryAddress;
+
+// "unix:<path>" or "udp:<port>" (loopback)
+static bool ParseAddress(const char *text, TelemetryAddress *out)
+{
+    memset(out, 0, sizeof(*out));
+    if (strncmp(text, "unix:", 5) == 0)
+    {
+        struct sockaddr_un *un = (struct sockaddr_un *)&out->storage;
+        const char *path = text + 5;
+        if (path[0] == '\0' || strlen(path) >= sizeof(un->sun_path)) return false;
+        
+        un->sun_family = AF_UNIX;
+        strcpy(un->sun_path, path);
+        out->length = sizeof(struct sockaddr_un);
+        out->family = AF_UNIX;
+        return true;
+    }
+    if (strncmp(text, "udp:", 4) == 0)
+    {
+        char *end;
+        long port = strtol(text + 4, &end, 10);
+        if (end == text + 4 || *end != '\0' || port <= 0 || port > 65535) return false;
+        
+        struct sockaddr_in *in = (struct sockaddr_in *)&out->storage;
+        in->sin_family = AF_INET;
+        in->sin_port = htons((uint16_t)port);
+        in->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        out->length = sizeof(struct sockaddr_in);
+        out->family = AF_INET;
+        return true;
+    }
+    return false;
+}
+
+int BoidTelemetryListen(const char *address)
+{
+    TelemetryAddress addr;
+    if (!ParseAddress(address, &addr)) return -1;
+    
+    int fd = socket(addr.family, SOCK_DGRAM, 0);
+    if (fd < 0) return -1;
+    if (addr.family == AF_UNIX) unlink(((struct sockaddr_un *)&addr.storage)->sun_path);
+    if (bind(fd, (struct sockaddr *)&addr.storage, addr.length) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int BoidTelemetryDecode(const void *data, size_t size, BoidTelemetryHeader *header, BoidTelemetrySample *samples)
+{
+    if (size < sizeof(BoidTelemetryHeader)) return -1;
+    memcpy(header, data, sizeof(BoidTelemetryHeader));
+    if (header->magic != BOID_TELEMETRY_MAGIC || header->version != BOID_TELEMETRY_VERSION) return -1;
+    if (header->sampleCount > BOID_TELEMETRY_BATCH) return -1;
+    if (size != sizeof(BoidTelemetryHeader) + header->sampleCount * sizeof(BoidTelemetrySample)) return -1;
+    
+    memcpy(samples, (const unsigned char *)data + sizeof(BoidTelemetryHeader), header->sampleCount * sizeof(BoidTelemetrySample));
+    return header->sampleCount;
+}
+
+// ============================================================================
+// SAMPLES
+// ============================================================================
+
+BoidTelemetrySample BoidTelemetryMeasure(BoidWorld *world, const BoidStepTimings *timings, double frameSeconds)
+{
+    BoidTelemetrySample sample = { 0 };
+    const SpatialGridStats *stats = &BoidWorldGrid(world)->stats;
+    const Vector2 *vel = BoidWorldVelocities(world);
+    const BoidEntity *ent = BoidWorldEntities(world);
+    int count = BoidWorldCount(world);
+    
+    float headingX = 0, headingY = 0;
+    int active = 0;
+    for (int i = 0; i < count; i++)
+    {
+        if (!ent[i].active) continue;
+        active++;
+        float speed = sqrtf(vel[i].x * vel[i].x + vel[i].y * vel[i].y);
+        if (speed <= 0) continue;
+        headingX += vel[i].x / speed;
+        headingY += vel[i].y / speed;
+    }
+    
+    sample.tick = BoidWorldTick(world);
+    if (timings)
+    {
+        sample.gridSeconds = (float)timings->grid;
+        sample.steeringSeconds = (float)timings->steering;
+        sample.physicsSeconds = (float)timings->physics;
+        sample.publishSeconds = (float)timings->publish;
+    }
+    sample.frameSeconds = (float)frameSeconds;
+    sample.boidCount = active;
+    sample.droppedInserts = stats->droppedInserts;
+    sample.truncatedQueries = stats->truncatedQueries;
+    sample.maxOccupancy = stats->maxOccupancy;
+    sample.polarization = active ? sqrtf(headingX * headingX + headingY * headingY) / active : 0.0f;
+    return sample;
+}
+
+// ============================================================================
+// BACKGROUND SENDER
+// ============================================================================
+
+struct BoidTelemetrySender {
+    int fd;
+    TelemetryAddress address;
+    uint32_t instance;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    
+    // Ring of samples waiting to be sent
+    BoidTelemetrySample queue[BOID_TELEMETRY_QUEUE];
+    int head;
+    int queued;
+    
+    bool stop;
+    uint64_t sequence; // Sender thread only
+    BoidTelemetryStats stats;
+};
+
+static void *TelemetrySender(void *arg)
+{
+    BoidTelemetrySender *ts = arg;
+    unsigned char datagram[TELEMETRY_DATAGRAM_MAX];
+    
+    pthread_mutex_lock(&ts->lock);
+    for (;;)
+    {
+        while (ts->queued == 0 && !ts->stop) pthread_cond_wait(&ts->wake, &ts->lock);
+        if (ts->queued == 0) break;
+        
+        int n = (ts->queued < BOID_TELEMETRY_BATCH) ? ts->queued : BOID_TELEMETRY_BATCH;
+        BoidTelemetryHeader header = {
+            .magic = BOID_TELEMETRY_MAGIC,
+            .version = BOID_TELEMETRY_VERSION,
+            .sampleCount = (uint16_t)n,
+            .instance = ts->instance,
+            .dropped = (uint32_t)ts->stats.dropped,
+            .sequence = ts->sequence,
+        };
+        unsigned char *out = datagram + sizeof(header);
+        for (int s = 0; s < n; s++)
+        {
+            memcpy(out, &ts->queue[ts->head], sizeof(BoidTelemetrySample));
+            out += sizeof(BoidTelemetrySample);
+            ts->head = (ts->head + 1) % BOID_TELEMETRY_QUEUE;
+        }
+        ts->queued -= n;
+        pthread_mutex_unlock(&ts->lock);
+        
+        // Non-blocking: a full receive buffer or an absent reader loses the
+        // datagram instead of stalling the queue
+        memcpy(datagram, &header, sizeof(header));
+        ssize_t size = (ssize_t)(out - datagram);
+        ssize_t sent;
+        do sent = sendto(ts->fd, datagram, size, 0, (struct sockaddr *)&ts->address.storage, ts->address.length);
+        while (sent < 0 && errno == EINTR);
+        
+        pthread_mutex_lock(&ts->lock);
+        if (sent == size)
+        {
+            ts->stats.sent += n;
+            ts->stats.datagrams++;
+            ts->sequence++;
+        }
+        else
+        {
+            ts->stats.dropped += n;
+        }
+    }
+    pthread_mutex_unlock(&ts->lock);
+    return NULL;
+}
+
+BoidTelemetrySender *BoidTelemetrySenderCreate(const char *address, uint32_t instance)
+{
+    BoidTelemetrySender *ts = calloc(1, sizeof(BoidTelemetrySender));
+    if (!ts) return NULL;
+    
+    ts->instance = instance;
+    ts->fd = -1;
+    if (ParseAddress(address, &ts->address)) ts->fd = socket(ts->address.family, SOCK_DGRAM, 0);
+    if (ts->fd < 0 || fcntl(ts->fd, F_SETFL, fcntl(ts->fd, F_GETFL) | O_NONBLOCK) != 0)
+    {
+        if (ts->fd >= 0) close(ts->fd);
+        free(ts);
+        return NULL;
+    }
+    
+    pthread_mutex_init(&ts->lock, NULL);
+    pthread_cond_init(&ts->wake, NULL);
+    if (pthread_create(&ts->thread, NULL, TelemetrySender, ts) != 0)
+    {
+        pthread_cond_destroy(&ts->wake);
+        pthread_mutex_destroy(&ts->lock);
+        close(ts->fd);
+        free(ts);
+        return NULL;
+    }
+    return ts;
+}
+
+void BoidTelemetrySenderDestroy(BoidTelemetrySender *ts)
+{
+    if (!ts) return;
+    
+    // The sender drains the queue before it sees stop
+    pthread_mutex_lock(&ts->lock);
+    ts->stop = true;
+    pthread_cond_signal(&ts->wake);
+    pthread_mutex_unlock(&ts->lock);
+    pthread_join(ts->thread, NULL);
+    
+    pthread_cond_destroy(&ts->wake);
+    pthread_mutex_destroy(&ts->lock);
+    close(ts->fd);
+    free(ts);
+}
+
+bool BoidTelemetrySenderPush(BoidTelemetrySender *ts, const BoidTelemetrySample *sample)
+{
+    pthread_mutex_lock(&ts->lock);
+    bool room = ts->queued < BOID_TELEMETRY_QUEUE;
+    if (room)
+    {
+        ts->queue[(ts->head + ts->queued) % BOID_TELEMETRY_QUEUE] = *sample;
+        ts->queued++;
+        pthread_cond_signal(&ts->wake);
+    }
+    else
+    {
+        ts->stats.dropped++;
+    }
+    pthread_mutex_unlock(&ts->lock);
+    return room;
+}
+
+BoidTelemetryStats BoidTelemetrySenderStats(BoidTelemetrySender *ts)
+{
+    pthread_mutex_lock(&ts->lock);
+    BoidTelemetryStats stats = ts->stats;
+    pthread_mutex_unlock(&ts->lock);
+    return stats;
+}
@@ -0,0 +1,83 @@
+#ifndef BOID_TELEMETRY_H
+#define BOID_TELEMETRY_H
+
+// ============================================================================
+// BOID TELEMETRY - Binary per-tick metrics over a local datagram socket
+// ============================================================================
+//
+// The simulation thread fills a fixed-size BoidTelemetrySample per tick and
+// queues it; nothing is formatted. A background thread batches queued samples
+// into datagrams (one BoidTelemetryHeader, then up to BOID_TELEMETRY_BATCH
+// samples) and sends them without blocking. Samples are dropped, never
+// waited for: when the queue is full because the sender thread fell behind,
+// and when the socket would block because the reader fell behind (or there is
+// no reader). The header carries the running drop count and a datagram
+// sequence number, so a reader sees both kinds of loss.
+//
+// Addresses: "unix:<path>" for a Unix datagram socket, "udp:<port>" for UDP on
+// 127.0.0.1. Fields are in the sender's native byte order; both ends are on
+// the same host.
+//
+// POSIX only; link with -pthread.
+
+#include "boid.h"
+
+#define BOID_TELEMETRY_MAGIC 0x4d4c5442u // "BTLM"
+#define BOID_TELEMETRY_VERSION 1
+#define BOID_TELEMETRY_BATCH 32  // Samples per datagram at most
+#define BOID_TELEMETRY_QUEUE 256 // Samples waiting for the sender thread
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t sampleCount;
+    uint32_t instance; // Chosen by the sender (the demo uses its pid) so one reader can watch a fleet
+    uint32_t dropped;  // Samples this sender has dropped so far
+    uint64_t sequence; // Datagrams sent before this one
+} BoidTelemetryHeader;
+
+typedef struct {
+    uint64_t tick;
+    float gridSeconds; // BoidStepTimings of the tick
+    float steeringSeconds;
+    float physicsSeconds;
+    float publishSeconds;
+    float frameSeconds; // The host's whole tick, as it measured it
+    uint32_t boidCount;
+    uint32_t droppedInserts; // SpatialGridStats of the tick
+    uint32_t truncatedQueries;
+    uint32_t maxOccupancy;
+    float polarization; // As in FlockMetrics
+} BoidTelemetrySample;
+
+typedef struct BoidTelemetrySender BoidTelemetrySender;
+
+typedef struct {
+    long long sent;
+    long long dropped; // Queue full or socket not ready
+    long long datagrams;
+} BoidTelemetryStats;
+
+// NULL on a malformed address or if the socket or thread cannot be created.
+// A missing reader is not an error; samples are dropped until one appears.
+BoidTelemetrySender *BoidTelemetrySenderCreate(const char *address, uint32_t instance);
+// Sends what is still queued, then stops the thread
+void BoidTelemetrySenderDestroy(BoidTelemetrySender *sender);
+
+// Copies the sample into the queue; false if it was dropped
+bool BoidTelemetrySenderPush(BoidTelemetrySender *sender, const BoidTelemetrySample *sample);
+BoidTelemetryStats BoidTelemetrySenderStats(BoidTelemetrySender *sender);
+
+// The world as of its last step. One pass over the velocities for the
+// polarization; timings may be NULL.
+BoidTelemetrySample BoidTelemetryMeasure(BoidWorld *world, const BoidStepTimings *timings, double frameSeconds);
+
+// Reader side: a socket bound to address (a stale Unix socket file is
+// replaced), or -1
+int BoidTelemetryListen(const char *address);
+// Checks one received datagram and copies out its samples (room for
+// BOID_TELEMETRY_BATCH); returns the sample count, or -1 if it is not a
+// telemetry datagram of this version
+int BoidTelemetryDecode(const void *data, size_t size, BoidTelemetryHeader *header, BoidTelemetrySample *samples);
+
+#endif // BOID_TELEMETRY_H
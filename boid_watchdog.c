@@ -0,0 +1,227 @@
+#define _POSIX_C_SOURCE 200809L // strdup, getrusage
+
+#include "boid_watchdog.h"
+#include "boid_writer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+
+// ============================================================================
+// DUMP FILE
+// ============================================================================
+
+// Everything one dump needs, copied on the recording thread
+typedef struct {
+    uint64_t tick;
+    double thresholdSeconds;
+    BoidWatchdogFrame *frames; // Oldest first; the spike is the last one
+    int frameCount;
+    int *cellCounts; // Row-major world cells
+    int gridWidth, gridHeight;
+    SpatialGridStats gridStats;
+} SpikeDump;
+
+static void WriteFrameJson(FILE *file, const BoidWatchdogFrame *f)
+{
+    fprintf(file, "{ \"tick\": %llu, \"frameMs\": %.4f, \"gridMs\": %.4f, \"broadphaseMs\": %.4f, \"steeringMs\": %.4f, \"physicsMs\": %.4f, \"publishMs\": %.4f, \"renderMs\": %.4f, "
+        "\"droppedInserts\": %d, \"truncatedQueries\": %d, \"maxOccupancy\": %d, \"minorFaults\": %ld, \"majorFaults\": %ld }",
+        (unsigned long long)f->tick, f->frameSeconds * 1000.0, f->step.grid * 1000.0, f->broadphaseSeconds * 1000.0, f->step.steering * 1000.0,
+        f->step.physics * 1000.0, f->step.publish * 1000.0, f->renderSeconds * 1000.0,
+        f->droppedInserts, f->truncatedQueries, f->maxOccupancy, f->minorFaults, f->majorFaults);
+}
+
+static bool FillSpikeFile(FILE *file, const void *context)
+{
+    const SpikeDump *dump = context;
+    const SpatialGridStats *stats = &dump->gridStats;
+    fprintf(file, "{\n");
+    fprintf(file, "  \"tick\": %llu,\n", (unsigned long long)dump->tick);
+    fprintf(file, "  \"thresholdMs\": %.4f,\n", dump->thresholdSeconds * 1000.0);
+    fprintf(file, "  \"frames\": [\n");
+    for (int i = 0; i < dump->frameCount; i++)
+    {
+        fprintf(file, "    ");
+        WriteFrameJson(file, &dump->frames[i]);
+        fprintf(file, "%s\n", (i + 1 < dump->frameCount) ? "," : "");
+    }
+    fprintf(file, "  ],\n");
+    fprintf(file, "  \"grid\": {\n");
+    fprintf(file, "    \"width\": %d,\n", dump->gridWidth);
+    fprintf(file, "    \"height\": %d,\n", dump->gridHeight);
+    fprintf(file, "    \"cellCapacity\": %d,\n", MAX_ENTITIES_PER_CELL);
+    fprintf(file, "    \"droppedInserts\": %d,\n", stats->droppedInserts);
+    fprintf(file, "    \"truncatedQueries\": %d,\n", stats->truncatedQueries);
+    fprintf(file, "    \"maxOccupancy\": %d,\n", stats->maxOccupancy);
+    fprintf(file, "    \"occupancyBinSize\": %d,\n", OCCUPANCY_BIN_SIZE);
+    fprintf(file, "    \"occupancyHistogram\": [");
+    for (int b = 0; b < OCCUPANCY_BINS; b++) fprintf(file, "%s%d", b ? ", " : "", stats->occupancyHistogram[b]);
+    fprintf(file, "],\n");
+    fprintf(file, "    \"cellCounts\": [");
+    for (int y = 0; y < dump->gridHeight; y++)
+    {
+        fprintf(file, "%s\n      [", y ? "," : "");
+        for (int x = 0; x < dump->gridWidth; x++) fprintf(file, "%s%d", x ? ", " : "", dump->cellCounts[y * dump->gridWidth + x]);
+        fprintf(file, "]");
+    }
+    fprintf(file, "\n    ]\n");
+    fprintf(file, "  }\n");
+    fprintf(file, "}\n");
+    return !ferror(file);
+}
+
+// ============================================================================
+// WATCHDOG
+// ============================================================================
+
+struct BoidWatchdog {
+    char *directory;
+    double thresholdSeconds;
+    
+    // Recording thread only
+    BoidWatchdogFrame *ring;
+    int ringSize;
+    int next;   // Slot the next frame goes into
+    int filled; // Frames in the ring, up to ringSize
+    int quiet;  // Frames left before another spike may dump
+    long lastMinorFaults, lastMajorFaults;
+    int spikes;
+    int quietSkips; // Spikes in the quiet window; the writer counts the rest
+    uint64_t lastSpikeTick;
+    
+    BoidWriter *writer;
+    
+    // The recorder's while it holds the writer's claim, the writer's after
+    SpikeDump dump;
+    int cellCapacity;
+};
+
+static bool WatchdogWrite(void *context)
+{
+    BoidWatchdog *wd = context;
+    char path[4096];
+    if (snprintf(path, sizeof(path), "%s/spike-%llu.json", wd->directory, (unsigned long long)wd->dump.tick) >= (int)sizeof(path)) return false;
+    return BoidWriteFileAtomic(path, FillSpikeFile, &wd->dump);
+}
+
+static void ReadFaults(long *minor, long *major)
+{
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return;
+    *minor = usage.ru_minflt;
+    *major = usage.ru_majflt;
+}
+
+BoidWatchdog *BoidWatchdogCreate(const BoidWatchdogConfig *config)
+{
+    BoidWatchdog *wd = calloc(1, sizeof(BoidWatchdog));
+    if (!wd) return NULL;
+    
+    wd->ringSize = (config->frames > 0) ? config->frames : 1;
+    wd->thresholdSeconds = config->thresholdSeconds;
+    wd->directory = strdup(config->directory);
+    wd->ring = calloc(wd->ringSize, sizeof(BoidWatchdogFrame));
+    wd->dump.frames = calloc(wd->ringSize, sizeof(BoidWatchdogFrame));
+    ReadFaults(&wd->lastMinorFaults, &wd->lastMajorFaults);
+    if (wd->directory && wd->ring && wd->dump.frames) wd->writer = BoidWriterCreate(WatchdogWrite, wd);
+    
+    if (!wd->writer)
+    {
+        free(wd->dump.frames);
+        free(wd->ring);
+        free(wd->directory);
+        free(wd);
+        return NULL;
+    }
+    return wd;
+}
+
+void BoidWatchdogDestroy(BoidWatchdog *wd)
+{
+    if (!wd) return;
+    
+    BoidWriterDestroy(wd->writer);
+    free(wd->dump.cellCounts);
+    free(wd->dump.frames);
+    free(wd->ring);
+    free(wd->directory);
+    free(wd);
+}
+
+// Copies the ring (oldest first) and the grid into the dump; false on
+// allocation failure
+static bool CaptureSpike(BoidWatchdog *wd, const BoidWatchdogFrame *frame, const SpatialGrid *grid)
+{
+    int cells = grid->width * grid->height;
+    if (cells > wd->cellCapacity)
+    {
+        int *grown = realloc(wd->dump.cellCounts, cells * sizeof(int));
+        if (!grown) return false;
+        wd->dump.cellCounts = grown;
+        wd->cellCapacity = cells;
+    }
+    
+    int first = (wd->next - wd->filled + wd->ringSize) % wd->ringSize;
+    for (int i = 0; i < wd->filled; i++) wd->dump.frames[i] = wd->ring[(first + i) % wd->ringSize];
+    for (int y = 0; y < grid->height; y++)
+    {
+        for (int x = 0; x < grid->width; x++) wd->dump.cellCounts[y * grid->width + x] = SpatialGridCellAt(grid, x, y)->count;
+    }
+    
+    wd->dump.tick = frame->tick;
+    wd->dump.thresholdSeconds = wd->thresholdSeconds;
+    wd->dump.frameCount = wd->filled;
+    wd->dump.gridWidth = grid->width;
+    wd->dump.gridHeight = grid->height;
+    wd->dump.gridStats = grid->stats;
+    return true;
+}
+
+bool BoidWatchdogRecord(BoidWatchdog *wd, const BoidWatchdogFrame *frame, const SpatialGrid *grid)
+{
+    // Faults since the previous frame
+    long minor = wd->lastMinorFaults, major = wd->lastMajorFaults;
+    ReadFaults(&minor, &major);
+    BoidWatchdogFrame *slot = &wd->ring[wd->next];
+    *slot = *frame;
+    slot->minorFaults = minor - wd->lastMinorFaults;
+    slot->majorFaults = major - wd->lastMajorFaults;
+    wd->lastMinorFaults = minor;
+    wd->lastMajorFaults = major;
+    wd->next = (wd->next + 1) % wd->ringSize;
+    if (wd->filled < wd->ringSize) wd->filled++;
+    
+    if (wd->quiet > 0) wd->quiet--;
+    if (frame->frameSeconds <= wd->thresholdSeconds) return false;
+    
+    wd->spikes++;
+    wd->lastSpikeTick = frame->tick;
+    if (wd->quiet > 0)
+    {
+        wd->quietSkips++;
+        return false;
+    }
+    if (!BoidWriterClaim(wd->writer)) return false;
+    
+    // Claimed, so the dump is ours until we submit it
+    if (!CaptureSpike(wd, slot, grid))
+    {
+        BoidWriterCancel(wd->writer);
+        return false;
+    }
+    wd->quiet = wd->ringSize;
+    BoidWriterSubmit(wd->writer);
+    return true;
+}
+
+BoidSpikeStats BoidWatchdogStats(BoidWatchdog *wd)
+{
+    BoidWriteStats ws = BoidWriterStats(wd->writer);
+    return (BoidSpikeStats){
+        .spikes = wd->spikes,
+        .dumped = ws.written,
+        .skipped = ws.skipped + wd->quietSkips,
+        .failed = ws.failed,
+        .lastSpikeTick = wd->lastSpikeTick,
+    };
+}
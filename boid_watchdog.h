@@ -0,0 +1,64 @@
+#ifndef BOID_WATCHDOG_H
+#define BOID_WATCHDOG_H
+
+// ============================================================================
+// BOID WATCHDOG - Captures the frames around a spike for offline analysis
+// ============================================================================
+//
+// The host records one BoidWatchdogFrame per frame into a ring of the last
+// BoidWatchdogConfig.frames. When a frame takes longer than the threshold the
+// watchdog copies the ring and the grid's occupancy (stats plus every cell's
+// count) and a BoidWriter thread writes them to
+// "<directory>/spike-<tick>.json". Like the checkpointer, a spike that comes
+// while the previous dump is still being written is counted but not dumped,
+// and after a dump the watchdog stays quiet for one window so that a run of
+// slow frames produces one file rather than one per frame.
+//
+// Page faults are read per frame from getrusage, since they are one of the
+// usual causes and nothing else reports them.
+//
+// POSIX only; link with -pthread.
+
+#include "boid.h"
+
+typedef struct {
+    uint64_t tick;
+    double frameSeconds; // The host's whole frame; compared against the threshold
+    BoidStepTimings step;
+    double renderSeconds;     // 0 when headless
+    double broadphaseSeconds; // BoidBroadphaseStats.buildSeconds, part of step.grid
+    int droppedInserts;       // SpatialGridStats of the frame
+    int truncatedQueries;
+    int maxOccupancy;
+    long minorFaults; // Filled in by BoidWatchdogRecord
+    long majorFaults;
+} BoidWatchdogFrame;
+
+typedef struct {
+    const char *directory; // Must exist
+    int frames;            // Ring length; < 1 = 1
+    double thresholdSeconds;
+} BoidWatchdogConfig;
+
+typedef struct {
+    int spikes;
+    int dumped;
+    int skipped; // Spikes during a write in flight or the quiet window after a dump
+    int failed;
+    uint64_t lastSpikeTick;
+} BoidSpikeStats;
+
+typedef struct BoidWatchdog BoidWatchdog;
+
+// NULL on allocation failure or if the writer thread cannot be started
+BoidWatchdog *BoidWatchdogCreate(const BoidWatchdogConfig *config);
+// Waits for an in-flight dump before returning
+void BoidWatchdogDestroy(BoidWatchdog *watchdog);
+
+// Adds the frame (faults included) to the ring; on a spike also hands the
+// window and the grid to the writer. True if a dump was started.
+bool BoidWatchdogRecord(BoidWatchdog *watchdog, const BoidWatchdogFrame *frame, const SpatialGrid *grid);
+// From the recording thread, which owns the spike counts
+BoidSpikeStats BoidWatchdogStats(BoidWatchdog *watchdog);
+
+#endif // BOID_WATCHDOG_H
@@ -0,0 +1,169 @@
+#define _POSIX_C_SOURCE 200809L // fsync, fileno, clock_gettime
+
+#include "boid_writer.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// ============================================================================
+// ATOMIC FILES
+// ============================================================================
+
+// Makes the rename itself durable
+static void SyncParentDirectory(const char *path)
+{
+    char dir[4096];
+    const char *slash = strrchr(path, '/');
+    if (!slash) snprintf(dir, sizeof(dir), ".");
+    else if (slash == path) snprintf(dir, sizeof(dir), "/");
+    else snprintf(dir, sizeof(dir), "%.*s", (int)(slash - path), path);
+    
+    int fd = open(dir, O_RDONLY);
+    if (fd < 0) return;
+    fsync(fd);
+    close(fd);
+}
+
+bool BoidWriteFileAtomic(const char *path, bool (*fill)(FILE *file, const void *context), const void *context)
+{
+    char tmpPath[4096];
+    if (snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", path) >= (int)sizeof(tmpPath)) return false;
+    
+    FILE *file = fopen(tmpPath, "wb");
+    if (!file) return false;
+    
+    bool ok = fill(file, context) && fflush(file) == 0 && !ferror(file) && fsync(fileno(file)) == 0;
+    ok = (fclose(file) == 0) && ok;
+    
+    if (!ok || rename(tmpPath, path) != 0)
+    {
+        unlink(tmpPath);
+        return false;
+    }
+    SyncParentDirectory(path);
+    return true;
+}
+
+// ============================================================================
+// BACKGROUND WRITER
+// ============================================================================
+
+struct BoidWriter {
+    BoidWriteFn write;
+    void *context;
+    
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    
+    bool claimed; // From a successful claim until the write finishes
+    bool pending; // Submitted, not yet finished
+    bool stop;
+    BoidWriteStats stats;
+};
+
+static double NowSeconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void *WriterThread(void *arg)
+{
+    BoidWriter *writer = arg;
+    
+    pthread_mutex_lock(&writer->lock);
+    for (;;)
+    {
+        while (!writer->pending && !writer->stop) pthread_cond_wait(&writer->wake, &writer->lock);
+        if (!writer->pending) break;
+        pthread_mutex_unlock(&writer->lock);
+        
+        double start = NowSeconds();
+        bool ok = writer->write(writer->context);
+        double seconds = NowSeconds() - start;
+        
+        pthread_mutex_lock(&writer->lock);
+        if (ok) writer->stats.written++;
+        else writer->stats.failed++;
+        writer->stats.lastWriteSeconds = seconds;
+        writer->pending = false;
+        writer->claimed = false;
+    }
+    pthread_mutex_unlock(&writer->lock);
+    return NULL;
+}
+
+BoidWriter *BoidWriterCreate(BoidWriteFn write, void *context)
+{
+    BoidWriter *writer = calloc(1, sizeof(BoidWriter));
+    if (!writer) return NULL;
+    
+    writer->write = write;
+    writer->context = context;
+    pthread_mutex_init(&writer->lock, NULL);
+    pthread_cond_init(&writer->wake, NULL);
+    
+    if (pthread_create(&writer->thread, NULL, WriterThread, writer) != 0)
+    {
+        pthread_cond_destroy(&writer->wake);
+        pthread_mutex_destroy(&writer->lock);
+        free(writer);
+        return NULL;
+    }
+    return writer;
+}
+
+void BoidWriterDestroy(BoidWriter *writer)
+{
+    if (!writer) return;
+    
+    // The thread finishes a pending write before it sees stop
+    pthread_mutex_lock(&writer->lock);
+    writer->stop = true;
+    pthread_cond_broadcast(&writer->wake);
+    pthread_mutex_unlock(&writer->lock);
+    pthread_join(writer->thread, NULL);
+    
+    pthread_cond_destroy(&writer->wake);
+    pthread_mutex_destroy(&writer->lock);
+    free(writer);
+}
+
+bool BoidWriterClaim(BoidWriter *writer)
+{
+    pthread_mutex_lock(&writer->lock);
+    bool claimed = !writer->claimed;
+    if (claimed) writer->claimed = true;
+    else writer->stats.skipped++;
+    pthread_mutex_unlock(&writer->lock);
+    return claimed;
+}
+
+void BoidWriterSubmit(BoidWriter *writer)
+{
+    pthread_mutex_lock(&writer->lock);
+    writer->pending = true;
+    pthread_cond_signal(&writer->wake);
+    pthread_mutex_unlock(&writer->lock);
+}
+
+void BoidWriterCancel(BoidWriter *writer)
+{
+    pthread_mutex_lock(&writer->lock);
+    writer->claimed = false;
+    writer->stats.failed++;
+    pthread_mutex_unlock(&writer->lock);
+}
+
+BoidWriteStats BoidWriterStats(BoidWriter *writer)
+{
+    pthread_mutex_lock(&writer->lock);
+    BoidWriteStats stats = writer->stats;
+    pthread_mutex_unlock(&writer->lock);
+    return stats;
+}
@@ -0,0 +1,51 @@
+#ifndef BOID_WRITER_H
+#define BOID_WRITER_H
+
+// ============================================================================
+// BOID WRITER - Single-slot background file writes, atomic file replacement
+// ============================================================================
+//
+// The disk half of the checkpointer and the spike watchdog. A BoidWriter owns
+// one thread and one job. The producer claims the job, fills its own buffers
+// while it holds the claim, then submits it; the thread runs the write
+// callback and frees the job. A claim made while a write is in flight fails
+// and is counted as skipped, so the producer never waits on the disk.
+//
+// BoidWriteFileAtomic writes "<path>.tmp", fsyncs it and renames it over
+// <path>, so a crash or a reader sees either the old file or the new one.
+//
+// POSIX only; link with -pthread.
+
+#include <stdbool.h>
+#include <stdio.h>
+
+typedef struct {
+    int written;
+    int skipped; // Claims made while a write was in flight
+    int failed;  // Writes that returned false, and cancelled claims
+    double lastWriteSeconds;
+} BoidWriteStats;
+
+// Runs on the writer thread; true on success
+typedef bool (*BoidWriteFn)(void *context);
+
+typedef struct BoidWriter BoidWriter;
+
+// context is passed to every write. NULL if the thread cannot be started.
+BoidWriter *BoidWriterCreate(BoidWriteFn write, void *context);
+// Finishes a submitted write before returning
+void BoidWriterDestroy(BoidWriter *writer);
+
+// True if no write is in flight; the job's buffers are then the caller's
+// until it submits or cancels
+bool BoidWriterClaim(BoidWriter *writer);
+void BoidWriterSubmit(BoidWriter *writer);
+// Gives the claim back unused, counted as a failure
+void BoidWriterCancel(BoidWriter *writer);
+BoidWriteStats BoidWriterStats(BoidWriter *writer);
+
+// fill writes the contents and returns false on failure. False, and <path>
+// untouched, if anything fails.
+bool BoidWriteFileAtomic(const char *path, bool (*fill)(FILE *file, const void *context), const void *context);
+
+#endif // BOID_WRITER_H
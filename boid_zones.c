@@ -0,0 +1,173 @@
+#include "boid_zones.h"
+#include <stdlib.h>
+#include <string.h>
+
+// ============================================================================
+// LIFETIME
+// ============================================================================
+
+ZoneSet *ZoneSetCreate(int width, int height, float cellSize, int capacity)
+{
+    ZoneSet *set = calloc(1, sizeof(ZoneSet));
+    if (!set) return NULL;
+    
+    set->width = width;
+    set->height = height;
+    set->cellSize = cellSize;
+    set->capacity = capacity;
+    set->interior = calloc((size_t)width * height, sizeof(uint32_t));
+    set->boundary = calloc((size_t)width * height, sizeof(uint32_t));
+    set->lastCells = malloc(capacity * sizeof(int));
+    set->masks = calloc(capacity, sizeof(uint32_t));
+    atomic_init(&set->queue.head, 0);
+    atomic_init(&set->queue.tail, 0);
+    
+    if (!set->interior || !set->boundary || !set->lastCells || !set->masks)
+    {
+        ZoneSetDestroy(set);
+        return NULL;
+    }
+    memset(set->lastCells, 0xff, capacity * sizeof(int));
+    return set;
+}
+
+void ZoneSetDestroy(ZoneSet *set)
+{
+    if (!set) return;
+    free(set->interior);
+    free(set->boundary);
+    free(set->lastCells);
+    free(set->masks);
+    free(set);
+}
+
+// ============================================================================
+// RASTERIZATION
+// ============================================================================
+
+static bool ZoneContains(const BoidZone *zone, Vector2 p)
+{
+    if (zone->shape == BOID_ZONE_RECT)
+    {
+        return p.x >= zone->min.x && p.x < zone->max.x && p.y >= zone->min.y && p.y < zone->max.y;
+    }
+    float dx = p.x - zone->center.x, dy = p.y - zone->center.y;
+    return dx * dx + dy * dy <= zone->radius * zone->radius;
+}
+
+// 2 = cell wholly inside, 1 = cut by the zone's edge, 0 = outside
+static int ClassifyCell(const BoidZone *zone, float x0, float y0, float x1, float y1)
+{
+    if (zone->shape == BOID_ZONE_RECT)
+    {
+        if (x1 <= zone->min.x || x0 >= zone->max.x || y1 <= zone->min.y || y0 >= zone->max.y) return 0;
+        return (x0 >= zone->min.x && x1 <= zone->max.x && y0 >= zone->min.y && y1 <= zone->max.y) ? 2 : 1;
+    }
+    
+    Vector2 c = zone->center;
+    float r2 = zone->radius * zone->radius;
+    
+    // Nearest point of the cell outside the circle: no overlap
+    float nx = (c.x < x0) ? x0 : (c.x > x1) ? x1 : c.x;
+    float ny = (c.y < y0) ? y0 : (c.y > y1) ? y1 : c.y;
+    if ((nx - c.x) * (nx - c.x) + (ny - c.y) * (ny - c.y) > r2) return 0;
+    
+    // Farthest corner inside: the whole cell is
+    float fx = (c.x - x0 > x1 - c.x) ? x0 : x1;
+    float fy = (c.y - y0 > y1 - c.y) ? y0 : y1;
+    return ((fx - c.x) * (fx - c.x) + (fy - c.y) * (fy - c.y) <= r2) ? 2 : 1;
+}
+
+int ZoneSetAdd(ZoneSet *set, BoidZone zone)
+{
+    if (set->zoneCount == BOID_MAX_ZONES) return -1;
+    
+    int id = set->zoneCount++;
+    uint32_t bit = 1u << id;
+    set->zones[id] = zone;
+    
+    for (int y = 0; y < set->height; y++)
+    {
+        for (int x = 0; x < set->width; x++)
+        {
+            int c = y * set->width + x;
+            int inside = ClassifyCell(&zone, x * set->cellSize, y * set->cellSize, (x + 1) * set->cellSize, (y + 1) * set->cellSize);
+            if (inside == 2) set->interior[c] |= bit;
+            else if (inside == 1) set->boundary[c] |= bit;
+        }
+    }
+    
+    // The cached masks know nothing of the new zone
+    for (int i = 0; i < set->capacity; i++) set->lastCells[i] = -1;
+    return id;
+}
+
+// ============================================================================
+// EVENTS
+// ============================================================================
+
+static void PushEvent(ZoneSet *set, BoidZoneEvent event)
+{
+    ZoneEventQueue *queue = &set->queue;
+    uint_fast64_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    uint_fast64_t head = atomic_load_explicit(&queue->head, memory_order_acquire);
+    
+    if (tail - head == ZONE_EVENT_QUEUE_SIZE)
+    {
+        set->stats.dropped++;
+        return;
+    }
+    
+    queue->events[tail & (ZONE_EVENT_QUEUE_SIZE - 1)] = event;
+    atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+    set->stats.events++;
+}
+
+void ZoneSetUpdate(ZoneSet *set, const int *cells, const BoidKinematics *kin, const BoidEntity *ent, int count, uint64_t tick)
+{
+    for (int i = 0; i < count; i++)
+    {
+        if (!ent[i].active) continue;
+        
+        int cell = cells[i];
+        uint32_t boundary = set->boundary[cell];
+        bool moved = (cell != set->lastCells[i]);
+        if (!moved && !boundary) continue;
+        
+        // Interior zones only change with the cell; boundary zones need the
+        // exact test every time
+        uint32_t mask = moved ? set->interior[cell] : (set->masks[i] & ~boundary);
+        set->stats.transitions += moved;
+        set->lastCells[i] = cell;
+        
+        for (uint32_t bits = boundary; bits; bits &= bits - 1)
+        {
+            int z = __builtin_ctz(bits);
+            set->stats.exactTests++;
+            if (ZoneContains(&set->zones[z], BoidPosition(kin, i))) mask |= 1u << z;
+        }
+        
+        uint32_t changed = mask ^ set->masks[i];
+        set->masks[i] = mask;
+        
+        for (; changed; changed &= changed - 1)
+        {
+            int z = __builtin_ctz(changed);
+            BoidZoneEventType type = (mask >> z & 1) ? BOID_ZONE_ENTER : BOID_ZONE_EXIT;
+            PushEvent(set, (BoidZoneEvent){ i, z, type, tick });
+        }
+    }
+}
+
+int ZoneSetDrain(ZoneSet *set, BoidZoneEvent *out, int maxEvents)
+{
+    ZoneEventQueue *queue = &set->queue;
+    uint_fast64_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    uint_fast64_t tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+    
+    int n = 0;
+    while (head != tail && n < maxEvents) out[n++] = queue->events[head++ & (ZONE_EVENT_QUEUE_SIZE - 1)];
+    
+    atomic_store_explicit(&queue->head, head, memory_order_release);
+    return n;
+}
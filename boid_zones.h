@@ -0,0 +1,69 @@
+#ifndef BOID_ZONES_H
+#define BOID_ZONES_H
+
+// ============================================================================
+// ZONES - Enter/exit events from grid cell transitions
+// ============================================================================
+//
+// Each zone is rasterized onto the grid once, when it is added: every cell is
+// outside it, wholly inside it (interior mask) or cut by its edge (boundary
+// mask). After each grid build a boid is only looked at if it changed cell or
+// sits in a boundary cell, and only boundary zones get an exact point test.
+// Boids moving around the inside or outside of a zone cost one compare.
+//
+// Events go into a single-producer single-consumer ring: the stepping thread
+// pushes, one host thread drains, with no locks between them. The grid build
+// runs on the pool, but ZoneSetUpdate runs serially after it, so there is one
+// producer and events arrive in boid id order whatever the worker count. The
+// pass costs one compare for most boids, too little to be worth splitting.
+
+#include "boid.h"
+#include "boid_layout.h"
+#include <stdatomic.h>
+
+#define ZONE_EVENT_QUEUE_SIZE 8192 // Power of two
+#define ZONE_CACHE_LINE 64
+
+typedef struct {
+    // Producer and consumer indices on separate cache lines
+    atomic_uint_fast64_t head; // Next event to drain, written by the consumer
+    char headPad[ZONE_CACHE_LINE - sizeof(atomic_uint_fast64_t)];
+    atomic_uint_fast64_t tail; // Next free slot, written by the producer
+    char tailPad[ZONE_CACHE_LINE - sizeof(atomic_uint_fast64_t)];
+    BoidZoneEvent events[ZONE_EVENT_QUEUE_SIZE];
+} ZoneEventQueue;
+
+typedef struct {
+    int width, height; // Cells
+    float cellSize;
+    
+    BoidZone zones[BOID_MAX_ZONES];
+    int zoneCount;
+    uint32_t *interior; // Per cell: zones containing the whole cell
+    uint32_t *boundary; // Per cell: zones whose edge crosses the cell
+    
+    // Per boid: cell at the last evaluation (-1 = re-evaluate) and zones it is in
+    int capacity;
+    int *lastCells;
+    uint32_t *masks;
+    
+    BoidZoneStats stats; // Producer side
+    ZoneEventQueue queue;
+} ZoneSet;
+
+// NULL on allocation failure
+ZoneSet *ZoneSetCreate(int width, int height, float cellSize, int capacity);
+void ZoneSetDestroy(ZoneSet *set);
+
+// Returns the zone id, or -1 when BOID_MAX_ZONES are in use. Every boid is
+// re-evaluated on the next update, so boids already inside get an enter event.
+int ZoneSetAdd(ZoneSet *set, BoidZone zone);
+
+// cells[i] is boid i's row-major cell from this grid build. Pushes an event
+// per changed membership; events that do not fit are counted as dropped.
+void ZoneSetUpdate(ZoneSet *set, const int *cells, const BoidKinematics *kin, const BoidEntity *ent, int count, uint64_t tick);
+
+// Consumer side; pops up to maxEvents in the order they were pushed
+int ZoneSetDrain(ZoneSet *set, BoidZoneEvent *out, int maxEvents);
+
+#endif // BOID_ZONES_H
@@ -1,8 +1,20 @@
+#define _POSIX_C_SOURCE 199309L // clock_gettime
+
 #include "raylib.h"
 #include "raymath.h"
+#include "rlgl.h"
+#include "boid.h"
+#include "boid_checkpoint.h"
+#include "boid_splat.h"
+#include "boid_telemetry.h"
+#include "boid_watchdog.h"
 #include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <math.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
 
 // ============================================================================
 // GAMESTATE - Data
@@ -10,415 +22,841 @@
 
 #define SCREEN_WIDTH 2560
 #define SCREEN_HEIGHT 1440
+#define MAX_ENTITIES 8000
 
-// ============================================================================
-// COMPONENTS - Pure data
-// ============================================================================
+// The demo world covers the screen
+#define GRID_WIDTH (SCREEN_WIDTH / BOID_CELL_SIZE)
+#define GRID_HEIGHT (SCREEN_HEIGHT / BOID_CELL_SIZE)
 
-typedef struct {
-    bool active;
-} Entity;
+#define TARGET_FPS 60 // Held by FrameCapWait rather than raylib, so the wait can be left out of frame times
+#define CHECKPOINT_DEFAULT_INTERVAL 3600 // Ticks; one minute at 60 FPS
+#define WATCHDOG_FRAMES 120 // Two seconds at 60 FPS before and including a spike
+#define WATCHDOG_DEFAULT_MS 25.0 // A frame and a half at 60 FPS
 
-// ============================================================================
-// SPATIAL GRID - For fast neighbor lookups
-// ============================================================================
+BoidWorld *world;
 
-#define CELL_SIZE 50
-#define GRID_WIDTH (SCREEN_WIDTH / CELL_SIZE + 1)
-#define GRID_HEIGHT (SCREEN_HEIGHT / CELL_SIZE + 1)
-#define MAX_ENTITIES_PER_CELL 100
+// Optional: --checkpoint <path> [--checkpoint-every ticks]
+BoidCheckpointer *checkpointer = NULL;
+int checkpointInterval = CHECKPOINT_DEFAULT_INTERVAL;
 
-typedef struct {
-    int entities[MAX_ENTITIES_PER_CELL];
-    int count;
-} GridCell;
+// Optional: --telemetry unix:<path> | udp:<port>; read with tools/telemetry.c
+BoidTelemetrySender *telemetry = NULL;
 
-typedef struct {
-    GridCell cells[GRID_WIDTH][GRID_HEIGHT];
-} SpatialGrid;
+// Optional: --watchdog <directory> [--watchdog-ms ms]
+BoidWatchdog *watchdog = NULL;
+double watchdogThresholdMs = WATCHDOG_DEFAULT_MS;
 
-SpatialGrid spatialGrid;
-
-void ClearSpatialGrid(SpatialGrid *grid)
+double NowSeconds(void)
 {
-    memset(grid, 0, sizeof(SpatialGrid));
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
 }
 
-void AddToSpatialGrid(SpatialGrid *grid, int entityId, Vector2 pos)
+// Sleeps out what is left of a TARGET_FPS frame that took frameSeconds;
+// returns the seconds actually waited
+double FrameCapWait(double frameSeconds)
 {
-    int gridX = (int)(pos.x / CELL_SIZE);
-    int gridY = (int)(pos.y / CELL_SIZE);
-    
-    // Clamp to grid bounds
-    if (gridX < 0) gridX = 0;
-    if (gridX >= GRID_WIDTH) gridX = GRID_WIDTH - 1;
-    if (gridY < 0) gridY = 0;
-    if (gridY >= GRID_HEIGHT) gridY = GRID_HEIGHT - 1;
+    double remaining = 1.0 / TARGET_FPS - frameSeconds;
+    if (remaining <= 0.0) return 0.0;
     
-    GridCell *cell = &grid->cells[gridX][gridY];
-    if (cell->count < MAX_ENTITIES_PER_CELL)
-    {
-        cell->entities[cell->count++] = entityId;
-    }
+    double waitStart = NowSeconds();
+    WaitTime(remaining);
+    return NowSeconds() - waitStart;
+}
+
+const char *NeighborBudgetModeName(NeighborBudgetMode mode)
+{
+    return (mode == NEIGHBOR_BUDGET_STRATIFIED) ? "stratified" : "nearest";
 }
 
-// Query nearby entities within a radius
-void QuerySpatialGrid(SpatialGrid *grid, Vector2 pos, float radius, int *outEntities, int *outCount, int maxResults)
+const char *RadiusPolicyName(BoidRadiusPolicy policy)
 {
-    *outCount = 0;
+    static const char *names[BOID_RADIUS_POLICY_COUNT] = { "own", "min", "max" };
+    return names[policy];
+}
+
+// Uniform in [1 - spread, 1]: radii shrink from the configured ones, never grow
+float radiusSpread = 0.0f;
+
+void RandomizeRadiusScales(float spread)
+{
+    float *scales = BoidWorldRadiusScales(world);
+    for (int i = 0; i < BoidWorldCount(world); i++) scales[i] = 1.0f - spread * GetRandomValue(0, 1000) / 1000.0f;
+}
+
+const char *PageModeName(BoidPageMode pages)
+{
+    static const char *names[BOID_PAGES_MODE_COUNT] = { "off", "thp", "huge" };
+    return names[pages];
+}
+
+// Optional: --workers N (default one per online CPU), --pages off|thp|huge
+// (default thp), --pin for a CPU per worker. With --resume the defaults for
+// the first two are the checkpoint's instead.
+int demoWorkers = 0;
+int demoPages = -1; // A BoidPageMode; -1: the default
+bool demoPin = false;
+
+// Optional: --broadphase grid|kdtree|sweep|hash, or all (benchmark only: one
+// run per broadphase from the same starting state). -1 keeps the world's.
+#define BROADPHASE_ALL BOID_BROADPHASE_COUNT
+int demoBroadphase = -1;
+
+BoidWorld *CreateDemoWorld(void)
+{
+    BoidWorldConfig config = BoidDefaultConfig();
+    config.capacity = MAX_ENTITIES;
+    config.width = SCREEN_WIDTH;
+    config.height = SCREEN_HEIGHT;
+    config.workers = (demoWorkers > 0) ? demoWorkers : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    config.pages = (demoPages >= 0) ? demoPages : BOID_PAGES_TRANSPARENT;
+    config.pinWorkers = demoPin;
+    config.broadphase = (demoBroadphase >= 0 && demoBroadphase < BOID_BROADPHASE_COUNT) ? demoBroadphase : BOID_BROADPHASE_GRID;
+    
+    BoidWorld *w = BoidWorldCreate(&config);
+    if (!w) return NULL;
     
-    // Calculate grid cell range to check
-    int minX = (int)((pos.x - radius) / CELL_SIZE);
-    int maxX = (int)((pos.x + radius) / CELL_SIZE);
-    int minY = (int)((pos.y - radius) / CELL_SIZE);
-    int maxY = (int)((pos.y + radius) / CELL_SIZE);
+    BoidWorldSpawnRandom(w, MAX_ENTITIES, 20);
     
-    // Clamp to grid bounds
-    if (minX < 0) minX = 0;
-    if (maxX >= GRID_WIDTH) maxX = GRID_WIDTH - 1;
-    if (minY < 0) minY = 0;
-    if (maxY >= GRID_HEIGHT) maxY = GRID_HEIGHT - 1;
+    // A few pieces of level geometry to flow around
+    Vector2 block[] = { { 600, 400 }, { 900, 400 }, { 900, 600 }, { 600, 600 } };
+    Vector2 wedge[] = { { 1700, 900 }, { 2000, 1150 }, { 1550, 1100 } };
+    BoidWorldAddObstaclePolygon(w, block, 4);
+    BoidWorldAddObstaclePolygon(w, wedge, 3);
+    BoidWorldAddObstacle(w, (Vector2){ 1200, 200 }, (Vector2){ 1300, 700 });
+    
+    // Trigger regions for the zone event stream
+    BoidWorldAddZoneCircle(w, (Vector2){ 400, 1000 }, 220);
+    BoidWorldAddZoneRect(w, (Vector2){ 2000, 200 }, (Vector2){ 2400, 500 });
+    return w;
+}
+
+// Game-side view of the zone event stream, drained once per frame
+typedef struct {
+    int occupancy[BOID_MAX_ZONES]; // Kept up to date from the events alone
+    int entered, exited;           // Last frame
+} ZoneCounters;
+
+ZoneCounters zoneCounters;
+
+void ZoneEventSystem(void)
+{
+    static BoidZoneEvent events[1024];
+    zoneCounters.entered = 0;
+    zoneCounters.exited = 0;
     
-    // Collect entities from nearby cells
-    for (int y = minY; y <= maxY; y++)
+    int n;
+    while ((n = BoidWorldDrainZoneEvents(world, events, 1024)) > 0)
     {
-        for (int x = minX; x <= maxX; x++)
+        for (int e = 0; e < n; e++)
         {
-            GridCell *cell = &grid->cells[x][y];
-            for (int i = 0; i < cell->count; i++)
-            {
-                if (*outCount < maxResults)
-                {
-                    outEntities[(*outCount)++] = cell->entities[i];
-                }
-            }
+            bool enter = (events[e].type == BOID_ZONE_ENTER);
+            zoneCounters.occupancy[events[e].zone] += enter ? 1 : -1;
+            if (enter) zoneCounters.entered++;
+            else zoneCounters.exited++;
         }
     }
 }
 
-// ============================================================================
-// ECS DATA - Struct of Arrays
-// ============================================================================
-
-#define MAX_ENTITIES 8000
+// Hands a snapshot to the background writer every checkpointInterval ticks
+void CheckpointSystem(void)
+{
+    if (!checkpointer) return;
+    if (BoidWorldTick(world) % checkpointInterval != 0) return;
+    
+    if (!BoidCheckpointerRequest(checkpointer, world))
+        TraceLog(LOG_WARNING, "CHECKPOINT: tick %llu skipped, previous write still in flight", (unsigned long long)BoidWorldTick(world));
+}
 
-Entity entities[MAX_ENTITIES];
-Vector2 positions[MAX_ENTITIES];
-Vector2 velocities[MAX_ENTITIES];
-Vector2 accelerations[MAX_ENTITIES];
-Color colors[MAX_ENTITIES];
+// One binary sample per tick; the sender drops it rather than wait
+void TelemetrySystem(const BoidStepTimings *timings, double frameSeconds)
+{
+    if (!telemetry) return;
+    
+    BoidTelemetrySample sample = BoidTelemetryMeasure(world, timings, frameSeconds);
+    BoidTelemetrySenderPush(telemetry, &sample);
+}
 
-int entityCount = 0;
+// Feeds the spike watchdog; a frame over the threshold dumps the last
+// WATCHDOG_FRAMES to disk from the watchdog's own thread
+void WatchdogSystem(const BoidStepTimings *timings, double frameSeconds, double renderSeconds)
+{
+    if (!watchdog) return;
+    
+    const SpatialGrid *grid = BoidWorldGrid(world);
+    BoidWatchdogFrame frame = {
+        .tick = BoidWorldTick(world),
+        .frameSeconds = frameSeconds,
+        .step = *timings,
+        .renderSeconds = renderSeconds,
+        .broadphaseSeconds = BoidWorldBroadphaseStats(world).buildSeconds,
+        .droppedInserts = grid->stats.droppedInserts,
+        .truncatedQueries = grid->stats.truncatedQueries,
+        .maxOccupancy = grid->stats.maxOccupancy,
+    };
+    if (BoidWatchdogRecord(watchdog, &frame, grid))
+        TraceLog(LOG_WARNING, "WATCHDOG: tick %llu took %.1f ms, dumping the last %d frames", (unsigned long long)frame.tick, frameSeconds * 1000.0, WATCHDOG_FRAMES);
+}
 
 // ============================================================================
-// BOID PARAMETERS
+// RENDER
 // ============================================================================
 
+typedef enum {
+    RENDER_DETAIL_SPRITES = 0, // Rotated sprites (inside the LOD distance)
+    RENDER_DETAIL_POINTS,      // Everything as unrotated points
+} RenderDetail;
+
 typedef struct {
-    float perceptionRadius;
-    float separationRadius;
-    float maxSpeed;
-    float maxForce;
-    
-    float separationWeight;
-    float alignmentWeight;
-    float cohesionWeight;
-} BoidParams;
-
-BoidParams boidParams = {
-    .perceptionRadius = 20.0f,
-    .separationRadius = 10.0f,
-    .maxSpeed = 5.0f,
-    .maxForce = 0.7f,
-    .separationWeight = 3.0f,
-    .alignmentWeight = 1.0f,
-    .cohesionWeight = 0.5f,
+    RenderDetail detail;
+    float lodDistance; // Boids farther than this from the cursor are drawn as points
+} RenderSettings;
+
+RenderSettings renderSettings = {
+    .detail = RENDER_DETAIL_SPRITES,
+    .lodDistance = INFINITY,
 };
 
-// ============================================================================
-// UTILITY FUNCTIONS
-// ============================================================================
+void RenderSystem(Texture2D tex, Vector2 *pos, Vector2 *vel, BoidColor *col, BoidEntity *ent, int count, RenderSettings settings, Vector2 focus)
+{
+    bool pointsOnly = (settings.detail == RENDER_DETAIL_POINTS);
+    float lodDistanceSq = settings.lodDistance * settings.lodDistance;
+    
+    for (int i = 0; i < count; i++)
+    {
+        if (!ent[i].active) continue;
+        
+        Color tint = { col[i].r, col[i].g, col[i].b, col[i].a };
+        
+        if (pointsOnly || Vector2DistanceSqr(pos[i], focus) > lodDistanceSq)
+        {
+            DrawRectangleV((Vector2){ pos[i].x - 1, pos[i].y - 1 }, (Vector2){ 3, 3 }, tint);
+            continue;
+        }
+        
+        float rotation = atan2f(vel[i].y, vel[i].x) * RAD2DEG + 90.0f;
+        
+        Rectangle source = { 0, 0, 8, 8 };
+        Rectangle dest = { pos[i].x, pos[i].y, 8, 8 };
+        Vector2 origin = { 4, 4 };
+        
+        DrawTexturePro(tex, source, dest, origin, rotation, tint);
+    }
+}
 
-Color GetRandomColor()
+void ObstacleRenderSystem(const ObstacleSegment *segments, int count)
 {
-    Color blue = (Color){100, 143, 255, 255};
-    Color purple = (Color){120, 94, 240, 255};
-    Color pink = (Color){220, 38, 127, 255};
-    Color orange = (Color){254, 97, 0, 255};
-    Color yellow = (Color){255, 176, 0, 255};
-    Color colorPalette[5] = { blue, purple, pink, orange, yellow };
-    return colorPalette[GetRandomValue(0, 4)];
+    for (int i = 0; i < count; i++) DrawLineEx(segments[i].a, segments[i].b, 3.0f, LIGHTGRAY);
 }
 
-Vector2 Vector2Limit(Vector2 v, float max)
+void ZoneRenderSystem(const BoidZone *zones, int count)
 {
-    float magSq = v.x * v.x + v.y * v.y;
-    if (magSq > max * max)
+    for (int z = 0; z < count; z++)
     {
-        float mag = sqrtf(magSq);
-        return (Vector2){ (v.x / mag) * max, (v.y / mag) * max };
+        Vector2 label;
+        if (zones[z].shape == BOID_ZONE_RECT)
+        {
+            Rectangle r = { zones[z].min.x, zones[z].min.y, zones[z].max.x - zones[z].min.x, zones[z].max.y - zones[z].min.y };
+            DrawRectangleLinesEx(r, 2.0f, SKYBLUE);
+            label = zones[z].min;
+        }
+        else
+        {
+            DrawCircleLinesV(zones[z].center, zones[z].radius, SKYBLUE);
+            label = (Vector2){ zones[z].center.x - zones[z].radius, zones[z].center.y - zones[z].radius };
+        }
+        DrawText(TextFormat("%d", zoneCounters.occupancy[z]), (int)label.x + 6, (int)label.y + 6, 20, SKYBLUE);
     }
-    return v;
 }
 
-Vector2 Vector2SetMag(Vector2 v, float mag)
+// The first press sends the whole flock to the cursor; later presses move the
+// goal and its field rebuilds over the next frames
+int demoGoal = -1;
+Vector2 demoGoalTarget;
+
+void GoalInputSystem(Vector2 target)
 {
-    float currentMag = sqrtf(v.x * v.x + v.y * v.y);
-    if (currentMag > 0)
+    demoGoalTarget = target;
+    if (demoGoal >= 0)
     {
-        return (Vector2){ (v.x / currentMag) * mag, (v.y / currentMag) * mag };
+        BoidWorldMoveGoal(world, demoGoal, target);
+        return;
     }
-    return v;
+    
+    demoGoal = BoidWorldAddGoal(world, target);
+    if (demoGoal < 0) return;
+    
+    int *goalIds = BoidWorldGoalIds(world);
+    for (int i = 0; i < BoidWorldCount(world); i++) goalIds[i] = demoGoal;
+}
+
+void GoalRenderSystem(void)
+{
+    if (demoGoal < 0) return;
+    DrawCircleLinesV(demoGoalTarget, 10, GOLD);
+    DrawCircleV(demoGoalTarget, 3, GOLD);
 }
 
 // ============================================================================
-// ENTITY MANAGEMENT
+// CPU RENDER - Sprites splatted into a framebuffer from a pre-rotated atlas
 // ============================================================================
 
-int CreateEntity(Vector2 position, Vector2 velocity, Color color)
+typedef struct {
+    bool enabled;
+    SplatAtlas atlas;
+    uint32_t *pixels; // SCREEN_WIDTH x SCREEN_HEIGHT RGBA8
+    Texture2D texture; // Only in windowed mode
+} CpuRenderer;
+
+CpuRenderer cpuRenderer;
+
+// Headless when window is false: no texture, SplatFrame only
+bool InitCpuRenderer(CpuRenderer *renderer, const char *spritePath, bool window)
 {
-    if (entityCount >= MAX_ENTITIES) return -1;
+    memset(renderer, 0, sizeof(CpuRenderer));
     
-    int id = entityCount;
-    entities[id].active = true;
-    positions[id] = position;
-    velocities[id] = velocity;
-    accelerations[id] = (Vector2){ 0, 0 };
-    colors[id] = color;
+    Image sprite = LoadImage(spritePath);
+    if (!sprite.data) return false;
+    ImageFormat(&sprite, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+    bool ok = SplatAtlasBuild(&renderer->atlas, sprite.data, sprite.width, sprite.height);
+    UnloadImage(sprite);
+    
+    renderer->pixels = malloc((size_t)SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(uint32_t));
+    if (!ok || !renderer->pixels)
+    {
+        SplatAtlasFree(&renderer->atlas);
+        free(renderer->pixels);
+        renderer->pixels = NULL;
+        return false;
+    }
     
-    entityCount++;
-    return id;
+    if (window)
+    {
+        Image img = {
+            .data = renderer->pixels,
+            .width = SCREEN_WIDTH,
+            .height = SCREEN_HEIGHT,
+            .mipmaps = 1,
+            .format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8,
+        };
+        renderer->texture = LoadTextureFromImage(img);
+    }
+    return true;
 }
 
-void CreateRandomEntity(int width, int height, int border)
+void UnloadCpuRenderer(CpuRenderer *renderer)
 {
-    Vector2 pos = {
-        GetRandomValue(border, width - border) * 1.0f,
-        GetRandomValue(border, height - border) * 1.0f,
-    };
-    
-    Vector2 vel = {
-        GetRandomValue(-4, 4) * 0.25f,
-        GetRandomValue(-4, 4) * 0.25f,
-    };
-    
-    Color color = GetRandomColor();
+    if (renderer->texture.id) UnloadTexture(renderer->texture);
+    SplatAtlasFree(&renderer->atlas);
+    free(renderer->pixels);
+}
+
+// Clears to background and splats every boid; returns the seconds spent
+// splatting
+double SplatFrame(CpuRenderer *renderer, Color background)
+{
+    uint32_t clear;
+    memcpy(&clear, &background, sizeof(clear));
+    for (size_t p = 0; p < (size_t)SCREEN_WIDTH * SCREEN_HEIGHT; p++) renderer->pixels[p] = clear;
     
-    CreateEntity(pos, vel, color);
+    SplatTarget target = { (uint8_t *)renderer->pixels, SCREEN_WIDTH, SCREEN_HEIGHT, SCREEN_WIDTH * 4 };
+    double start = NowSeconds();
+    SplatBoids(&renderer->atlas, &target, BoidWorldPositions(world), BoidWorldVelocities(world), BoidWorldColors(world), BoidWorldEntities(world), BoidWorldCount(world));
+    return NowSeconds() - start;
+}
+
+void CpuRenderSystem(CpuRenderer *renderer, Color background)
+{
+    SplatFrame(renderer, background);
+    UpdateTexture(renderer->texture, renderer->pixels);
+    DrawTexture(renderer->texture, 0, 0, WHITE);
 }
 
 // ============================================================================
-// SPATIAL GRID UPDATE SYSTEM
+// HEATMAP OVERLAY - Per-cell density / mean velocity, one texel per grid cell
 // ============================================================================
 
-void SpatialGridUpdateSystem(SpatialGrid *grid, Vector2 *pos, Entity *ent, int count)
+typedef enum {
+    HEATMAP_OFF = 0,
+    HEATMAP_DENSITY,
+    HEATMAP_VELOCITY,
+    HEATMAP_MODE_COUNT
+} HeatmapMode;
+
+typedef struct {
+    Texture2D texture;
+    Color pixels[GRID_HEIGHT][GRID_WIDTH]; // Row-major to match the texture upload
+    HeatmapMode mode;
+} HeatmapOverlay;
+
+HeatmapOverlay heatmap;
+
+const char *HeatmapModeName(HeatmapMode mode)
 {
-    ClearSpatialGrid(grid);
-    
-    for (int i = 0; i < count; i++)
+    switch (mode)
     {
-        if (!ent[i].active) continue;
-        AddToSpatialGrid(grid, i, pos[i]);
+        case HEATMAP_DENSITY: return "density";
+        case HEATMAP_VELOCITY: return "velocity";
+        default: return "off";
     }
 }
 
-// ============================================================================
-// BOID SYSTEMS - Flocking behavior (with spatial partitioning)
-// ============================================================================
+void InitHeatmapOverlay(HeatmapOverlay *overlay)
+{
+    memset(overlay->pixels, 0, sizeof(overlay->pixels));
+    overlay->mode = HEATMAP_OFF;
+    
+    Image img = {
+        .data = overlay->pixels,
+        .width = GRID_WIDTH,
+        .height = GRID_HEIGHT,
+        .mipmaps = 1,
+        .format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8,
+    };
+    overlay->texture = LoadTextureFromImage(img);
+    SetTextureFilter(overlay->texture, TEXTURE_FILTER_POINT);
+}
 
-void BoidSeparationSystem(SpatialGrid *grid, Vector2 *pos, Vector2 *vel, Vector2 *acc, Entity *ent, int count, BoidParams params)
+Color HeatmapDensityColor(int count)
 {
-    int nearbyEntities[MAX_ENTITIES_PER_CELL * 9]; // Max entities in 3x3 grid
-    int nearbyCount;
+    if (count == 0) return BLANK;
     
-    for (int i = 0; i < count; i++)
-    {
-        if (!ent[i].active) continue;
-        
-        Vector2 steering = { 0, 0 };
-        int total = 0;
-        
-        // Query spatial grid for nearby entities
-        QuerySpatialGrid(grid, pos[i], params.separationRadius, nearbyEntities, &nearbyCount, MAX_ENTITIES_PER_CELL * 9);
-        
-        // Check only nearby boids
-        for (int k = 0; k < nearbyCount; k++)
-        {
-            int j = nearbyEntities[k];
-            if (i == j || !ent[j].active) continue;
-            
-            float dist = Vector2Distance(pos[i], pos[j]);
-            
-            if (dist < params.separationRadius && dist > 0)
-            {
-                Vector2 diff = Vector2Subtract(pos[i], pos[j]);
-                diff.x /= dist;
-                diff.y /= dist;
-                
-                steering = Vector2Add(steering, diff);
-                total++;
-            }
-        }
-        
-        if (total > 0)
-        {
-            steering.x /= total;
-            steering.y /= total;
-            
-            steering = Vector2SetMag(steering, params.maxSpeed);
-            steering = Vector2Subtract(steering, vel[i]);
-            steering = Vector2Limit(steering, params.maxForce);
-            
-            steering.x *= params.separationWeight;
-            steering.y *= params.separationWeight;
-            
-            acc[i] = Vector2Add(acc[i], steering);
-        }
-    }
+    // Cold (blue) -> hot (red); a full cell is about to drop inserts
+    float t = (float)count / MAX_ENTITIES_PER_CELL;
+    if (count >= MAX_ENTITIES_PER_CELL) return (Color){ 255, 0, 0, 220 };
+    
+    Color c = ColorFromHSV(240.0f * (1.0f - t), 0.9f, 1.0f);
+    c.a = (unsigned char)(60 + 160 * t);
+    return c;
 }
 
-void BoidAlignmentSystem(SpatialGrid *grid, Vector2 *pos, Vector2 *vel, Vector2 *acc, Entity *ent, int count, BoidParams params)
+Color HeatmapVelocityColor(int count, Vector2 velocitySum, float maxSpeed)
 {
-    int nearbyEntities[MAX_ENTITIES_PER_CELL * 9];
-    int nearbyCount;
+    if (count == 0) return BLANK;
     
-    for (int i = 0; i < count; i++)
-    {
-        if (!ent[i].active) continue;
-        
-        Vector2 steering = { 0, 0 };
-        int total = 0;
-        
-        QuerySpatialGrid(grid, pos[i], params.perceptionRadius, nearbyEntities, &nearbyCount, MAX_ENTITIES_PER_CELL * 9);
-        
-        for (int k = 0; k < nearbyCount; k++)
-        {
-            int j = nearbyEntities[k];
-            if (i == j || !ent[j].active) continue;
-            
-            float dist = Vector2Distance(pos[i], pos[j]);
-            
-            if (dist < params.perceptionRadius)
-            {
-                steering = Vector2Add(steering, vel[j]);
-                total++;
-            }
-        }
-        
-        if (total > 0)
-        {
-            steering.x /= total;
-            steering.y /= total;
-            
-            steering = Vector2SetMag(steering, params.maxSpeed);
-            steering = Vector2Subtract(steering, vel[i]);
-            steering = Vector2Limit(steering, params.maxForce);
-            
-            steering.x *= params.alignmentWeight;
-            steering.y *= params.alignmentWeight;
-            
-            acc[i] = Vector2Add(acc[i], steering);
-        }
-    }
+    // Hue = mean heading, value = mean speed (low when headings cancel out)
+    Vector2 mean = { velocitySum.x / count, velocitySum.y / count };
+    float speed = sqrtf(mean.x * mean.x + mean.y * mean.y);
+    float hue = atan2f(mean.y, mean.x) * RAD2DEG + 180.0f;
+    float value = Clamp(speed / maxSpeed, 0.0f, 1.0f);
+    
+    Color c = ColorFromHSV(hue, 0.8f, 0.3f + 0.7f * value);
+    c.a = 160;
+    return c;
 }
 
-void BoidCohesionSystem(SpatialGrid *grid, Vector2 *pos, Vector2 *vel, Vector2 *acc, Entity *ent, int count, BoidParams params)
+// O(cells): reads only the grid's per-cell aggregates, never the boids, and
+// only re-uploads the band of rows whose texels actually changed
+void HeatmapUpdateSystem(HeatmapOverlay *overlay, const SpatialGrid *grid, float maxSpeed)
 {
-    int nearbyEntities[MAX_ENTITIES_PER_CELL * 9];
-    int nearbyCount;
+    if (overlay->mode == HEATMAP_OFF) return;
     
-    for (int i = 0; i < count; i++)
+    int dirtyMin = GRID_HEIGHT;
+    int dirtyMax = -1;
+    
+    for (int y = 0; y < GRID_HEIGHT; y++)
     {
-        if (!ent[i].active) continue;
-        
-        Vector2 steering = { 0, 0 };
-        int total = 0;
-        
-        QuerySpatialGrid(grid, pos[i], params.perceptionRadius, nearbyEntities, &nearbyCount, MAX_ENTITIES_PER_CELL * 9);
-        
-        for (int k = 0; k < nearbyCount; k++)
+        for (int x = 0; x < GRID_WIDTH; x++)
         {
-            int j = nearbyEntities[k];
-            if (i == j || !ent[j].active) continue;
-            
-            float dist = Vector2Distance(pos[i], pos[j]);
+            const GridCell *cell = SpatialGridCellAt(grid, x, y);
+            Color c = (overlay->mode == HEATMAP_DENSITY)
+                ? HeatmapDensityColor(cell->count)
+                : HeatmapVelocityColor(cell->count, cell->velocitySum, maxSpeed);
             
-            if (dist < params.perceptionRadius)
+            Color *texel = &overlay->pixels[y][x];
+            if (memcmp(texel, &c, sizeof(Color)) != 0)
             {
-                steering = Vector2Add(steering, pos[j]);
-                total++;
+                *texel = c;
+                if (y < dirtyMin) dirtyMin = y;
+                dirtyMax = y;
             }
         }
-        
-        if (total > 0)
-        {
-            steering.x /= total;
-            steering.y /= total;
-            
-            steering = Vector2Subtract(steering, pos[i]);
-            steering = Vector2SetMag(steering, params.maxSpeed);
-            steering = Vector2Subtract(steering, vel[i]);
-            steering = Vector2Limit(steering, params.maxForce);
-            
-            steering.x *= params.cohesionWeight;
-            steering.y *= params.cohesionWeight;
-            
-            acc[i] = Vector2Add(acc[i], steering);
-        }
     }
+    
+    if (dirtyMax < 0) return;
+    
+    Rectangle rows = { 0, (float)dirtyMin, GRID_WIDTH, (float)(dirtyMax - dirtyMin + 1) };
+    UpdateTextureRec(overlay->texture, rows, overlay->pixels[dirtyMin]);
+}
+
+void HeatmapRenderSystem(HeatmapOverlay *overlay)
+{
+    if (overlay->mode == HEATMAP_OFF) return;
+    
+    // One quad, each texel stretched over its grid cell
+    Rectangle source = { 0, 0, GRID_WIDTH, GRID_HEIGHT };
+    Rectangle dest = { 0, 0, GRID_WIDTH * BOID_CELL_SIZE, GRID_HEIGHT * BOID_CELL_SIZE };
+    DrawTexturePro(overlay->texture, source, dest, (Vector2){ 0, 0 }, 0.0f, WHITE);
 }
 
 // ============================================================================
-// CORE SYSTEMS
+// FRAME GOVERNOR - Trades quality for frame time, one ladder step at a time
 // ============================================================================
 
-void AccelerationResetSystem(Vector2 *acc, Entity *ent, int count)
+#define GOVERNOR_TARGET_MS (1000.0 / 60.0)
+#define GOVERNOR_SMOOTHING 0.1         // EMA weight of the newest frame
+#define GOVERNOR_DOWNGRADE_RATIO 0.95  // Over budget above this fraction of the target...
+#define GOVERNOR_DOWNGRADE_FRAMES 10   // ...for this many frames in a row
+#define GOVERNOR_UPGRADE_RATIO 0.70    // Headroom below this fraction of the target...
+#define GOVERNOR_UPGRADE_FRAMES 120    // ...for this many frames in a row
+#define GOVERNOR_COOLDOWN_FRAMES 30    // Frames to let the EMA settle after a change
+
+typedef struct {
+    int substeps;
+    int maxNeighbors;
+    float lodDistance;
+    RenderDetail detail;
+} QualityLevel;
+
+// Best quality first; GOVERNOR_DEFAULT_LEVEL matches the ungoverned settings
+static const QualityLevel qualityLadder[] = {
+    { 2, 0,  INFINITY, RENDER_DETAIL_SPRITES },
+    { 1, 0,  INFINITY, RENDER_DETAIL_SPRITES },
+    { 1, 48, INFINITY, RENDER_DETAIL_SPRITES },
+    { 1, 48, 600.0f,   RENDER_DETAIL_SPRITES },
+    { 1, 24, 300.0f,   RENDER_DETAIL_SPRITES },
+    { 1, 24, 0.0f,     RENDER_DETAIL_POINTS },
+    { 1, 12, 0.0f,     RENDER_DETAIL_POINTS },
+};
+#define QUALITY_LEVEL_COUNT ((int)(sizeof(qualityLadder) / sizeof(qualityLadder[0])))
+#define GOVERNOR_DEFAULT_LEVEL 1
+
+typedef struct {
+    bool enabled;
+    int level;
+    double simMs;    // Smoothed
+    double renderMs; // Smoothed
+    int overFrames;
+    int underFrames;
+    int cooldown;
+} FrameGovernor;
+
+FrameGovernor governor = { .level = GOVERNOR_DEFAULT_LEVEL };
+
+void ApplyQualityLevel(int level)
 {
-    for (int i = 0; i < count; i++)
+    const QualityLevel *q = &qualityLadder[level];
+    BoidParams *params = BoidWorldParams(world);
+    params->substeps = q->substeps;
+    params->maxNeighbors = q->maxNeighbors;
+    renderSettings.lodDistance = q->lodDistance;
+    renderSettings.detail = q->detail;
+}
+
+// Feed with this frame's measured work, excluding the vsync/FPS-cap wait
+void FrameGovernorUpdate(FrameGovernor *gov, double simSeconds, double renderSeconds)
+{
+    gov->simMs += GOVERNOR_SMOOTHING * (simSeconds * 1000.0 - gov->simMs);
+    gov->renderMs += GOVERNOR_SMOOTHING * (renderSeconds * 1000.0 - gov->renderMs);
+    
+    if (!gov->enabled) return;
+    if (gov->cooldown > 0)
     {
-        if (!ent[i].active) continue;
-        acc[i] = (Vector2){ 0, 0 };
+        gov->cooldown--;
+        return;
     }
+    
+    double workMs = gov->simMs + gov->renderMs;
+    gov->overFrames = (workMs > GOVERNOR_TARGET_MS * GOVERNOR_DOWNGRADE_RATIO) ? gov->overFrames + 1 : 0;
+    gov->underFrames = (workMs < GOVERNOR_TARGET_MS * GOVERNOR_UPGRADE_RATIO) ? gov->underFrames + 1 : 0;
+    
+    int next = gov->level;
+    if (gov->overFrames >= GOVERNOR_DOWNGRADE_FRAMES && gov->level < QUALITY_LEVEL_COUNT - 1) next = gov->level + 1;
+    else if (gov->underFrames >= GOVERNOR_UPGRADE_FRAMES && gov->level > 0) next = gov->level - 1;
+    if (next == gov->level) return;
+    
+    const QualityLevel *q = &qualityLadder[next];
+    TraceLog(LOG_INFO, "GOVERNOR: %s level %d -> %d (sim %.2f ms + render %.2f ms, target %.2f ms): substeps %d, neighbor cap %d, LOD %.0f, %s",
+        next > gov->level ? "downgrade" : "upgrade", gov->level, next, gov->simMs, gov->renderMs, GOVERNOR_TARGET_MS,
+        q->substeps, q->maxNeighbors, q->lodDistance, q->detail == RENDER_DETAIL_POINTS ? "points" : "sprites");
+    
+    gov->level = next;
+    gov->overFrames = 0;
+    gov->underFrames = 0;
+    gov->cooldown = GOVERNOR_COOLDOWN_FRAMES;
+    ApplyQualityLevel(next);
 }
 
-void PhysicsSystem(Vector2 *pos, Vector2 *vel, Vector2 *acc, Entity *ent, int count, float maxSpeed)
+// Disabling goes back to the ungoverned settings rather than staying on
+// whatever rung the governor had reached
+void FrameGovernorSetEnabled(FrameGovernor *gov, bool enabled)
 {
-    for (int i = 0; i < count; i++)
+    gov->enabled = enabled;
+    gov->overFrames = 0;
+    gov->underFrames = 0;
+    gov->cooldown = GOVERNOR_COOLDOWN_FRAMES;
+    if (!enabled) gov->level = GOVERNOR_DEFAULT_LEVEL;
+    ApplyQualityLevel(gov->level);
+    TraceLog(LOG_INFO, "GOVERNOR: %s at level %d", enabled ? "enabled" : "disabled", gov->level);
+}
+
+// A manual neighbor cap would be overwritten at the governor's next level
+// change, so editing it turns the governor off and keeps the edited value
+void FrameGovernorAdjustNeighborCap(FrameGovernor *gov, int delta)
+{
+    BoidParams *params = BoidWorldParams(world);
+    int cap = params->maxNeighbors + delta;
+    if (gov->enabled) FrameGovernorSetEnabled(gov, false);
+    params->maxNeighbors = (cap > 0) ? cap : 0;
+}
+
+// ============================================================================
+// WORKER LOAD - Flocking balance across the pool
+// ============================================================================
+
+// Max over mean busy time between two stats snapshots (then may be NULL):
+// 1 is perfectly even, workers means one worker did everything
+double WorkerImbalance(const BoidWorkerStats *now, const BoidWorkerStats *then, int workers)
+{
+    double sum = 0, max = 0;
+    for (int w = 0; w < workers; w++)
     {
-        if (!ent[i].active) continue;
-        
-        vel[i] = Vector2Add(vel[i], acc[i]);
-        vel[i] = Vector2Limit(vel[i], maxSpeed);
-        pos[i] = Vector2Add(pos[i], vel[i]);
+        double busy = now[w].busy - (then ? then[w].busy : 0.0);
+        sum += busy;
+        if (busy > max) max = busy;
     }
+    return (sum > 0) ? max * workers / sum : 1.0;
 }
 
-void WrapAroundSystem(Vector2 *pos, Entity *ent, int count, int width, int height)
+typedef struct {
+    BoidWorkerStats *now, *last; // One per worker
+    int workers;
+    double imbalance; // Smoothed
+    int steals;       // Last frame
+} WorkerLoad;
+
+WorkerLoad workerLoad;
+
+void WorkerLoadSystem(WorkerLoad *load)
 {
-    for (int i = 0; i < count; i++)
+    int workers = BoidWorldMemoryInfo(world).workers;
+    if (load->workers != workers)
     {
-        if (!ent[i].active) continue;
-        
-        if (pos[i].x < 0) pos[i].x = width;
-        if (pos[i].x > width) pos[i].x = 0;
-        if (pos[i].y < 0) pos[i].y = height;
-        if (pos[i].y > height) pos[i].y = 0;
+        free(load->now);
+        free(load->last);
+        load->now = calloc(workers, sizeof(BoidWorkerStats));
+        load->last = calloc(workers, sizeof(BoidWorkerStats));
+        load->workers = (load->now && load->last) ? workers : 0;
+        load->imbalance = 1.0;
+        if (load->workers) BoidWorldWorkerStats(world, load->last);
+        return;
     }
+    
+    BoidWorldWorkerStats(world, load->now);
+    load->steals = 0;
+    for (int w = 0; w < workers; w++) load->steals += load->now[w].steals - load->last[w].steals;
+    load->imbalance += GOVERNOR_SMOOTHING * (WorkerImbalance(load->now, load->last, workers) - load->imbalance);
+    
+    BoidWorkerStats *swap = load->last;
+    load->last = load->now;
+    load->now = swap;
 }
 
-void RenderSystem(Texture2D tex, Vector2 *pos, Vector2 *vel, Color *col, Entity *ent, int count)
+void FreeWorkerLoad(WorkerLoad *load)
 {
-    for (int i = 0; i < count; i++)
+    free(load->now);
+    free(load->last);
+    *load = (WorkerLoad){ 0 };
+}
+
+// ============================================================================
+// BENCHMARK - Headless run, JSON report on stdout
+// ============================================================================
+
+#define BENCH_ERROR_SAMPLE_INTERVAL 60
+
+// Usage: boids --bench [ticks] [--neighbors N] [--budget nearest|stratified] [--splat] [--fused]
+//                       [--radius-spread f] [--radius-policy own|min|max]
+//                       [--workers N] [--pages off|thp|huge]
+//                       [--broadphase grid|kdtree|sweep|hash|all]
+//                       [--telemetry unix:<path>|udp:<port>]
+//                       [--watchdog <directory>] [--watchdog-ms ms]
+int RunBenchmark(int ticks)
+{
+    BoidParams *params = BoidWorldParams(world);
+    const SpatialGridStats *stats = &BoidWorldGrid(world)->stats;
+    
+    BoidStepTimings total = { 0 };
+    long long droppedInserts = 0;
+    long long truncatedQueries = 0;
+    int peakOccupancy = 0;
+    long long occupancyHistogram[OCCUPANCY_BINS] = { 0 };
+    NeighborBudgetError budgetError = { 0 };
+    int budgetSamples = 0;
+    double splatSeconds = 0;
+    double frameSeconds = 0;
+    double broadphaseSeconds = 0;
+    long long broadphaseTruncated = 0;
+    long long broadphaseClamped = 0;
+    int workers = BoidWorldMemoryInfo(world).workers;
+    BoidWorkerStats *workersBefore = calloc(workers, sizeof(BoidWorkerStats));
+    BoidWorkerStats *workersAfter = calloc(workers, sizeof(BoidWorkerStats));
+    if (!workersBefore || !workersAfter)
     {
-        if (!ent[i].active) continue;
+        free(workersBefore);
+        free(workersAfter);
+        return 1;
+    }
+    BoidWorldWorkerStats(world, workersBefore);
+    
+    for (int t = 0; t < ticks; t++)
+    {
+        double tickStart = NowSeconds();
+        BoidStepTimings timings;
+        BoidWorldStep(world, 1, &timings);
+        CheckpointSystem();
+        ZoneEventSystem();
         
-        float rotation = atan2f(vel[i].y, vel[i].x) * RAD2DEG + 90.0f;
+        // Headless frame of the CPU render path, timed apart from the step
+        if (cpuRenderer.enabled)
+        {
+            double frameStart = NowSeconds();
+            splatSeconds += SplatFrame(&cpuRenderer, BLACK);
+            frameSeconds += NowSeconds() - frameStart;
+        }
+        double tickSeconds = NowSeconds() - tickStart;
+        TelemetrySystem(&timings, tickSeconds);
+        WatchdogSystem(&timings, tickSeconds, 0.0);
+        BoidBroadphaseStats tickBroadphase = BoidWorldBroadphaseStats(world); // Before the sample queries again
         
-        Rectangle source = { 0, 0, 8, 8 };
-        Rectangle dest = { pos[i].x, pos[i].y, 8, 8 };
-        Vector2 origin = { 4, 4 };
+        // Sampled outside the timed region; compares against this tick's grid
+        if (params->maxNeighbors > 0 && t % BENCH_ERROR_SAMPLE_INTERVAL == 0)
+        {
+            NeighborBudgetError e = BoidWorldMeasureNeighborBudgetError(world);
+            budgetError.meanError += e.meanError;
+            budgetError.relativeError += e.relativeError;
+            budgetSamples++;
+        }
         
-        DrawTexturePro(tex, source, dest, origin, rotation, col[i]);
+        total.grid += timings.grid;
+        total.steering += timings.steering;
+        total.physics += timings.physics;
+        total.publish += timings.publish;
+        broadphaseSeconds += tickBroadphase.buildSeconds;
+        broadphaseTruncated += tickBroadphase.truncatedQueries;
+        broadphaseClamped += tickBroadphase.clampedQueries;
+        
+        droppedInserts += stats->droppedInserts;
+        truncatedQueries += stats->truncatedQueries;
+        if (stats->maxOccupancy > peakOccupancy) peakOccupancy = stats->maxOccupancy;
+        for (int b = 0; b < OCCUPANCY_BINS; b++) occupancyHistogram[b] += stats->occupancyHistogram[b];
+    }
+    
+    double msPerTick = 1000.0 / ticks;
+    BoidWorldWorkerStats(world, workersAfter);
+    
+    printf("{\n");
+    printf("  \"boids\": %d,\n", BoidWorldCount(world));
+    printf("  \"ticks\": %d,\n", ticks);
+    printf("  \"layout\": \"%s\",\n", BoidLayoutName());
+    printf("  \"pipeline\": \"%s\",\n", params->fusedPipeline ? "fused" : "systems");
+    BoidMemoryInfo memory = BoidWorldMemoryInfo(world);
+    printf("  \"memory\": { \"workers\": %d, \"pinned\": %s, \"pages\": \"%s\", \"arenaMB\": %.1f },\n", memory.workers, memory.pinned ? "true" : "false", PageModeName(memory.pages),
+        memory.bytes / (1024.0 * 1024.0));
+    printf("  \"msPerTick\": { \"grid\": %.4f, \"steering\": %.4f, \"physics\": %.4f, \"publish\": %.4f, \"total\": %.4f },\n",
+        total.grid * msPerTick, total.steering * msPerTick, total.physics * msPerTick, total.publish * msPerTick,
+        (total.grid + total.steering + total.physics + total.publish) * msPerTick);
+    
+    // Flocking pass only; busy + idle is its wall time on every worker
+    long long tasks = 0, steals = 0;
+    printf("  \"workers\": {\n");
+    printf("    \"busyMsPerTick\": [");
+    for (int w = 0; w < workers; w++) printf("%s%.4f", w ? ", " : "", (workersAfter[w].busy - workersBefore[w].busy) * msPerTick);
+    printf("],\n");
+    printf("    \"idleMsPerTick\": [");
+    for (int w = 0; w < workers; w++) printf("%s%.4f", w ? ", " : "", (workersAfter[w].idle - workersBefore[w].idle) * msPerTick);
+    printf("],\n");
+    for (int w = 0; w < workers; w++)
+    {
+        tasks += workersAfter[w].tasks - workersBefore[w].tasks;
+        steals += workersAfter[w].steals - workersBefore[w].steals;
+    }
+    printf("    \"tasksPerTick\": %.1f,\n", (double)tasks / ticks);
+    printf("    \"steals\": %lld,\n", steals);
+    printf("    \"imbalance\": %.3f\n", WorkerImbalance(workersAfter, workersBefore, workers));
+    printf("  },\n");
+    free(workersBefore);
+    free(workersAfter);
+    printf("  \"grid\": {\n");
+    printf("    \"cellCapacity\": %d,\n", MAX_ENTITIES_PER_CELL);
+    printf("    \"droppedInserts\": %lld,\n", droppedInserts);
+    printf("    \"truncatedQueries\": %lld,\n", truncatedQueries);
+    printf("    \"peakOccupancy\": %d,\n", peakOccupancy);
+    printf("    \"occupancyBinSize\": %d,\n", OCCUPANCY_BIN_SIZE);
+    printf("    \"occupancyHistogram\": [");
+    for (int b = 0; b < OCCUPANCY_BINS; b++) printf("%s%lld", b ? ", " : "", occupancyHistogram[b]);
+    printf("]\n");
+    printf("  },\n");
+    printf("  \"neighborBudget\": {\n");
+    printf("    \"maxNeighbors\": %d,\n", params->maxNeighbors);
+    printf("    \"mode\": \"%s\",\n", NeighborBudgetModeName(params->neighborBudgetMode));
+    printf("    \"samples\": %d,\n", budgetSamples);
+    printf("    \"meanAccelError\": %.6f,\n", budgetSamples ? budgetError.meanError / budgetSamples : 0.0);
+    printf("    \"relativeAccelError\": %.6f\n", budgetSamples ? budgetError.relativeError / budgetSamples : 0.0);
+    printf("  },\n");
+    if (cpuRenderer.enabled)
+    {
+        // Single-threaded, so boids/ms is also per core
+        printf("  \"splat\": { \"angles\": %d, \"spriteSize\": %d, \"msPerFrame\": %.4f, \"splatMs\": %.4f, \"boidsPerMsPerCore\": %.1f },\n",
+            SPLAT_ANGLES, cpuRenderer.atlas.size, frameSeconds * msPerTick, splatSeconds * msPerTick,
+            splatSeconds > 0 ? BoidWorldCount(world) * ticks / (splatSeconds * 1000.0) : 0.0);
+    }
+    BoidBroadphaseStats broadphase = BoidWorldBroadphaseStats(world);
+    // Only without dropped inserts do the other indexes see the grid's neighbors
+    bool matchesGrid = broadphase.kind == BOID_BROADPHASE_GRID || droppedInserts == 0;
+    printf("  \"broadphase\": { \"name\": \"%s\", \"buildMs\": %.4f, \"kB\": %.1f, \"distanceTestsPerBoid\": %.1f, \"truncatedQueries\": %lld, \"clampedQueries\": %lld, \"matchesGrid\": %s },\n",
+        BoidBroadphaseName(broadphase.kind), broadphaseSeconds * msPerTick, broadphase.bytes / 1024.0, broadphase.distanceTestsPerBoid, broadphaseTruncated, broadphaseClamped,
+        matchesGrid ? "true" : "false");
+    if (!matchesGrid)
+        fprintf(stderr, "%s: the grid dropped %lld inserts this run, which %s sees as neighbors, so its flock differs from the grid's\n",
+            BoidBroadphaseName(broadphase.kind), droppedInserts, BoidBroadphaseName(broadphase.kind));
+    printf("  \"radius\": { \"policy\": \"%s\", \"spread\": %.2f },\n", RadiusPolicyName(params->radiusPolicy), radiusSpread);
+    BoidZoneStats zs = BoidWorldZoneStats(world);
+    printf("  \"zones\": { \"transitionsPerTick\": %.1f, \"exactTestsPerTick\": %.1f, \"events\": %lld, \"dropped\": %lld }%s\n",
+        (double)zs.transitions / ticks, (double)zs.exactTests / ticks, zs.events, zs.dropped, (checkpointer || telemetry || watchdog) ? "," : "");
+    if (checkpointer)
+    {
+        BoidCheckpointStats cs = BoidCheckpointerStats(checkpointer);
+        printf("  \"checkpoint\": { \"interval\": %d, \"written\": %d, \"skipped\": %d, \"failed\": %d, \"lastCopyMs\": %.3f, \"lastWriteMs\": %.3f }%s\n",
+            checkpointInterval, cs.written, cs.skipped, cs.failed, cs.lastCopySeconds * 1000.0, cs.lastWriteSeconds * 1000.0, (telemetry || watchdog) ? "," : "");
+    }
+    if (telemetry)
+    {
+        // Cumulative over the process, so across runs with --broadphase all
+        BoidTelemetryStats ts = BoidTelemetrySenderStats(telemetry);
+        printf("  \"telemetry\": { \"sent\": %lld, \"dropped\": %lld, \"datagrams\": %lld }%s\n", ts.sent, ts.dropped, ts.datagrams, watchdog ? "," : "");
+    }
+    if (watchdog)
+    {
+        // Cumulative like telemetry
+        BoidSpikeStats ws = BoidWatchdogStats(watchdog);
+        printf("  \"watchdog\": { \"thresholdMs\": %.1f, \"frames\": %d, \"spikes\": %d, \"dumped\": %d, \"skipped\": %d, \"failed\": %d }\n",
+            watchdogThresholdMs, WATCHDOG_FRAMES, ws.spikes, ws.dumped, ws.skipped, ws.failed);
+    }
+    printf("}\n");
+    
+    return 0;
+}
+
+// ============================================================================
+// HUD
+// ============================================================================
+
+void DrawGridStats(const SpatialGridStats *stats, int x, int y)
+{
+    Color warn = (stats->droppedInserts > 0 || stats->truncatedQueries > 0) ? RED : BLACK;
+    DrawText(TextFormat("Dropped: %d  Truncated: %d", stats->droppedInserts, stats->truncatedQueries), x, y, 20, warn);
+    DrawText(TextFormat("Max/cell: %d of %d", stats->maxOccupancy, MAX_ENTITIES_PER_CELL), x, y + 20, 20, BLACK);
+    
+    // Occupancy histogram, log-scaled so the long tail stays visible
+    int barWidth = 380 / OCCUPANCY_BINS;
+    for (int b = 0; b < OCCUPANCY_BINS; b++)
+    {
+        int h = (int)(8.0f * log2f(1.0f + stats->occupancyHistogram[b]));
+        if (h > 40) h = 40;
+        Color barColor = (b == OCCUPANCY_BINS - 1) ? RED : DARKGRAY;
+        DrawRectangle(x + b * barWidth, y + 85 - h, barWidth - 2, h, barColor);
     }
 }
 
@@ -426,61 +864,278 @@ void RenderSystem(Texture2D tex, Vector2 *pos, Vector2 *vel, Color *col, Entity
 // MAIN
 // ============================================================================
 
-int main(void)
+int main(int argc, char **argv)
 {
-    InitWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "Boid Simulation - ECS + Spatial Partitioning");
-    SetTargetFPS(60);
+    const char *resumePath = NULL;
+    const char *checkpointPath = NULL;
+    const char *telemetryAddress = NULL;
+    const char *watchdogDirectory = NULL;
+    for (int a = 1; a < argc; a++) demoPin = demoPin || strcmp(argv[a], "--pin") == 0; // Takes no value, unlike the rest
+    for (int a = 1; a + 1 < argc; a++)
+    {
+        if (strcmp(argv[a], "--resume") == 0) resumePath = argv[++a];
+        else if (strcmp(argv[a], "--checkpoint") == 0) checkpointPath = argv[++a];
+        else if (strcmp(argv[a], "--checkpoint-every") == 0 && atoi(argv[a + 1]) > 0) checkpointInterval = atoi(argv[++a]);
+        else if (strcmp(argv[a], "--telemetry") == 0) telemetryAddress = argv[++a];
+        else if (strcmp(argv[a], "--watchdog") == 0) watchdogDirectory = argv[++a];
+        else if (strcmp(argv[a], "--watchdog-ms") == 0 && atof(argv[a + 1]) > 0) watchdogThresholdMs = atof(argv[++a]);
+        else if (strcmp(argv[a], "--workers") == 0) demoWorkers = atoi(argv[++a]);
+        else if (strcmp(argv[a], "--broadphase") == 0)
+        {
+            a++;
+            if (strcmp(argv[a], "all") == 0) demoBroadphase = BROADPHASE_ALL;
+            for (int b = 0; b < BOID_BROADPHASE_COUNT; b++)
+            {
+                if (strcmp(argv[a], BoidBroadphaseName(b)) == 0) demoBroadphase = b;
+            }
+        }
+        else if (strcmp(argv[a], "--pages") == 0)
+        {
+            a++;
+            for (int p = 0; p < BOID_PAGES_MODE_COUNT; p++)
+            {
+                if (strcmp(argv[a], PageModeName(p)) == 0) demoPages = p;
+            }
+        }
+    }
+    
+    // --workers and --pages describe this machine, not the saved one
+    BoidRestoreOptions restoreOptions = { demoWorkers, demoPages, demoPin };
+    world = resumePath ? BoidCheckpointLoadWith(resumePath, &restoreOptions) : CreateDemoWorld();
+    if (!world)
+    {
+        if (resumePath) fprintf(stderr, "Cannot resume from %s\n", resumePath);
+        return 1;
+    }
+    if (resumePath && (BoidWorldWidth(world) != SCREEN_WIDTH || BoidWorldHeight(world) != SCREEN_HEIGHT))
+    {
+        fprintf(stderr, "%s is not a %dx%d world\n", resumePath, SCREEN_WIDTH, SCREEN_HEIGHT);
+        BoidWorldDestroy(world);
+        return 1;
+    }
+    if (resumePath && demoBroadphase >= 0 && demoBroadphase < BOID_BROADPHASE_COUNT) BoidWorldSetBroadphase(world, demoBroadphase);
+    
+    if (checkpointPath)
+    {
+        checkpointer = BoidCheckpointerCreate(checkpointPath);
+        if (!checkpointer) fprintf(stderr, "Checkpointing disabled: cannot start writer\n");
+    }
+    if (telemetryAddress)
+    {
+        telemetry = BoidTelemetrySenderCreate(telemetryAddress, (uint32_t)getpid());
+        if (!telemetry) fprintf(stderr, "Telemetry disabled: cannot send to %s\n", telemetryAddress);
+    }
+    if (watchdogDirectory)
+    {
+        BoidWatchdogConfig watchdogConfig = { watchdogDirectory, WATCHDOG_FRAMES, watchdogThresholdMs / 1000.0 };
+        watchdog = BoidWatchdogCreate(&watchdogConfig);
+        if (!watchdog) fprintf(stderr, "Watchdog disabled: cannot start writer\n");
+    }
+    
+    BoidParams *boidParams = BoidWorldParams(world);
     
-    for (int i = 0; i < MAX_ENTITIES; i++)
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0)
     {
-        CreateRandomEntity(SCREEN_WIDTH, SCREEN_HEIGHT, 20);
+        int ticks = 600;
+        for (int a = 2; a < argc; a++)
+        {
+            if (strcmp(argv[a], "--neighbors") == 0 && a + 1 < argc) boidParams->maxNeighbors = atoi(argv[++a]);
+            else if (strcmp(argv[a], "--splat") == 0) cpuRenderer.enabled = true;
+            else if (strcmp(argv[a], "--fused") == 0) boidParams->fusedPipeline = true;
+            else if (strcmp(argv[a], "--radius-spread") == 0 && a + 1 < argc) radiusSpread = Clamp((float)atof(argv[++a]), 0.0f, 1.0f);
+            else if (strcmp(argv[a], "--radius-policy") == 0 && a + 1 < argc)
+            {
+                a++;
+                for (int p = 0; p < BOID_RADIUS_POLICY_COUNT; p++)
+                {
+                    if (strcmp(argv[a], RadiusPolicyName(p)) == 0) boidParams->radiusPolicy = p;
+                }
+            }
+            else if (strcmp(argv[a], "--budget") == 0 && a + 1 < argc)
+            {
+                a++;
+                boidParams->neighborBudgetMode = (strcmp(argv[a], "stratified") == 0) ? NEIGHBOR_BUDGET_STRATIFIED : NEIGHBOR_BUDGET_NEAREST;
+            }
+            else if (strcmp(argv[a], "--resume") == 0 || strcmp(argv[a], "--checkpoint") == 0 || strcmp(argv[a], "--checkpoint-every") == 0 ||
+                     strcmp(argv[a], "--telemetry") == 0 || strcmp(argv[a], "--watchdog") == 0 || strcmp(argv[a], "--watchdog-ms") == 0 ||
+                     strcmp(argv[a], "--workers") == 0 || strcmp(argv[a], "--pages") == 0 || strcmp(argv[a], "--broadphase") == 0) a++;
+            else if (atoi(argv[a]) > 0) ticks = atoi(argv[a]);
+        }
+        if (cpuRenderer.enabled && !InitCpuRenderer(&cpuRenderer, "resources/boid.png", false))
+        {
+            fprintf(stderr, "--splat: cannot load resources/boid.png\n");
+            BoidCheckpointerDestroy(checkpointer);
+            BoidTelemetrySenderDestroy(telemetry);
+            BoidWatchdogDestroy(watchdog);
+            BoidWorldDestroy(world);
+            return 1;
+        }
+        cpuRenderer.enabled = (cpuRenderer.pixels != NULL);
+        if (radiusSpread > 0) RandomizeRadiusScales(radiusSpread);
+        
+        int result;
+        if (demoBroadphase == BROADPHASE_ALL)
+        {
+            // Every run restores the same snapshot, so they all start from
+            // identical boids, radii and params
+            size_t size = BoidWorldSnapshotSize(world);
+            void *start = malloc(size);
+            if (start) BoidWorldSnapshot(world, start);
+            result = start ? 0 : 1;
+            
+            printf("[\n");
+            for (int b = 0; b < BOID_BROADPHASE_COUNT && result == 0; b++)
+            {
+                BoidWorld *run = BoidWorldRestore(start, size);
+                if (!run || !BoidWorldSetBroadphase(run, b))
+                {
+                    BoidWorldDestroy(run);
+                    result = 1;
+                    break;
+                }
+                BoidWorldDestroy(world);
+                world = run;
+                if (b > 0) printf(",\n");
+                result = RunBenchmark(ticks);
+            }
+            printf("]\n");
+            free(start);
+        }
+        else
+        {
+            result = RunBenchmark(ticks);
+        }
+        UnloadCpuRenderer(&cpuRenderer);
+        BoidCheckpointerDestroy(checkpointer);
+        BoidTelemetrySenderDestroy(telemetry);
+        BoidWatchdogDestroy(watchdog);
+        BoidWorldDestroy(world);
+        return result;
     }
     
+    InitWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "Boid Simulation - ECS + Spatial Partitioning");
+    
     Texture2D tex = LoadTexture("resources/boid.png");
+    InitHeatmapOverlay(&heatmap);
+    bool cpuRenderOk = InitCpuRenderer(&cpuRenderer, "resources/boid.png", true);
     
+    const SpatialGrid *grid = BoidWorldGrid(world);
+    int obstacleCount;
+    const ObstacleSegment *obstacles = BoidWorldObstacles(world, &obstacleCount);
+    int zoneCount;
+    const BoidZone *zones = BoidWorldZones(world, &zoneCount);
     Color customBlack = (Color){ 31, 31, 31 };
-
+    
+    // Frames are timed end to end, i.e. start to start, less the cap's wait
+    double frameMark = NowSeconds();
+    double capWait = 0.0;
+    
     while (!WindowShouldClose())
     {
-        if (IsKeyDown(KEY_ONE)) boidParams.separationWeight += 0.01f;
-        if (IsKeyDown(KEY_TWO)) boidParams.separationWeight -= 0.01f;
-        if (IsKeyDown(KEY_THREE)) boidParams.alignmentWeight += 0.01f;
-        if (IsKeyDown(KEY_FOUR)) boidParams.alignmentWeight -= 0.01f;
-        if (IsKeyDown(KEY_FIVE)) boidParams.cohesionWeight += 0.01f;
-        if (IsKeyDown(KEY_SIX)) boidParams.cohesionWeight -= 0.01f;
+        if (IsKeyDown(KEY_ONE)) boidParams->separationWeight += 0.01f;
+        if (IsKeyDown(KEY_TWO)) boidParams->separationWeight -= 0.01f;
+        if (IsKeyDown(KEY_THREE)) boidParams->alignmentWeight += 0.01f;
+        if (IsKeyDown(KEY_FOUR)) boidParams->alignmentWeight -= 0.01f;
+        if (IsKeyDown(KEY_FIVE)) boidParams->cohesionWeight += 0.01f;
+        if (IsKeyDown(KEY_SIX)) boidParams->cohesionWeight -= 0.01f;
+        if (IsKeyPressed(KEY_H)) heatmap.mode = (heatmap.mode + 1) % HEATMAP_MODE_COUNT;
+        if (IsKeyPressed(KEY_RIGHT_BRACKET)) FrameGovernorAdjustNeighborCap(&governor, 8);
+        if (IsKeyPressed(KEY_LEFT_BRACKET) && boidParams->maxNeighbors > 0) FrameGovernorAdjustNeighborCap(&governor, -8);
+        if (IsKeyPressed(KEY_B)) boidParams->neighborBudgetMode = (boidParams->neighborBudgetMode + 1) % NEIGHBOR_BUDGET_MODE_COUNT;
+        if (IsKeyPressed(KEY_G)) FrameGovernorSetEnabled(&governor, !governor.enabled);
+        if (IsKeyPressed(KEY_P)) boidParams->periodic = !boidParams->periodic;
+        if (IsKeyPressed(KEY_K)) boidParams->fusedPipeline = !boidParams->fusedPipeline;
+        if (IsKeyPressed(KEY_F)) GoalInputSystem(GetMousePosition());
+        if (IsKeyPressed(KEY_C) && cpuRenderOk) cpuRenderer.enabled = !cpuRenderer.enabled;
+        if (IsKeyPressed(KEY_X))
+        {
+            BoidBroadphaseKind next = (BoidWorldBroadphaseStats(world).kind + 1) % BOID_BROADPHASE_COUNT;
+            if (!BoidWorldSetBroadphase(world, next)) TraceLog(LOG_WARNING, "BROADPHASE: cannot switch to %s", BoidBroadphaseName(next));
+        }
+        if (IsKeyPressed(KEY_V)) boidParams->radiusPolicy = (boidParams->radiusPolicy + 1) % BOID_RADIUS_POLICY_COUNT;
+        if (IsKeyPressed(KEY_R))
+        {
+            radiusSpread = (radiusSpread > 0) ? 0.0f : 0.6f;
+            RandomizeRadiusScales(radiusSpread);
+        }
+        
+        double simStart = NowSeconds();
         
-        // Build spatial grid for fast neighbor queries
-        SpatialGridUpdateSystem(&spatialGrid, positions, entities, entityCount);
+        BoidStepTimings timings;
+        BoidWorldStep(world, 1, &timings);
+        CheckpointSystem();
+        ZoneEventSystem();
+        WorkerLoadSystem(&workerLoad);
         
-        AccelerationResetSystem(accelerations, entities, entityCount);
+        HeatmapUpdateSystem(&heatmap, grid, boidParams->maxSpeed);
         
-        // Boid behaviors now use spatial grid
-        BoidSeparationSystem(&spatialGrid, positions, velocities, accelerations, entities, entityCount, boidParams);
-        BoidAlignmentSystem(&spatialGrid, positions, velocities, accelerations, entities, entityCount, boidParams);
-        BoidCohesionSystem(&spatialGrid, positions, velocities, accelerations, entities, entityCount, boidParams);
+        double renderStart = NowSeconds();
         
-        PhysicsSystem(positions, velocities, accelerations, entities, entityCount, boidParams.maxSpeed);
-        WrapAroundSystem(positions, entities, entityCount, SCREEN_WIDTH, SCREEN_HEIGHT);
+        int count = BoidWorldCount(world);
         
         BeginDrawing();
         {
             ClearBackground(customBlack);
+            if (cpuRenderer.enabled) CpuRenderSystem(&cpuRenderer, customBlack);
             
-            RenderSystem(tex, positions, velocities, colors, entities, entityCount);
+            HeatmapRenderSystem(&heatmap);
+            ObstacleRenderSystem(obstacles, obstacleCount);
+            ZoneRenderSystem(zones, zoneCount);
+            GoalRenderSystem();
+            if (!cpuRenderer.enabled)
+                RenderSystem(tex, BoidWorldPositions(world), BoidWorldVelocities(world), BoidWorldColors(world), BoidWorldEntities(world), count, renderSettings, GetMousePosition());
             
-            DrawRectangle(0, 0, 400, 140, Fade(RAYWHITE, 0.8f));
+            DrawRectangle(0, 0, 400, 410, Fade(RAYWHITE, 0.8f));
             DrawFPS(10, 10);
-            DrawText(TextFormat("Separation: %.2f (1/2)", boidParams.separationWeight), 10, 30, 20, BLACK);
-            DrawText(TextFormat("Alignment: %.2f (3/4)", boidParams.alignmentWeight), 10, 50, 20, BLACK);
-            DrawText(TextFormat("Cohesion: %.2f (5/6)", boidParams.cohesionWeight), 10, 70, 20, BLACK);
-            DrawText(TextFormat("Boids: %d", entityCount), 10, 90, 20, BLACK);
-            DrawText(TextFormat("Grid: %dx%d cells", GRID_WIDTH, GRID_HEIGHT), 10, 110, 20, BLACK);
+            DrawText(TextFormat("Separation: %.2f (1/2)", boidParams->separationWeight), 10, 30, 20, BLACK);
+            DrawText(TextFormat("Alignment: %.2f (3/4)", boidParams->alignmentWeight), 10, 50, 20, BLACK);
+            DrawText(TextFormat("Cohesion: %.2f (5/6)", boidParams->cohesionWeight), 10, 70, 20, BLACK);
+            DrawText(TextFormat("Boids: %d  Workers: %d", count, BoidWorldMemoryInfo(world).workers), 10, 90, 20, BLACK);
+            DrawText(TextFormat("Grid: %dx%d cells, %s (P)", grid->width, grid->height, boidParams->periodic ? "periodic" : "bounded"), 10, 110, 20, BLACK);
+            DrawText(TextFormat("Heatmap: %s (H)", HeatmapModeName(heatmap.mode)), 10, 130, 20, BLACK);
+            if (boidParams->maxNeighbors > 0)
+                DrawText(TextFormat("Neighbor cap: %d %s ([ ] B)", boidParams->maxNeighbors, NeighborBudgetModeName(boidParams->neighborBudgetMode)), 10, 150, 20, BLACK);
+            else
+                DrawText("Neighbor cap: off ([ ] B)", 10, 150, 20, BLACK);
+            DrawText(TextFormat("Governor: %s L%d sim %.1f ms (G)", governor.enabled ? "on" : "off", governor.level, governor.simMs), 10, 170, 20, BLACK);
+            DrawText(TextFormat("Substeps: %d  Render: %.1f ms %s (C)", boidParams->substeps, governor.renderMs, cpuRenderer.enabled ? "cpu" : "gpu"), 10, 190, 20, BLACK);
+            DrawGridStats(&grid->stats, 10, 210);
+            DrawText(TextFormat("Zone events: +%d -%d", zoneCounters.entered, zoneCounters.exited), 10, 305, 20, BLACK);
+            DrawText(TextFormat("Radii: spread %.1f, %s policy (R V)", radiusSpread, RadiusPolicyName(boidParams->radiusPolicy)), 10, 325, 20, BLACK);
+            DrawText(TextFormat("Load: %.2fx mean busy, %d steals", workerLoad.imbalance, workerLoad.steals), 10, 345, 20, BLACK);
+            BoidBroadphaseStats broadphase = BoidWorldBroadphaseStats(world);
+            DrawText(TextFormat("Broadphase: %s, %.0f tests/boid (X)", BoidBroadphaseName(broadphase.kind), broadphase.distanceTestsPerBoid), 10, 365, 20, BLACK);
+            DrawText(TextFormat("Pipeline: %s (K)", boidParams->fusedPipeline ? "fused" : "systems"), 10, 385, 20, BLACK);
         }
+        // The swap can block on the display, so the render clock stops
+        // before it, but after submitting the batched draws, which are most
+        // of the cost the LOD and point rungs cut
+        rlDrawRenderBatchActive();
+        double renderEnd = NowSeconds();
         EndDrawing();
+        
+        // The whole frame, swap and input handling included, for the systems
+        // that judge it against a frame budget
+        double frameEnd = NowSeconds();
+        double frameSeconds = frameEnd - frameMark - capWait;
+        frameMark = frameEnd;
+        
+        FrameGovernorUpdate(&governor, renderStart - simStart, renderEnd - renderStart);
+        TelemetrySystem(&timings, frameSeconds);
+        WatchdogSystem(&timings, frameSeconds, renderEnd - renderStart);
+        
+        capWait = FrameCapWait(frameSeconds);
     }
-
+    
+    UnloadTexture(heatmap.texture);
+    UnloadCpuRenderer(&cpuRenderer);
     UnloadTexture(tex);
     CloseWindow();
-
+    FreeWorkerLoad(&workerLoad);
+    BoidCheckpointerDestroy(checkpointer);
+    BoidTelemetrySenderDestroy(telemetry);
+    BoidWatchdogDestroy(watchdog);
+    BoidWorldDestroy(world);
+    
     return 0;
-}
\ No newline at end of file
+}
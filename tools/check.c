@@ -0,0 +1,314 @@
+// ============================================================================
+// EQUALITY CHECK - Headless run of the results the core promises not to change
+// ============================================================================
+//
+// Each check runs small worlds two ways and compares them bit for bit:
+//
+//   parallel  grid builds and steps with 2-7 workers equal the serial ones
+//   fused     BoidParams.fusedPipeline equals the separate passes
+//   restore   a restored snapshot steps like the uninterrupted world, per index
+//   hash      SpatialHashQuery returns BoidWorldQuery's ids in its order
+//   layout    the run's hash, which is the same for every BoidLayoutName
+//
+// The layout check needs two builds. Run the default build, then pass the
+// hash it printed to the AoSoA build (-DBOID_AOSOA_LANES=8) with --expect.
+// The exit status is 1 if any check fails.
+//
+// Build: cc -O2 -pthread -I. tools/check.c boid.c boid_obstacles.c boid_flowfield.c boid_zones.c boid_memory.c boid_pool.c boid_broadphase.c boid_hash.c -lm -o check
+// Usage: check [--boids N] [--ticks N] [--expect HASH]
+
+#include "boid.h"
+#include "boid_hash.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_CHECK_WORKERS 7
+#define QUERY_PROBES 256
+#define QUERY_MAX_RESULTS 65536
+
+typedef struct {
+    int boids;
+    int ticks;
+    bool haveExpect;
+    uint64_t expect;
+} CheckConfig;
+
+static int failures = 0;
+
+static void Report(const char *check, const char *variant, bool ok)
+{
+    printf("%-9s %-24s %s\n", check, variant, ok ? "ok" : "FAIL");
+    if (!ok) failures++;
+}
+
+// ============================================================================
+// WORLD HASHES
+// ============================================================================
+
+// FNV-1a over raw bytes, so -0.0f and 0.0f or two NaNs differ as they should
+static uint64_t HashBytes(uint64_t h, const void *data, size_t size)
+{
+    const unsigned char *bytes = data;
+    for (size_t i = 0; i < size; i++)
+    {
+        h ^= bytes[i];
+        h *= 0x100000001b3ull;
+    }
+    return h;
+}
+
+#define HASH_SEED 0xcbf29ce484222325ull
+
+static uint64_t HashState(BoidWorld *world)
+{
+    int count = BoidWorldCount(world);
+    uint64_t h = HASH_SEED;
+    h = HashBytes(h, BoidWorldPositions(world), count * sizeof(Vector2));
+    h = HashBytes(h, BoidWorldVelocities(world), count * sizeof(Vector2));
+    return h;
+}
+
+// Every cell the last build wrote, border cells included: ids in order,
+// class counts and sums
+static uint64_t HashGrid(const BoidWorld *world)
+{
+    const SpatialGrid *grid = BoidWorldGrid(world);
+    uint64_t h = HASH_SEED;
+    for (int y = -1; y <= grid->height; y++)
+    {
+        for (int x = -1; x <= grid->width; x++)
+        {
+            const GridCell *cell = SpatialGridCellAt(grid, x, y);
+            h = HashBytes(h, &cell->count, sizeof(cell->count));
+            h = HashBytes(h, cell->entities, cell->count * sizeof(int));
+            h = HashBytes(h, cell->classCounts, sizeof(cell->classCounts));
+            h = HashBytes(h, &cell->positionSum, sizeof(cell->positionSum));
+            h = HashBytes(h, &cell->velocitySum, sizeof(cell->velocitySum));
+        }
+    }
+    h = HashBytes(h, &grid->stats.droppedInserts, sizeof(grid->stats.droppedInserts));
+    return h;
+}
+
+// Dense enough that cells overflow, so the parallel build's drop order counts
+static BoidWorld *CreateWorld(const CheckConfig *config, int workers, bool periodic, bool fused)
+{
+    BoidWorldConfig worldConfig = BoidDefaultConfig();
+    worldConfig.width = 400;
+    worldConfig.height = 320;
+    worldConfig.capacity = config->boids;
+    worldConfig.workers = workers;
+    worldConfig.params.periodic = periodic;
+    worldConfig.params.fusedPipeline = fused;
+    
+    BoidWorld *world = BoidWorldCreate(&worldConfig);
+    if (world) BoidWorldSpawnRandom(world, config->boids, 20);
+    return world;
+}
+
+// ============================================================================
+// CHECKS
+// ============================================================================
+
+static void CheckParallel(const CheckConfig *config, bool periodic)
+{
+    uint64_t serialGrid = 0, serialState = 0;
+    for (int workers = 1; workers <= MAX_CHECK_WORKERS; workers++)
+    {
+        char variant[64];
+        snprintf(variant, sizeof(variant), "%s, %d workers", periodic ? "periodic" : "bounded", workers);
+        
+        BoidWorld *world = CreateWorld(config, workers, periodic, false);
+        if (!world)
+        {
+            Report("parallel", variant, false);
+            continue;
+        }
+        BoidWorldStep(world, config->ticks, NULL);
+        uint64_t grid = HashGrid(world);
+        uint64_t state = HashState(world);
+        BoidWorldDestroy(world);
+        
+        if (workers == 1)
+        {
+            serialGrid = grid;
+            serialState = state;
+            continue;
+        }
+        Report("parallel", variant, grid == serialGrid && state == serialState);
+    }
+}
+
+static void CheckFused(const CheckConfig *config, int workers, bool periodic)
+{
+    char variant[64];
+    snprintf(variant, sizeof(variant), "%s, %d workers", periodic ? "periodic" : "bounded", workers);
+    
+    BoidWorld *separate = CreateWorld(config, workers, periodic, false);
+    BoidWorld *fused = CreateWorld(config, workers, periodic, true);
+    bool ok = separate && fused;
+    if (ok)
+    {
+        BoidWorldStep(separate, config->ticks, NULL);
+        BoidWorldStep(fused, config->ticks, NULL);
+        ok = HashState(separate) == HashState(fused) && HashGrid(separate) == HashGrid(fused);
+    }
+    Report("fused", variant, ok);
+    
+    if (separate) BoidWorldDestroy(separate);
+    if (fused) BoidWorldDestroy(fused);
+}
+
+static void CheckRestore(const CheckConfig *config, BoidBroadphaseKind kind)
+{
+    BoidWorld *world = CreateWorld(config, 2, false, false);
+    BoidWorld *restored = NULL;
+    void *buffer = NULL;
+    bool ok = world && BoidWorldSetBroadphase(world, kind);
+    
+    if (ok)
+    {
+        BoidWorldStep(world, config->ticks, NULL);
+        size_t size = BoidWorldSnapshotSize(world);
+        buffer = malloc(size);
+        ok = (buffer != NULL);
+        if (ok)
+        {
+            BoidWorldSnapshot(world, buffer);
+            restored = BoidWorldRestore(buffer, size);
+            ok = (restored != NULL);
+        }
+    }
+    if (ok)
+    {
+        BoidWorldStep(world, config->ticks, NULL);
+        BoidWorldStep(restored, config->ticks, NULL);
+        ok = HashState(world) == HashState(restored) && BoidWorldTick(world) == BoidWorldTick(restored) &&
+             BoidWorldBroadphaseStats(restored).kind == kind;
+    }
+    Report("restore", BoidBroadphaseName(kind), ok);
+    
+    free(buffer);
+    if (restored) BoidWorldDestroy(restored);
+    if (world) BoidWorldDestroy(world);
+}
+
+// Only meaningful without grid overflow, so the world is sparse
+static void CheckHashOrder(const CheckConfig *config)
+{
+    CheckConfig sparse = *config;
+    sparse.boids = config->boids / 8;
+    
+    BoidWorld *world = CreateWorld(&sparse, 1, false, false);
+    SpatialHash hash;
+    bool ok = world && SpatialHashInit(&hash, BOID_CELL_SIZE);
+    int *gridIds = malloc(QUERY_MAX_RESULTS * sizeof(int));
+    int *hashIds = malloc(QUERY_MAX_RESULTS * sizeof(int));
+    ok = ok && gridIds && hashIds;
+    
+    if (ok)
+    {
+        // Brings the grid up to the current positions the hash is built from
+        BoidWorldStep(world, config->ticks, NULL);
+        BoidWorldMeasureFlock(world);
+        ok = BoidWorldGrid(world)->stats.droppedInserts == 0 &&
+             SpatialHashBuild(&hash, BoidWorldPositions(world), BoidWorldEntities(world), BoidWorldCount(world));
+    }
+    
+    // Radii from inside one cell to past the whole world, centres on and off it
+    uint64_t seed = 0x9e3779b97f4a7c15ull;
+    for (int probe = 0; ok && probe < QUERY_PROBES; probe++)
+    {
+        seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+        Vector2 pos = { (float)((seed >> 16) % 480) - 40.0f, (float)((seed >> 40) % 400) - 40.0f };
+        float radius = (probe % 4 == 3) ? 600.0f : 1.0f + (float)(probe % 64);
+        
+        int gridCount, hashCount;
+        BoidWorldQuery(world, pos, radius, gridIds, &gridCount, QUERY_MAX_RESULTS);
+        SpatialHashQuery(&hash, pos, radius, hashIds, &hashCount, QUERY_MAX_RESULTS);
+        ok = gridCount == hashCount && memcmp(gridIds, hashIds, gridCount * sizeof(int)) == 0;
+    }
+    Report("hash", "query order", ok);
+    
+    free(gridIds);
+    free(hashIds);
+    if (world)
+    {
+        SpatialHashFree(&hash);
+        BoidWorldDestroy(world);
+    }
+}
+
+static void CheckLayout(const CheckConfig *config)
+{
+    BoidWorld *world = CreateWorld(config, 3, false, false);
+    if (!world)
+    {
+        Report("layout", BoidLayoutName(), false);
+        return;
+    }
+    BoidWorldStep(world, config->ticks, NULL);
+    uint64_t h = HashState(world);
+    BoidWorldDestroy(world);
+    
+    printf("layout    %-24s hash %016" PRIx64 "\n", BoidLayoutName(), h);
+    if (config->haveExpect) Report("layout", "matches --expect", h == config->expect);
+}
+
+// ============================================================================
+// MAIN
+// ============================================================================
+
+int main(int argc, char **argv)
+{
+    CheckConfig config = {
+        .boids = 12000,
+        .ticks = 20,
+        .haveExpect = false,
+    };
+    
+    for (int a = 1; a < argc; a++)
+    {
+        const char *arg = argv[a];
+        const char *value = (a + 1 < argc) ? argv[a + 1] : NULL;
+        bool ok = (value != NULL);
+        
+        if (ok && strcmp(arg, "--boids") == 0) config.boids = atoi(value);
+        else if (ok && strcmp(arg, "--ticks") == 0) config.ticks = atoi(value);
+        else if (ok && strcmp(arg, "--expect") == 0)
+        {
+            char *end;
+            config.expect = strtoull(value, &end, 16);
+            config.haveExpect = true;
+            ok = (end != value && *end == '\0');
+        }
+        else ok = false;
+        
+        if (!ok)
+        {
+            fprintf(stderr, "check: bad argument '%s'\n", arg);
+            return 1;
+        }
+        a++;
+    }
+    
+    if (config.boids < 8 || config.ticks < 1)
+    {
+        fprintf(stderr, "check: --boids must be at least 8 and --ticks at least 1\n");
+        return 1;
+    }
+    
+    CheckParallel(&config, false);
+    CheckParallel(&config, true);
+    CheckFused(&config, 1, false);
+    CheckFused(&config, 3, false);
+    CheckFused(&config, 3, true);
+    for (int kind = 0; kind < BOID_BROADPHASE_COUNT; kind++) CheckRestore(&config, (BoidBroadphaseKind)kind);
+    CheckHashOrder(&config);
+    CheckLayout(&config);
+    
+    printf("%d failed\n", failures);
+    return failures ? 1 : 0;
+}
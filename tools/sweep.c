@@ -0,0 +1,296 @@
+// ============================================================================
+// PARAMETER SWEEP - Many small headless worlds in parallel, metrics to CSV
+// ============================================================================
+//
+// Runs every combination of the separation/alignment/cohesion weight lists
+// (times --seeds seeds) as an independent world, one world per worker thread
+// at a time, and writes one CSV row per run in grid order. --ensemble packs
+// BOID_ENSEMBLE_LANES runs into one SIMD ensemble per worker claim instead.
+//
+// Build: cc -O2 -mavx -pthread -I. tools/sweep.c boid.c boid_obstacles.c boid_flowfield.c boid_zones.c boid_memory.c boid_pool.c boid_broadphase.c boid_hash.c boid_ensemble.c -lm -o sweep
+// Usage: sweep [--separation 1,2,3] [--alignment 0.5,1] [--cohesion 0.25,0.5]
+//              [--seeds N] [--boids N] [--size WxH] [--ticks N] [--threads N]
+//              [--ensemble] [--out results.csv]
+
+#define _POSIX_C_SOURCE 199309L // clock_gettime
+
+#include "boid.h"
+#include "boid_ensemble.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_SWEEP_VALUES 32
+
+typedef struct {
+    float values[MAX_SWEEP_VALUES];
+    int count;
+} SweepAxis;
+
+typedef struct {
+    SweepAxis separation;
+    SweepAxis alignment;
+    SweepAxis cohesion;
+    int seeds;
+    int boids;
+    int width, height;
+    int ticks;
+    int threads;
+    bool ensemble;
+    const char *outPath;
+} SweepConfig;
+
+typedef struct {
+    float separationWeight;
+    float alignmentWeight;
+    float cohesionWeight;
+    uint64_t seed;
+    
+    bool ok;
+    FlockMetrics metrics;
+    double seconds;
+} SweepRun;
+
+typedef struct {
+    const SweepConfig *config;
+    SweepRun *runs;
+    int runCount;
+    int batch;       // Runs per claim
+    atomic_int next; // Next unclaimed batch
+} SweepQueue;
+
+static double NowSeconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static bool ParseAxis(const char *text, SweepAxis *axis)
+{
+    axis->count = 0;
+    while (*text && axis->count < MAX_SWEEP_VALUES)
+    {
+        char *end;
+        axis->values[axis->count++] = strtof(text, &end);
+        if (end == text) return false;
+        text = (*end == ',') ? end + 1 : end;
+    }
+    return axis->count > 0 && *text == '\0';
+}
+
+static void RunOne(const SweepConfig *config, SweepRun *run)
+{
+    BoidWorldConfig worldConfig = BoidDefaultConfig();
+    worldConfig.capacity = config->boids;
+    worldConfig.width = config->width;
+    worldConfig.height = config->height;
+    worldConfig.seed = run->seed;
+    worldConfig.params.separationWeight = run->separationWeight;
+    worldConfig.params.alignmentWeight = run->alignmentWeight;
+    worldConfig.params.cohesionWeight = run->cohesionWeight;
+    
+    double start = NowSeconds();
+    
+    BoidWorld *world = BoidWorldCreate(&worldConfig);
+    if (!world) return;
+    
+    BoidWorldSpawnRandom(world, config->boids, 0);
+    BoidWorldStep(world, config->ticks, NULL);
+    run->metrics = BoidWorldMeasureFlock(world);
+    BoidWorldDestroy(world);
+    
+    run->seconds = NowSeconds() - start;
+    run->ok = true;
+}
+
+// Up to BOID_ENSEMBLE_LANES runs in lockstep; spare lanes repeat the last run.
+// Each run is charged an equal share of the wall time.
+static void RunEnsemble(const SweepConfig *config, SweepRun *runs, int count)
+{
+    BoidParams params[BOID_ENSEMBLE_LANES];
+    uint64_t seeds[BOID_ENSEMBLE_LANES];
+    
+    for (int l = 0; l < BOID_ENSEMBLE_LANES; l++)
+    {
+        const SweepRun *run = &runs[l < count ? l : count - 1];
+        params[l] = BoidDefaultParams();
+        params[l].separationWeight = run->separationWeight;
+        params[l].alignmentWeight = run->alignmentWeight;
+        params[l].cohesionWeight = run->cohesionWeight;
+        seeds[l] = run->seed;
+    }
+    
+    double start = NowSeconds();
+    
+    BoidEnsemble *ensemble = BoidEnsembleCreate(config->boids, config->width, config->height, 0, params, seeds);
+    if (!ensemble) return;
+    
+    BoidEnsembleStep(ensemble, config->ticks);
+    for (int l = 0; l < count; l++) runs[l].metrics = BoidEnsembleMeasureFlock(ensemble, l);
+    BoidEnsembleDestroy(ensemble);
+    
+    double seconds = (NowSeconds() - start) / count;
+    for (int l = 0; l < count; l++)
+    {
+        runs[l].seconds = seconds;
+        runs[l].ok = true;
+    }
+}
+
+static void *SweepWorker(void *arg)
+{
+    SweepQueue *queue = arg;
+    
+    for (;;)
+    {
+        int r = atomic_fetch_add(&queue->next, 1) * queue->batch;
+        if (r >= queue->runCount) break;
+        
+        if (queue->config->ensemble)
+        {
+            int count = queue->runCount - r < queue->batch ? queue->runCount - r : queue->batch;
+            RunEnsemble(queue->config, &queue->runs[r], count);
+        }
+        else
+        {
+            RunOne(queue->config, &queue->runs[r]);
+        }
+    }
+    return NULL;
+}
+
+static void WriteCsv(FILE *out, const SweepConfig *config, const SweepRun *runs, int runCount)
+{
+    fprintf(out, "separation,alignment,cohesion,seed,boids,ticks,polarization,clusters,largest_cluster,mean_nn_distance,seconds\n");
+    for (int r = 0; r < runCount; r++)
+    {
+        const SweepRun *run = &runs[r];
+        if (!run->ok) continue;
+        
+        fprintf(out, "%g,%g,%g,%llu,%d,%d,%.4f,%d,%d,%.3f,%.4f\n",
+            run->separationWeight, run->alignmentWeight, run->cohesionWeight,
+            (unsigned long long)run->seed, config->boids, config->ticks,
+            run->metrics.polarization, run->metrics.clusterCount, run->metrics.largestCluster,
+            run->metrics.meanNearestNeighbor, run->seconds);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    BoidParams defaults = BoidDefaultParams();
+    SweepConfig config = {
+        .separation = { { defaults.separationWeight }, 1 },
+        .alignment = { { defaults.alignmentWeight }, 1 },
+        .cohesion = { { defaults.cohesionWeight }, 1 },
+        .seeds = 1,
+        .boids = 300,
+        .width = 400,
+        .height = 400,
+        .ticks = 1000,
+        .threads = (int)sysconf(_SC_NPROCESSORS_ONLN),
+        .ensemble = false,
+        .outPath = NULL,
+    };
+    
+    for (int a = 1; a < argc; a++)
+    {
+        const char *arg = argv[a];
+        const char *value = (a + 1 < argc) ? argv[a + 1] : NULL;
+        bool ok = (value != NULL);
+        
+        if (strcmp(arg, "--ensemble") == 0)
+        {
+            config.ensemble = true;
+            continue;
+        }
+        
+        if (ok && strcmp(arg, "--separation") == 0) ok = ParseAxis(value, &config.separation);
+        else if (ok && strcmp(arg, "--alignment") == 0) ok = ParseAxis(value, &config.alignment);
+        else if (ok && strcmp(arg, "--cohesion") == 0) ok = ParseAxis(value, &config.cohesion);
+        else if (ok && strcmp(arg, "--seeds") == 0) config.seeds = atoi(value);
+        else if (ok && strcmp(arg, "--boids") == 0) config.boids = atoi(value);
+        else if (ok && strcmp(arg, "--size") == 0) ok = (sscanf(value, "%dx%d", &config.width, &config.height) == 2);
+        else if (ok && strcmp(arg, "--ticks") == 0) config.ticks = atoi(value);
+        else if (ok && strcmp(arg, "--threads") == 0) config.threads = atoi(value);
+        else if (ok && strcmp(arg, "--out") == 0) config.outPath = value;
+        else ok = false;
+        
+        if (!ok)
+        {
+            fprintf(stderr, "sweep: bad argument '%s'\n", arg);
+            return 1;
+        }
+        a++;
+    }
+    
+    if (config.threads < 1) config.threads = 1;
+    if (config.seeds < 1) config.seeds = 1;
+    if (config.width % BOID_CELL_SIZE != 0 || config.height % BOID_CELL_SIZE != 0)
+    {
+        fprintf(stderr, "sweep: world size must be a multiple of %d\n", BOID_CELL_SIZE);
+        return 1;
+    }
+    
+    // Expand the parameter grid, seeds innermost
+    int runCount = config.separation.count * config.alignment.count * config.cohesion.count * config.seeds;
+    SweepRun *runs = calloc(runCount, sizeof(SweepRun));
+    if (!runs) return 1;
+    
+    int r = 0;
+    for (int s = 0; s < config.separation.count; s++)
+        for (int al = 0; al < config.alignment.count; al++)
+            for (int c = 0; c < config.cohesion.count; c++)
+                for (int seed = 0; seed < config.seeds; seed++)
+                {
+                    runs[r++] = (SweepRun){
+                        .separationWeight = config.separation.values[s],
+                        .alignmentWeight = config.alignment.values[al],
+                        .cohesionWeight = config.cohesion.values[c],
+                        .seed = 1234 + seed,
+                    };
+                }
+    
+    SweepQueue queue = { .config = &config, .runs = runs, .runCount = runCount, .batch = config.ensemble ? BOID_ENSEMBLE_LANES : 1 };
+    atomic_init(&queue.next, 0);
+    
+    double start = NowSeconds();
+    
+    pthread_t *threads = malloc(config.threads * sizeof(pthread_t));
+    int started = 0;
+    for (int t = 0; t < config.threads && threads; t++)
+    {
+        if (pthread_create(&threads[t], NULL, SweepWorker, &queue) != 0) break;
+        started++;
+    }
+    if (started == 0) SweepWorker(&queue);
+    for (int t = 0; t < started; t++) pthread_join(threads[t], NULL);
+    free(threads);
+    
+    double elapsed = NowSeconds() - start;
+    
+    int failed = 0;
+    for (int i = 0; i < runCount; i++) failed += !runs[i].ok;
+    
+    FILE *out = config.outPath ? fopen(config.outPath, "w") : stdout;
+    if (!out)
+    {
+        fprintf(stderr, "sweep: cannot open %s\n", config.outPath);
+        free(runs);
+        return 1;
+    }
+    WriteCsv(out, &config, runs, runCount);
+    if (out != stdout) fclose(out);
+    
+    fprintf(stderr, "sweep: %d worlds (%d boids, %d ticks) on %d threads%s in %.2f s: %.2f worlds/s\n",
+        runCount - failed, config.boids, config.ticks, started ? started : 1, config.ensemble ? " (ensemble)" : "",
+        elapsed, (runCount - failed) / elapsed);
+    if (failed) fprintf(stderr, "sweep: %d worlds failed to allocate\n", failed);
+    
+    free(runs);
+    return failed ? 1 : 0;
+}
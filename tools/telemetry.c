@@ -0,0 +1,168 @@
+// ============================================================================
+// TELEMETRY READER - Decodes the binary stream from boid_telemetry.h
+// ============================================================================
+//
+// Binds the address the simulations send to and prints, once a second, one
+// line per sending instance: samples received, tick times, grid overflow,
+// polarization, and the two kinds of loss (samples the sender dropped, and
+// datagrams missing from its sequence). --samples prints every sample too.
+//
+// Build: cc -O2 -pthread -I. tools/telemetry.c boid_telemetry.c boid.c boid_obstacles.c boid_flowfield.c boid_zones.c boid_memory.c boid_pool.c boid_broadphase.c boid_hash.c -lm -o telemetry
+// Usage: telemetry unix:/tmp/boids.sock | udp:<port> [--samples]
+
+#define _POSIX_C_SOURCE 200809L // clock_gettime, sockets
+
+#include "boid_telemetry.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <time.h>
+
+#define MAX_INSTANCES 64
+
+// One sender, accumulated over the current reporting second
+typedef struct {
+    uint32_t instance;
+    uint64_t nextSequence;
+    uint32_t senderDropped;
+    long long lostDatagrams;
+    
+    int samples;
+    double frameSum, frameMax;
+    double stepSum;
+    uint64_t lastTick;
+    uint32_t boids;
+    uint32_t droppedInserts;
+    uint32_t maxOccupancy;
+    float polarization;
+} InstanceSummary;
+
+static InstanceSummary instances[MAX_INSTANCES];
+static int instanceCount;
+
+static double NowSeconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static InstanceSummary *FindInstance(uint32_t instance)
+{
+    for (int i = 0; i < instanceCount; i++)
+    {
+        if (instances[i].instance == instance) return &instances[i];
+    }
+    if (instanceCount == MAX_INSTANCES) return NULL;
+    
+    InstanceSummary *summary = &instances[instanceCount++];
+    memset(summary, 0, sizeof(*summary));
+    summary->instance = instance;
+    return summary;
+}
+
+static void AddDatagram(InstanceSummary *summary, const BoidTelemetryHeader *header, const BoidTelemetrySample *samples, int count, bool printSamples)
+{
+    // Datagrams are only lost, never reordered, on a local socket
+    if (header->sequence > summary->nextSequence) summary->lostDatagrams += header->sequence - summary->nextSequence;
+    summary->nextSequence = header->sequence + 1;
+    summary->senderDropped = header->dropped;
+    
+    for (int s = 0; s < count; s++)
+    {
+        const BoidTelemetrySample *sample = &samples[s];
+        double step = sample->gridSeconds + sample->steeringSeconds + sample->physicsSeconds + sample->publishSeconds;
+        summary->samples++;
+        summary->frameSum += sample->frameSeconds;
+        if (sample->frameSeconds > summary->frameMax) summary->frameMax = sample->frameSeconds;
+        summary->stepSum += step;
+        summary->lastTick = sample->tick;
+        summary->boids = sample->boidCount;
+        summary->droppedInserts += sample->droppedInserts;
+        if (sample->maxOccupancy > summary->maxOccupancy) summary->maxOccupancy = sample->maxOccupancy;
+        summary->polarization = sample->polarization;
+        
+        if (printSamples)
+        {
+            printf("  %u tick %llu: grid %.3f steer %.3f physics %.3f publish %.3f frame %.3f ms, %u boids, %u dropped, max/cell %u, polarization %.3f\n",
+                header->instance, (unsigned long long)sample->tick, sample->gridSeconds * 1000.0, sample->steeringSeconds * 1000.0,
+                sample->physicsSeconds * 1000.0, sample->publishSeconds * 1000.0, sample->frameSeconds * 1000.0,
+                sample->boidCount, sample->droppedInserts, sample->maxOccupancy, sample->polarization);
+        }
+    }
+}
+
+static void PrintSummaries(void)
+{
+    for (int i = 0; i < instanceCount; i++)
+    {
+        InstanceSummary *summary = &instances[i];
+        if (summary->samples == 0) continue;
+        
+        printf("%u: tick %llu, %d samples, step %.3f ms, frame %.3f ms (max %.3f), %u boids, %u dropped inserts, max/cell %u, polarization %.3f, lost %u samples + %lld datagrams\n",
+            summary->instance, (unsigned long long)summary->lastTick, summary->samples,
+            summary->stepSum * 1000.0 / summary->samples, summary->frameSum * 1000.0 / summary->samples, summary->frameMax * 1000.0,
+            summary->boids, summary->droppedInserts, summary->maxOccupancy, summary->polarization,
+            summary->senderDropped, summary->lostDatagrams);
+        
+        summary->samples = 0;
+        summary->frameSum = summary->frameMax = summary->stepSum = 0;
+        summary->droppedInserts = 0;
+        summary->maxOccupancy = 0;
+    }
+    fflush(stdout);
+}
+
+int main(int argc, char **argv)
+{
+    const char *address = NULL;
+    bool printSamples = false;
+    for (int a = 1; a < argc; a++)
+    {
+        if (strcmp(argv[a], "--samples") == 0) printSamples = true;
+        else address = argv[a];
+    }
+    if (!address)
+    {
+        fprintf(stderr, "usage: %s unix:<path> | udp:<port> [--samples]\n", argv[0]);
+        return 1;
+    }
+    
+    int fd = BoidTelemetryListen(address);
+    if (fd < 0)
+    {
+        fprintf(stderr, "cannot listen on %s\n", address);
+        return 1;
+    }
+    
+    // Wake at least once a second to report even when nothing arrives
+    struct timeval timeout = { .tv_sec = 1 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    
+    unsigned char datagram[sizeof(BoidTelemetryHeader) + BOID_TELEMETRY_BATCH * sizeof(BoidTelemetrySample)];
+    BoidTelemetryHeader header;
+    BoidTelemetrySample samples[BOID_TELEMETRY_BATCH];
+    double nextReport = NowSeconds() + 1.0;
+    long long rejected = 0;
+    
+    for (;;)
+    {
+        ssize_t size = recv(fd, datagram, sizeof(datagram), 0);
+        if (size > 0)
+        {
+            int count = BoidTelemetryDecode(datagram, (size_t)size, &header, samples);
+            InstanceSummary *summary = (count >= 0) ? FindInstance(header.instance) : NULL;
+            if (summary) AddDatagram(summary, &header, samples, count, printSamples);
+            else if (rejected++ == 0) fprintf(stderr, "ignoring datagrams that are not telemetry v%d or from too many instances\n", BOID_TELEMETRY_VERSION);
+        }
+        
+        double now = NowSeconds();
+        if (now >= nextReport)
+        {
+            PrintSummaries();
+            nextReport = now + 1.0;
+        }
+    }
+}